@@ -0,0 +1,25 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+namespace bench {
+
+/// @brief Keep the compiler from optimizing a value away
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// @brief Run fn once and print the time per operation
+/// @return The elapsed seconds
+template <typename F>
+inline double Measure(const char* name, std::size_t operations, F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    std::forward<F>(fn)();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-44s %10.2f ms %10.1f ns/op\n", name, seconds * 1e3, seconds * 1e9 / operations);
+    return seconds;
+}
+
+}
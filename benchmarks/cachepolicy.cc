@@ -0,0 +1,81 @@
+// Hit rate and throughput of the LRUCache eviction policies on skewed and scan-mixed traces
+#include "bench.hpp"
+#include "lcore/lru.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+constexpr std::size_t Keys = 1 << 20;
+constexpr std::size_t TraceLength = 1 << 22;
+constexpr std::size_t CacheSize = 1 << 14;
+
+/// @brief Draw keys in [0, n) with P(k) proportional to 1 / (k + 1)^s, shuffled so popularity is not key order
+class Zipf {
+    std::vector<double> cdf;
+    std::vector<std::uint64_t> names;
+public:
+    Zipf(std::size_t n, double s, std::uint64_t seed): cdf(n), names(n) {
+        double sum = 0;
+        for (std::size_t k = 0; k < n; ++k) cdf[k] = sum += 1 / std::pow(double(k + 1), s);
+        for (auto& p: cdf) p /= sum;
+        for (std::size_t k = 0; k < n; ++k) names[k] = k;
+        std::shuffle(names.begin(), names.end(), std::mt19937_64(seed));
+    }
+    template <typename Rng>
+    std::uint64_t operator()(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>()(rng);
+        return names[std::min<std::size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), cdf.size() - 1)];
+    }
+};
+
+template <typename Policy>
+void Run(const char* name, const std::vector<std::uint64_t>& trace) {
+    LRUCache<std::uint64_t, std::uint64_t, InplaceFunction<void(const std::uint64_t&, const std::uint64_t&)>,
+        std::uint64_t, std::hash<std::uint64_t>, std::equal_to<>, Policy> cache(CacheSize);
+    std::size_t hits = 0;
+    char label[64];
+    std::snprintf(label, sizeof(label), "  %s", name);
+    bench::Measure(label, trace.size(), [&] {
+        for (auto key: trace) {
+            if (cache.Get(key)) ++hits;
+            else cache.Put(key, key);
+        }
+    });
+    std::printf("  %-42s %10.2f %% hits\n", "", 100.0 * hits / trace.size());
+}
+
+void RunAll(const char* title, const std::vector<std::uint64_t>& trace) {
+    std::printf("== %s\n", title);
+    Run<LRUPolicy>("LRU", trace);
+    Run<ClockPolicy>("CLOCK", trace);
+    Run<SLRUPolicy>("SLRU", trace);
+    Run<TinyLFUPolicy>("W-TinyLFU", trace);
+}
+
+int main() {
+    std::mt19937_64 rng(42);
+    std::vector<std::uint64_t> trace(TraceLength);
+    for (double s: {0.8, 0.99}) {
+        Zipf zipf(Keys, s, 1);
+        for (auto& key: trace) key = zipf(rng);
+        char title[64];
+        std::snprintf(title, sizeof(title), "Zipf s=%.2f, %zu keys, cache of %zu", s, Keys, CacheSize);
+        RunAll(title, trace);
+    }
+
+    // The Zipf trace interrupted by sequential scans of keys never seen again, 4x the cache size each
+    Zipf zipf(Keys, 0.99, 1);
+    std::uint64_t next_scan = Keys;
+    for (std::size_t i = 0; i < trace.size();) {
+        if (i % (CacheSize * 16) == 0) {
+            for (std::size_t j = 0; j < CacheSize * 4 && i < trace.size(); ++j) trace[i++] = next_scan++;
+        } else {
+            trace[i++] = zipf(rng);
+        }
+    }
+    RunAll("Zipf s=0.99 with a scan of 4x the cache every 16x", trace);
+    return 0;
+}
@@ -0,0 +1,54 @@
+// Read-heavy multi-threaded lookups: ConcurrentLRUCache against a single lock around LRUCache
+#include "bench.hpp"
+#include "lcore/concurrentlru.hpp"
+#include "lcore/threadsafe.hpp"
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+constexpr std::size_t Entries = 1 << 18;
+constexpr std::size_t OperationsPerThread = 1 << 20;
+
+template <typename Get, typename Put>
+void Run(const char* name, std::size_t threads, Get&& get, Put&& put) {
+    char label[64];
+    std::snprintf(label, sizeof(label), "%s, %zu threads", name, threads);
+    bench::Measure(label, OperationsPerThread * threads, [&] {
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937_64 rng(t);
+                std::size_t found = 0;
+                for (std::size_t i = 0; i < OperationsPerThread; ++i) {
+                    std::uint64_t key = rng() % (Entries * 2);
+                    if (i % 20 == 0) put(key);  // 5% writes
+                    else found += get(key);
+                }
+                bench::DoNotOptimize(found);
+            });
+        }
+        for (auto& worker: workers) worker.join();
+    });
+}
+
+int main() {
+    std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    using Cache = LRUCache<std::uint64_t, std::uint64_t>;
+    for (std::size_t threads = 1; threads <= hardware * 2; threads *= 2) {
+        ConcurrentLRUCache<std::uint64_t, std::uint64_t> sharded(Entries);
+        for (std::uint64_t i = 0; i < Entries; ++i) sharded.Put(i, i);
+        Run("ConcurrentLRUCache", threads,
+            [&](std::uint64_t key) { return sharded.Get(key).has_value(); },
+            [&](std::uint64_t key) { sharded.Put(key, key); });
+
+        Synchronized<Cache> locked{Cache(Entries)};
+        locked.with_lock([](Cache& cache) { for (std::uint64_t i = 0; i < Entries; ++i) cache.Put(i, i); });
+        Run("Synchronized<LRUCache>", threads,
+            [&](std::uint64_t key) { return locked.with_lock([&](Cache& cache) { return cache.Get(key) != nullptr; }); },
+            [&](std::uint64_t key) { locked.with_lock([&](Cache& cache) { cache.Put(key, key); }); });
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Writing and reading a 256 MiB file through OFStream/IFStream (on pread/pwrite and on std::FILE), BackgroundOFStream,
+// MmapIFStream and std::ofstream/std::ifstream, in small and large blocks
+#include "bench.hpp"
+#include "lcore/backgroundfstream.hpp"
+#include "lcore/fstream.hpp"
+#include "lcore/mmapstream.hpp"
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+constexpr std::size_t FileSize = std::size_t(1) << 28;
+
+int main() {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "lcore_bench_fstream";
+    std::vector<char> data(std::size_t(1) << 20);
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>(i * 31);
+
+    for (std::size_t block: {std::size_t(64), std::size_t(4096), std::size_t(1) << 20}) {
+        char name[64];
+        std::size_t blocks = FileSize / block;
+        std::snprintf(name, sizeof(name), "OFStream PutN %zu B", block);
+        bench::Measure(name, blocks, [&] {
+            OFStream file(path, IOSBase::OpenMode::Write | IOSBase::OpenMode::Binary);
+            for (std::size_t i = 0; i < blocks; ++i) file.PutN(data.data() + i * block % data.size(), block);
+            file.Flush();
+        });
+        std::snprintf(name, sizeof(name), "OFStream on FILE PutN %zu B", block);
+        bench::Measure(name, blocks, [&] {
+            BasicOFStream<char, std::char_traits<char>, FileStreamHandler> file(path, IOSBase::OpenMode::Write | IOSBase::OpenMode::Binary);
+            for (std::size_t i = 0; i < blocks; ++i) file.PutN(data.data() + i * block % data.size(), block);
+            file.Flush();
+        });
+        std::snprintf(name, sizeof(name), "BackgroundOFStream PutN %zu B", block);
+        bench::Measure(name, blocks, [&] {
+            BackgroundOFStream file(path, IOSBase::OpenMode::Write | IOSBase::OpenMode::Binary);
+            for (std::size_t i = 0; i < blocks; ++i) file.PutN(data.data() + i * block % data.size(), block);
+            file.Flush();
+        });
+        std::snprintf(name, sizeof(name), "std::ofstream write %zu B", block);
+        bench::Measure(name, blocks, [&] {
+            std::ofstream file(path, std::ios::binary);
+            for (std::size_t i = 0; i < blocks; ++i) file.write(data.data() + i * block % data.size(), block);
+            file.flush();
+        });
+
+        std::vector<char> read(block);
+        std::snprintf(name, sizeof(name), "IFStream GetN %zu B", block);
+        bench::Measure(name, blocks, [&] {
+            IFStream file(path, IOSBase::OpenMode::Read | IOSBase::OpenMode::Binary);
+            for (std::size_t i = 0; i < blocks; ++i) file.GetN(read.data(), block);
+            bench::DoNotOptimize(read[0]);
+        });
+        std::snprintf(name, sizeof(name), "IFStream on FILE GetN %zu B", block);
+        bench::Measure(name, blocks, [&] {
+            BasicIFStream<char, std::char_traits<char>, FileStreamHandler> file(path, IOSBase::OpenMode::Read | IOSBase::OpenMode::Binary);
+            for (std::size_t i = 0; i < blocks; ++i) file.GetN(read.data(), block);
+            bench::DoNotOptimize(read[0]);
+        });
+        std::snprintf(name, sizeof(name), "MmapIFStream GetN %zu B", block);
+        bench::Measure(name, blocks, [&] {
+            MmapIFStream file(path);
+            for (std::size_t i = 0; i < blocks; ++i) file.GetN(read.data(), block);
+            bench::DoNotOptimize(read[0]);
+        });
+        std::snprintf(name, sizeof(name), "std::ifstream read %zu B", block);
+        bench::Measure(name, blocks, [&] {
+            std::ifstream file(path, std::ios::binary);
+            for (std::size_t i = 0; i < blocks; ++i) file.read(read.data(), block);
+            bench::DoNotOptimize(read[0]);
+        });
+    }
+    std::filesystem::remove(path);
+}
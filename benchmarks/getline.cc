@@ -0,0 +1,75 @@
+// Splitting 64 MiB of log lines with GetLine, against a character loop (as GetLine did before ScanUntil) and std::getline
+#include "bench.hpp"
+#include "lcore/fstream.hpp"
+#include "lcore/mmapstream.hpp"
+#include "lcore/sstream.hpp"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+constexpr std::size_t TextSize = std::size_t(1) << 26;
+
+int main() {
+    // Lines of 40 to 200 characters, as in a typical log
+    std::string text;
+    std::size_t lines = 0;
+    std::mt19937_64 random(42);
+    while (text.size() < TextSize) {
+        std::size_t length = 40 + random() % 160;
+        for (std::size_t i = 0; i < length; ++i) text.push_back(static_cast<char>('a' + random() % 26));
+        text.push_back('\n');
+        ++lines;
+    }
+
+    bench::Measure("IStringStream GetCh per character", lines, [&] {
+        IStringStream stream(text);
+        std::string line;
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < lines; ++i) {
+            line.clear();
+            for (int c; (c = stream.GetCh()) != std::char_traits<char>::eof() && c != '\n';) line.push_back(static_cast<char>(c));
+            total += line.size();
+        }
+        bench::DoNotOptimize(total);
+    });
+    bench::Measure("IStringStream GetLine", lines, [&] {
+        IStringStream stream(text);
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < lines; ++i) total += stream.GetLine().size();
+        bench::DoNotOptimize(total);
+    });
+    bench::Measure("std::istringstream std::getline", lines, [&] {
+        std::istringstream stream(text);
+        std::string line;
+        std::size_t total = 0;
+        while (std::getline(stream, line)) total += line.size();
+        bench::DoNotOptimize(total);
+    });
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "lcore_bench_getline";
+    std::ofstream(path, std::ios::binary) << text;
+    bench::Measure("IFStream GetLine", lines, [&] {
+        IFStream stream(path);
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < lines; ++i) total += stream.GetLine().size();
+        bench::DoNotOptimize(total);
+    });
+    bench::Measure("MmapIFStream GetLine", lines, [&] {
+        MmapIFStream stream(path);
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < lines; ++i) total += stream.GetLine().size();
+        bench::DoNotOptimize(total);
+    });
+    bench::Measure("std::ifstream std::getline", lines, [&] {
+        std::ifstream stream(path, std::ios::binary);
+        std::string line;
+        std::size_t total = 0;
+        while (std::getline(stream, line)) total += line.size();
+        bench::DoNotOptimize(total);
+    });
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,93 @@
+// LRUCache at 1M entries against the previous std::map + std::list layout
+#include "bench.hpp"
+#include "lcore/lru.hpp"
+#include <list>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+/// @brief The std::map + std::list cache LRUCache used to be
+template <typename K, typename V>
+class MapListLRU {
+    struct Item {
+        V value;
+        typename std::list<K>::iterator lru_it;
+    };
+    std::size_t max_size;
+    std::list<K> lru_list;
+    std::map<K, Item> cache_map;
+public:
+    explicit MapListLRU(std::size_t max_size): max_size(max_size) {}
+    V* Get(const K& key) {
+        auto it = cache_map.find(key);
+        if (it == cache_map.end()) return nullptr;
+        lru_list.splice(lru_list.begin(), lru_list, it->second.lru_it);
+        return &it->second.value;
+    }
+    void Put(K key, V value) {
+        auto it = cache_map.find(key);
+        if (it != cache_map.end()) {
+            it->second.value = std::move(value);
+            lru_list.splice(lru_list.begin(), lru_list, it->second.lru_it);
+            return;
+        }
+        if (cache_map.size() >= max_size) {
+            cache_map.erase(lru_list.back());
+            lru_list.pop_back();
+        }
+        lru_list.push_front(key);
+        cache_map[key] = {std::move(value), lru_list.begin()};
+    }
+};
+
+template <typename Cache, typename Key>
+void Run(const char* name, const std::vector<Key>& keys, const std::vector<Key>& misses) {
+    constexpr std::size_t Entries = 1 << 20;
+    std::printf("== %s\n", name);
+    Cache cache(Entries);
+    bench::Measure("Put 1M new entries", keys.size(), [&] {
+        for (std::size_t i = 0; i < keys.size(); ++i) cache.Put(keys[i], i);
+    });
+
+    std::vector<std::size_t> order(keys.size());
+    std::mt19937_64 rng(7);
+    for (auto& i: order) i = rng() % keys.size();
+    bench::Measure("Get 1M random hits", order.size(), [&] {
+        std::size_t sum = 0;
+        for (auto i: order) sum += *cache.Get(keys[i]);
+        bench::DoNotOptimize(sum);
+    });
+    bench::Measure("Get 1M misses", misses.size(), [&] {
+        std::size_t found = 0;
+        for (auto& key: misses) found += cache.Get(key) != nullptr;
+        bench::DoNotOptimize(found);
+    });
+    bench::Measure("Put 1M evicting entries", misses.size(), [&] {
+        for (std::size_t i = 0; i < misses.size(); ++i) cache.Put(misses[i], i);
+    });
+}
+
+int main() {
+    constexpr std::size_t Entries = 1 << 20;
+    std::mt19937_64 rng(42);
+
+    std::vector<std::uint64_t> keys(Entries), misses(Entries);
+    for (std::size_t i = 0; i < Entries; ++i) {
+        keys[i] = rng();
+        misses[i] = rng();
+    }
+    Run<LRUCache<std::uint64_t, std::size_t>>("LRUCache<uint64_t>", keys, misses);
+    Run<MapListLRU<std::uint64_t, std::size_t>>("std::map + std::list <uint64_t>", keys, misses);
+
+    std::vector<std::string> skeys(Entries), smisses(Entries);
+    for (std::size_t i = 0; i < Entries; ++i) {
+        skeys[i] = "key/" + std::to_string(keys[i]);
+        smisses[i] = "key/" + std::to_string(misses[i]);
+    }
+    Run<LRUCache<std::string, std::size_t>>("LRUCache<std::string>", skeys, smisses);
+    Run<MapListLRU<std::string, std::size_t>>("std::map + std::list <std::string>", skeys, smisses);
+    return 0;
+}
@@ -0,0 +1,58 @@
+// Warm restart: reopening a MmapLRUCache against refilling an LRUCache, and the crash recovery scan
+#include "bench.hpp"
+#include "lcore/lru.hpp"
+#include "lcore/mmaplru.hpp"
+#include <filesystem>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+constexpr std::size_t Entries = 1 << 20;
+
+struct Value {
+    std::uint64_t words[8];
+};
+
+Value MakeValue(std::uint64_t key) {
+    Value value;
+    for (std::uint64_t& word: value.words) word = key++;
+    return value;
+}
+
+int main() {
+    using Cache = MmapLRUCache<std::uint64_t, Value>;
+    auto dir = std::filesystem::temp_directory_path();
+    std::string path = (dir / "lcore_bench_mmaplru.cache").string();
+    std::string image = (dir / "lcore_bench_mmaplru_crash.cache").string();
+    std::filesystem::remove(path);
+    std::filesystem::remove(image);
+
+    bench::Measure("LRUCache fill (cold start)", Entries, [] {
+        LRUCache<std::uint64_t, Value> cache(Entries);
+        for (std::uint64_t key = 0; key < Entries; ++key) cache.Put(key, MakeValue(key));
+        bench::DoNotOptimize(cache.Size());
+    });
+    bench::Measure("MmapLRUCache fill and sync", Entries, [&] {
+        Cache cache(path, Entries);
+        for (std::uint64_t key = 0; key < Entries; ++key) cache.Put(key, MakeValue(key));
+        cache.Put(0, MakeValue(1)); // Left dirty for the crash image
+        std::filesystem::copy_file(path, image);
+    });
+
+    bench::Measure("MmapLRUCache reopen", 1, [&] {
+        Cache cache(path, Entries);
+        bench::DoNotOptimize(cache.Size());
+    });
+    bench::Measure("MmapLRUCache reopen and read all", Entries, [&] {
+        Cache cache(path, Entries);
+        std::uint64_t sum = 0;
+        for (std::uint64_t key = 0; key < Entries; ++key) sum += cache.Peek(key)->words[0];
+        bench::DoNotOptimize(sum);
+    });
+    bench::Measure("MmapLRUCache recover after a crash", Entries, [&] {
+        Cache cache(image, Entries);
+        bench::DoNotOptimize(cache.Size());
+    });
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(image);
+}
@@ -0,0 +1,61 @@
+// Reassembling a 1 GiB stream from 1448-byte segments (one TCP MSS) delivered in order and shuffled
+#include "bench.hpp"
+#include "lcore/sparsebuffer.hpp"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+constexpr std::size_t StreamSize = std::size_t(1) << 30;
+constexpr std::size_t SegmentSize = 1448;
+constexpr std::size_t Segments = (StreamSize + SegmentSize - 1) / SegmentSize;
+
+int main() {
+    // Segment payloads are taken from a pattern, the stream itself is not kept twice in memory
+    std::vector<char> pattern(SparseBuffer<char>::page_size + SegmentSize);
+    for (std::size_t i = 0; i < pattern.size(); ++i) pattern[i] = static_cast<char>(i * 31);
+    auto replay = [&](const std::vector<std::size_t>& order) {
+        SparseBuffer<char> buffer;
+        for (std::size_t segment: order) {
+            std::size_t offset = segment * SegmentSize;
+            std::size_t size = std::min(SegmentSize, StreamSize - offset);
+            buffer.write(offset, std::span<const char>(pattern.data() + offset % buffer.page_size, size));
+        }
+        bench::DoNotOptimize(buffer.chunk_count());
+        if (buffer.chunk_count() != 1) std::printf("reassembly failed: %zu ranges\n", buffer.chunk_count());
+    };
+
+    std::vector<std::size_t> order(Segments);
+    std::iota(order.begin(), order.end(), 0);
+    bench::Measure("SparseBuffer write 1 GiB in order", Segments, [&] { replay(order); });
+
+    // Reordered within a window of 1024 segments, as a lossy network would
+    std::mt19937_64 random(42);
+    for (std::size_t begin = 0; begin < Segments; begin += 1024) {
+        std::shuffle(order.begin() + begin, order.begin() + std::min(begin + 1024, Segments), random);
+    }
+    bench::Measure("SparseBuffer write 1 GiB, windowed shuffle", Segments, [&] { replay(order); });
+
+    std::shuffle(order.begin(), order.end(), random);
+    bench::Measure("SparseBuffer write 1 GiB, full shuffle", Segments, [&] { replay(order); });
+
+    // A transfer of 100k segments with every other segment missing, picking its next request
+    constexpr std::size_t Transfer = 100000, Queries = 1 << 20;
+    SparseBuffer<char> transfer(Transfer * SegmentSize);
+    for (std::size_t segment = 0; segment < Transfer; segment += 2) {
+        transfer.write(segment * SegmentSize, std::span<const char>(pattern.data(), SegmentSize));
+    }
+    bench::Measure("SparseBuffer first_hole_after, 50k holes", Queries, [&] {
+        std::size_t sum = 0;
+        for (std::size_t i = 0; i < Queries; ++i) sum += transfer.first_hole_after(random() % transfer.size())->first;
+        bench::DoNotOptimize(sum);
+    });
+    bench::Measure("SparseBuffer is_complete, 50k holes", Queries, [&] {
+        std::size_t complete = 0;
+        for (std::size_t i = 0; i < Queries; ++i) complete += transfer.is_complete(random() % transfer.size(), SegmentSize / 2);
+        bench::DoNotOptimize(complete);
+    });
+    bench::Measure("SparseBuffer holes, 50k holes", 1, [&] { bench::DoNotOptimize(transfer.holes().size()); });
+}
@@ -0,0 +1,49 @@
+// A working set ten times the memory tier: skewed reads served from memory, the page cache or the disk tier
+#include "bench.hpp"
+#include "lcore/tieredcache.hpp"
+#include <filesystem>
+#include <random>
+#include <string>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+constexpr std::uint64_t Keys = 1 << 18;
+constexpr std::size_t MemoryEntries = Keys / 10;
+constexpr std::size_t Reads = 1 << 20;
+
+int main() {
+    using Cache = TieredCache<std::uint64_t, std::string>;
+    auto directory = std::filesystem::temp_directory_path() / "lcore_bench_tieredcache";
+    std::filesystem::remove_all(directory);
+    std::string value(256, 'v');
+    {
+        Cache cache(MemoryEntries, directory, std::uint64_t(1) << 30);
+        bench::Measure("TieredCache put (spilling 90%)", Keys, [&] {
+            for (std::uint64_t key = 0; key < Keys; ++key) cache.Put(key, value);
+            cache.Flush();
+        });
+
+        // 90% of the reads go to 10% of the keys
+        std::mt19937_64 random(42);
+        std::vector<std::uint64_t> keys(Reads);
+        for (std::uint64_t& key: keys) {
+            key = random() % 10 == 0 ? random() % Keys : random() % (Keys / 10);
+        }
+        bench::Measure("TieredCache get (skewed)", Reads, [&] {
+            std::size_t found = 0;
+            for (std::uint64_t key: keys) found += cache.Get(key) != nullptr;
+            bench::DoNotOptimize(found);
+        });
+        bench::Measure("TieredCache get (uniform, mostly disk)", Keys, [&] {
+            std::size_t found = 0;
+            for (std::uint64_t key = 0; key < Keys; ++key) found += cache.Get(random() % Keys) != nullptr;
+            bench::DoNotOptimize(found);
+        });
+        cache.FlushAll();
+    }
+    bench::Measure("TieredCache reopen (index rebuild)", Keys, [&] {
+        Cache cache(MemoryEntries, directory, std::uint64_t(1) << 30);
+        bench::DoNotOptimize(cache.DiskSize());
+    });
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,430 @@
+/**
+ * @file allocator.hpp
+ * @author liyanes(liyanes@outlook.com)
+ * @brief Memory resources and allocators: monotonic arena, size-class pools and pool allocator
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#pragma once
+#include "base.hpp"
+#include "class.hpp"
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+
+LCORE_NAMESPACE_BEGIN
+
+/// @brief Snapshot of the statistics of an allocator or memory resource
+struct AllocatorStats {
+    std::size_t allocations = 0;        ///< Number of allocations served
+    std::size_t deallocations = 0;      ///< Number of deallocations served
+    std::size_t bytes_in_use = 0;       ///< Bytes currently handed out to users
+    std::size_t peak_bytes_in_use = 0;  ///< Highest value of bytes_in_use
+    std::size_t bytes_reserved = 0;     ///< Bytes obtained from the upstream, or the system for the size-class pools
+};
+
+/// @brief Standard allocator on top of a memory resource (MonotonicArena, SizeClassAllocator...)
+template <typename T>
+using ResourceAllocator = std::pmr::polymorphic_allocator<T>;
+
+namespace detail {
+
+/// @brief Counters behind AllocatorStats
+/// @tparam Counter The counter type, std::atomic<size_t> for thread-safe resources, size_t otherwise
+template <typename Counter>
+class AllocatorCounters {
+    Counter allocations = 0;
+    Counter deallocations = 0;
+    Counter in_use = 0;
+    Counter peak = 0;
+    Counter reserved = 0;
+
+    static constexpr bool IsAtomic = !Same<Counter, std::size_t>;
+
+    static std::size_t Load(const Counter& c) noexcept {
+        if constexpr (IsAtomic) return c.load(std::memory_order_relaxed);
+        else return c;
+    }
+    static std::size_t Add(Counter& c, std::size_t n) noexcept {
+        if constexpr (IsAtomic) return c.fetch_add(n, std::memory_order_relaxed) + n;
+        else return c += n;
+    }
+    static void Sub(Counter& c, std::size_t n) noexcept {
+        if constexpr (IsAtomic) c.fetch_sub(n, std::memory_order_relaxed);
+        else c -= n;
+    }
+public:
+    void OnAllocate(std::size_t bytes) noexcept {
+        Add(allocations, 1);
+        auto now = Add(in_use, bytes);
+        if constexpr (IsAtomic) {
+            auto old = peak.load(std::memory_order_relaxed);
+            while (old < now && !peak.compare_exchange_weak(old, now, std::memory_order_relaxed)) {}
+        } else {
+            if (peak < now) peak = now;
+        }
+    }
+    void OnDeallocate(std::size_t bytes) noexcept {
+        Add(deallocations, 1);
+        Sub(in_use, bytes);
+    }
+    void OnReserve(std::size_t bytes) noexcept { Add(reserved, bytes); }
+    void OnRelease(std::size_t bytes) noexcept { Sub(reserved, bytes); }
+    void OnReleaseAll() noexcept {
+        if constexpr (IsAtomic) in_use.store(0, std::memory_order_relaxed);
+        else in_use = 0;
+    }
+
+    AllocatorStats Snapshot() const noexcept {
+        return AllocatorStats{
+            Load(allocations), Load(deallocations), Load(in_use), Load(peak), Load(reserved)
+        };
+    }
+};
+
+/// @brief Size classes served by the block pools
+/// 16-byte steps up to 256 bytes, then four classes per power of two up to MaxSize
+struct SizeClass: public StaticClass {
+    static constexpr std::size_t Granularity = 16;
+    static constexpr std::size_t MaxSize = 4096;
+    static constexpr std::size_t Count = 32;
+
+    static constexpr std::size_t Index(std::size_t bytes) noexcept {
+        if (bytes <= 256) return bytes == 0 ? 0 : (bytes - 1) / Granularity;
+        std::size_t p = std::bit_width(bytes - 1) - 1; // floor(log2(bytes - 1)), >= 8
+        return 16 + (p - 8) * 4 + (((bytes - 1) - (std::size_t(1) << p)) >> (p - 2));
+    }
+    static constexpr std::size_t Size(std::size_t index) noexcept {
+        if (index < 16) return (index + 1) * Granularity;
+        std::size_t p = 8 + (index - 16) / 4;
+        return (std::size_t(1) << p) + ((index - 16) % 4 + 1) * (std::size_t(1) << (p - 2));
+    }
+    static constexpr bool Fits(std::size_t bytes, std::size_t alignment) noexcept {
+        return bytes <= MaxSize && alignment <= alignof(std::max_align_t);
+    }
+};
+
+static_assert(SizeClass::Index(SizeClass::MaxSize) == SizeClass::Count - 1);
+static_assert(SizeClass::Size(SizeClass::Count - 1) == SizeClass::MaxSize);
+
+struct BlockFreeNode {
+    BlockFreeNode* next;
+};
+
+/// @brief Per-thread cache of free blocks, flushed back to the shared lists on thread exit
+struct BlockThreadCache {
+    BlockFreeNode* heads[SizeClass::Count] = {};
+    std::uint32_t counts[SizeClass::Count] = {};
+
+    inline ~BlockThreadCache();
+};
+
+/// @brief Process-wide free lists of fixed-size blocks, one per size class
+/// Blocks are carved from chunks of the global operator new which are kept for the whole process lifetime,
+/// the free lists are shared by every SizeClassAllocator / PoolAllocator.
+class BlockPools: public StaticClass {
+    friend struct BlockThreadCache;
+public:
+    using FreeNode = BlockFreeNode;
+
+    static constexpr std::size_t ChunkSize = 64 * 1024;
+
+    using ThreadCache = BlockThreadCache;
+
+    /// @brief Maximum number of cached blocks of a size class per thread
+    static constexpr std::uint32_t CacheLimit(std::size_t index) noexcept {
+        auto n = ChunkSize / SizeClass::Size(index) / 2;
+        return std::uint32_t(n < 8 ? 8 : (n > 256 ? 256 : n));
+    }
+
+    /// @brief Get a block of the given class, the thread cache is refilled on demand
+    /// @param reserved Set to the number of bytes newly obtained from the system, if any
+    static void* Allocate(std::size_t index, std::size_t& reserved) {
+        reserved = 0;
+        if (t_cacheDestroyed) [[unlikely]] {
+            // Called from the destructor of another thread_local, the spare cache goes back to the shared lists
+            ThreadCache spare;
+            reserved = Pools()[index].Refill(spare, index);
+            auto node = spare.heads[index];
+            spare.heads[index] = node->next;
+            --spare.counts[index];
+            return node;
+        }
+        auto& cache = t_cache;
+        if (!cache.heads[index]) reserved = Pools()[index].Refill(cache, index);
+        auto node = cache.heads[index];
+        cache.heads[index] = node->next;
+        --cache.counts[index];
+        return node;
+    }
+
+    /// @brief Return a block of the given class to the thread cache
+    static void Deallocate(void* p, std::size_t index) noexcept {
+        auto node = static_cast<FreeNode*>(p);
+        if (t_cacheDestroyed) [[unlikely]] {
+            node->next = nullptr;
+            Pools()[index].Push(node, 1);
+            return;
+        }
+        auto& cache = t_cache;
+        node->next = cache.heads[index];
+        cache.heads[index] = node;
+        if (++cache.counts[index] > CacheLimit(index)) {
+            // Give half of the cached blocks back so that other threads can reuse them
+            std::uint32_t keep = CacheLimit(index) / 2;
+            FreeNode* tail = cache.heads[index];
+            for (std::uint32_t i = 1; i < keep; ++i) tail = tail->next;
+            FreeNode* rest = tail->next;
+            tail->next = nullptr;
+            Pools()[index].Push(rest, cache.counts[index] - keep);
+            cache.counts[index] = keep;
+        }
+    }
+private:
+    class Pool {
+        std::mutex mutex;
+        FreeNode* head = nullptr;
+        std::size_t count = 0;
+    public:
+        void Push(FreeNode* list, std::size_t n) noexcept {
+            FreeNode* tail = list;
+            while (tail->next) tail = tail->next;
+            std::lock_guard<std::mutex> lock(mutex);
+            tail->next = head;
+            head = list;
+            count += n;
+        }
+
+        /// @return The number of bytes obtained from the system
+        std::size_t Refill(ThreadCache& cache, std::size_t index) {
+            const std::size_t size = SizeClass::Size(index);
+            const std::uint32_t batch = CacheLimit(index) / 2;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (head) {
+                    FreeNode* list = head;
+                    FreeNode* tail = head;
+                    std::uint32_t n = 1;
+                    while (n < batch && tail->next) { tail = tail->next; ++n; }
+                    head = tail->next;
+                    count -= n;
+                    tail->next = cache.heads[index];
+                    cache.heads[index] = list;
+                    cache.counts[index] += n;
+                    return 0;
+                }
+            }
+            // Carve a new chunk, the whole chunk goes to this thread
+            std::size_t chunkSize = ChunkSize < size * 8 ? size * 8 : ChunkSize;
+            auto chunk = static_cast<char*>(::operator new(chunkSize));
+            std::size_t n = chunkSize / size;
+            for (std::size_t i = n; i-- > 0;) {
+                auto node = reinterpret_cast<FreeNode*>(chunk + i * size);
+                node->next = cache.heads[index];
+                cache.heads[index] = node;
+            }
+            cache.counts[index] += std::uint32_t(n);
+            return chunkSize;
+        }
+    };
+
+    static Pool* Pools() noexcept {
+        static Pool pools[SizeClass::Count];
+        return pools;
+    }
+
+    static inline thread_local ThreadCache t_cache;
+    static inline thread_local bool t_cacheDestroyed = false; ///< t_cache is gone, the thread is exiting
+};
+
+inline BlockThreadCache::~BlockThreadCache() {
+    BlockPools::t_cacheDestroyed = true; // Only t_cache, and the spare caches of the exiting thread, are destroyed
+    for (std::size_t i = 0; i < SizeClass::Count; ++i) {
+        if (counts[i]) BlockPools::Pools()[i].Push(heads[i], counts[i]);
+        heads[i] = nullptr;
+        counts[i] = 0;
+    }
+}
+
+}
+
+/// @brief A memory resource that only grows, deallocation is a no-op until Release() or destruction
+/// Allocation is a pointer bump inside the current block, blocks grow geometrically.
+/// This resource is not thread-safe, use one arena per thread (or per request).
+class MonotonicArena: public std::pmr::memory_resource {
+    struct BlockHeader {
+        BlockHeader* next;
+        std::size_t size; ///< Size of the whole block, including this header
+    };
+
+    std::pmr::memory_resource* m_upstream;
+    BlockHeader* m_blocks = nullptr;
+    char* m_current = nullptr;
+    char* m_end = nullptr;
+    std::size_t m_nextBlockSize;
+    char* m_initialBuffer = nullptr;
+    std::size_t m_initialSize = 0;
+    detail::AllocatorCounters<std::size_t> m_counters;
+
+    void NewBlock(std::size_t bytes, std::size_t alignment) {
+        std::size_t need = sizeof(BlockHeader) + bytes + alignment;
+        std::size_t size = m_nextBlockSize;
+        while (size < need) size *= 2;
+        auto block = static_cast<BlockHeader*>(m_upstream->allocate(size, alignof(std::max_align_t)));
+        block->next = m_blocks;
+        block->size = size;
+        m_blocks = block;
+        m_current = reinterpret_cast<char*>(block + 1);
+        m_end = reinterpret_cast<char*>(block) + size;
+        m_nextBlockSize = size * 2;
+        m_counters.OnReserve(size);
+    }
+public:
+    static constexpr std::size_t DefaultBlockSize = 4096;
+
+    /// @brief Construct an arena whose first block has the given size
+    explicit MonotonicArena(std::size_t initialBlockSize = DefaultBlockSize,
+                            std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : m_upstream(upstream), m_nextBlockSize(initialBlockSize < 64 ? 64 : initialBlockSize) {}
+    /// @brief Construct an arena that first uses the given buffer, then falls back to the upstream
+    MonotonicArena(void* buffer, std::size_t size,
+                   std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : m_upstream(upstream), m_current(static_cast<char*>(buffer)), m_end(static_cast<char*>(buffer) + size),
+          m_nextBlockSize(size < DefaultBlockSize ? DefaultBlockSize : size * 2),
+          m_initialBuffer(static_cast<char*>(buffer)), m_initialSize(size) {}
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+    ~MonotonicArena() override { Release(); }
+
+    /// @brief Give every block back to the upstream, all memory handed out becomes invalid
+    void Release() noexcept {
+        while (m_blocks) {
+            auto next = m_blocks->next;
+            m_counters.OnRelease(m_blocks->size);
+            m_upstream->deallocate(m_blocks, m_blocks->size, alignof(std::max_align_t));
+            m_blocks = next;
+        }
+        m_current = m_initialBuffer;
+        m_end = m_initialBuffer ? m_initialBuffer + m_initialSize : nullptr;
+        m_counters.OnReleaseAll();
+    }
+
+    /// @brief Get the statistics of this arena
+    AllocatorStats Stats() const noexcept { return m_counters.Snapshot(); }
+    /// @brief Get the upstream resource
+    std::pmr::memory_resource* Upstream() const noexcept { return m_upstream; }
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        auto p = reinterpret_cast<std::uintptr_t>(m_current);
+        auto aligned = (p + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+        if (!m_current || aligned + bytes > reinterpret_cast<std::uintptr_t>(m_end)) {
+            NewBlock(bytes, alignment);
+            p = reinterpret_cast<std::uintptr_t>(m_current);
+            aligned = (p + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+        }
+        m_current = reinterpret_cast<char*>(aligned + bytes);
+        m_counters.OnAllocate(bytes);
+        return reinterpret_cast<void*>(aligned);
+    }
+    void do_deallocate(void*, std::size_t bytes, std::size_t) override {
+        // Memory is only reclaimed by Release()
+        m_counters.OnDeallocate(bytes);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+/// @brief A thread-safe memory resource serving small blocks from per-size-class free lists
+/// Each thread keeps a cache of free blocks per size class, so the hot path takes no lock.
+/// The free lists are global (see detail::BlockPools): every instance shares them, and their chunks are never
+/// given back, so an instance only holds its statistics. Requests larger than detail::SizeClass::MaxSize
+/// (or over-aligned) go to the global operator new.
+class SizeClassAllocator: public std::pmr::memory_resource {
+    detail::AllocatorCounters<std::atomic<std::size_t>> m_counters;
+public:
+    SizeClassAllocator() noexcept = default;
+    SizeClassAllocator(const SizeClassAllocator&) = delete;
+    SizeClassAllocator& operator=(const SizeClassAllocator&) = delete;
+
+    /// @brief The process-wide instance, used by PoolAllocator
+    static SizeClassAllocator& Default() noexcept {
+        static SizeClassAllocator instance;
+        return instance;
+    }
+
+    /// @brief Allocate without going through the virtual memory_resource interface
+    void* Allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) {
+        void* p;
+        if (detail::SizeClass::Fits(bytes, alignment)) {
+            std::size_t reserved;
+            p = detail::BlockPools::Allocate(detail::SizeClass::Index(bytes), reserved);
+            if (reserved) m_counters.OnReserve(reserved);
+        } else {
+            p = ::operator new(bytes, std::align_val_t(alignment));
+        }
+        m_counters.OnAllocate(bytes);
+        return p;
+    }
+    /// @brief Deallocate without going through the virtual memory_resource interface
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) noexcept {
+        m_counters.OnDeallocate(bytes);
+        if (detail::SizeClass::Fits(bytes, alignment)) {
+            detail::BlockPools::Deallocate(p, detail::SizeClass::Index(bytes));
+        } else {
+            ::operator delete(p, bytes, std::align_val_t(alignment));
+        }
+    }
+
+    /// @brief Get the statistics of this resource
+    /// bytes_reserved counts the chunks carved while serving this resource, they are shared by all instances
+    AllocatorStats Stats() const noexcept { return m_counters.Snapshot(); }
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        return Allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        Deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        // Every instance allocates from the same pools
+        return dynamic_cast<const SizeClassAllocator*>(&other) != nullptr;
+    }
+};
+
+/// @brief Stateless standard allocator drawing single objects from the fixed-size free list of sizeof(T)
+/// Array allocations use the matching size class or the global operator new, so it is usable by any std container.
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(SizeClassAllocator::Default().Allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept {
+        SizeClassAllocator::Default().Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    /// @brief The memory resource behind every PoolAllocator
+    static std::pmr::memory_resource* Resource() noexcept { return &SizeClassAllocator::Default(); }
+    /// @brief Statistics of the shared resource
+    static AllocatorStats Stats() noexcept { return SizeClassAllocator::Default().Stats(); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+};
+
+LCORE_NAMESPACE_END
@@ -0,0 +1,217 @@
+/**
+ * @file loadingcache.hpp
+ * @brief A cache loading its missing entries asynchronously, one load per key at a time
+ */
+#pragma once
+#include "base.hpp"
+#include "task.hpp"
+#include "lcore/exception.hpp"
+#include "lcore/lru.hpp"
+#include "lcore/memory.hpp"
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+LCORE_ASYNC_NAMESPACE_BEGIN
+
+/**
+ * @brief A cache whose misses are filled by coroutine loaders, concurrent misses on a key share a single load
+ *
+ * The first GetOrLoad missing a key starts the loader, the following ones wait for the same load instead of
+ * starting their own. The waiting coroutines suspend (co_await std::suspend_always) and drive the load each time
+ * the executor resumes them, as JoinSet does: the cache and its waiters must run on the same thread.
+ *
+ * A failed load is reported to all its waiters and forgotten: the next GetOrLoad loads again,
+ * unless SetCacheFailures() asks to remember the failures.
+ * @tparam Cache The underlying cache of the loaded values, an LRUCache<K, V, ...>.
+ * With a CacheStatsCounter, each load (a GetOrLoad miss or a GetAll batch) records its time
+ */
+template <typename K, typename V, typename Cache = LRUCache<K, V>>
+class AsyncLoadingCache {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    using CacheType = Cache;
+private:
+    /// @brief A load in progress, of one key for GetOrLoad or of all the missing keys of a GetAll
+    struct Flight {
+        std::vector<K> keys;
+        Task<std::vector<V>> task;
+        std::vector<V> values;
+        std::exception_ptr error;
+        bool finished = false;
+        std::chrono::steady_clock::time_point start; // Set if the cache records stats
+    };
+    struct Waiting {
+        Ptr<Flight> flight;
+        std::size_t position;
+    };
+
+    static constexpr bool Recording = Cache::StatsRecorderType::Enabled;
+
+    Cache cache;
+    LRUCache<K, std::exception_ptr> failures{0};
+    std::unordered_map<K, Waiting> flights;
+
+    // The loaders are kept in the frames of these coroutines: the task of a lambda loader refers to its captures
+    template <typename Loader>
+    static Task<std::vector<V>> LoadOne(Loader loader, const K& key) {
+        std::vector<V> values;
+        values.push_back(co_await loader(key));
+        co_return values;
+    }
+    template <typename BatchLoader>
+    static Task<std::vector<V>> LoadBatch(BatchLoader loader, const std::vector<K>& keys) {
+        co_return co_await loader(keys);
+    }
+
+    /// @brief Register the flight of keys and start its load, a loader throwing before its first suspension fails the flight
+    template <typename Start>
+    Ptr<Flight> Launch(std::vector<K> keys, Start&& start) {
+        Ptr<Flight> flight = MakePtr<Flight>();
+        flight->keys = std::move(keys);
+        for (std::size_t i = 0; i < flight->keys.size(); ++i) flights[flight->keys[i]] = Waiting{flight, i};
+        if constexpr (Recording) flight->start = std::chrono::steady_clock::now();
+        try {
+            flight->task = start(flight->keys); // The keys do not move, a loader may keep a reference
+        } catch (...) {
+            Finish(*flight, std::current_exception());
+        }
+        return flight;
+    }
+    /// @brief Drive the load one step, on completion cache the result and release the keys
+    void Poll(Flight& flight) {
+        if (flight.finished) return;
+        if (!flight.task.done()) flight.task.resume();
+        if (!flight.task.done()) return;
+        std::exception_ptr error;
+        try {
+            flight.values = std::move(flight.task).consume_value();
+            if (flight.values.size() != flight.keys.size()) {
+                throw RuntimeError("AsyncLoadingCache: the loader returned a different number of values than keys");
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        Finish(flight, error);
+    }
+    void Finish(Flight& flight, std::exception_ptr error) {
+        flight.finished = true;
+        flight.error = error;
+        if constexpr (Recording) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - flight.start);
+            cache.Recorder().RecordLoad(static_cast<std::uint64_t>(elapsed.count()), !error);
+        }
+        for (std::size_t i = 0; i < flight.keys.size(); ++i) {
+            const K& key = flight.keys[i];
+            auto it = flights.find(key);
+            if (it != flights.end() && &*it->second.flight == &flight) flights.erase(it);
+            if (error) {
+                if (failures.MaxSize() > 0) failures.Put(key, error);
+            } else {
+                cache.Put(key, flight.values[i]);
+            }
+        }
+        flight.task = {};
+    }
+    Task<void> Wait(Flight& flight) {
+        while (!flight.finished) {
+            co_await std::suspend_always();
+            Poll(flight);
+        }
+    }
+public:
+    /// @param args Forwarded to the constructor of the underlying cache, e.g. its maximum size
+    template <typename... Args>
+    explicit AsyncLoadingCache(Args&&... args): cache(std::forward<Args>(args)...) {}
+    AsyncLoadingCache(const AsyncLoadingCache&) = delete;
+    AsyncLoadingCache& operator=(const AsyncLoadingCache&) = delete;
+
+    /**
+     * @brief Get the value of key, loading it on a miss
+     * @param loader Called as loader(key), returns a Task<V>. Only called if no load of the key is in progress
+     * @throw The exception of the load, or of the cached failure
+     */
+    template <typename Loader>
+    Task<V> GetOrLoad(K key, Loader loader) {
+        if (auto value = cache.Get(key)) co_return *value;
+        if (auto failure = failures.Get(key)) std::rethrow_exception(*failure);
+        Waiting waiting;
+        if (auto it = flights.find(key); it != flights.end()) {
+            waiting = it->second;
+        } else {
+            waiting = Waiting{Launch({key}, [&loader](const std::vector<K>& keys) { return LoadOne(std::move(loader), keys[0]); }), 0};
+        }
+        co_await Wait(*waiting.flight);
+        if (waiting.flight->error) std::rethrow_exception(waiting.flight->error);
+        co_return waiting.flight->values[waiting.position];
+    }
+
+    /**
+     * @brief Get the values of keys, loading all the misses with a single loader call
+     * @param loader Called as loader(const std::vector<K>& missing), returns a Task<std::vector<V>> of the values in the same order.
+     * The keys being loaded by other calls are not passed again, they are waited for
+     * @return The values in the order of keys
+     * @throw The first exception of the loads the keys depend on
+     */
+    template <typename BatchLoader>
+    Task<std::vector<V>> GetAll(std::vector<K> keys, BatchLoader loader) {
+        std::vector<std::optional<V>> found(keys.size());
+        std::vector<Waiting> waiting(keys.size());
+        std::vector<K> missing;
+        std::unordered_map<K, std::size_t> missing_positions;
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            if (auto value = cache.Get(keys[i])) {
+                found[i].emplace(*value);
+            } else if (auto failure = failures.Get(keys[i])) {
+                std::rethrow_exception(*failure);
+            } else if (auto it = flights.find(keys[i]); it != flights.end()) {
+                waiting[i] = it->second;
+            } else if (missing_positions.emplace(keys[i], missing.size()).second) {
+                missing.push_back(keys[i]);
+            }
+        }
+        if (!missing.empty()) {
+            Ptr<Flight> batch = Launch(std::move(missing), [&loader](const std::vector<K>& keys) { return LoadBatch(std::move(loader), keys); });
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                if (!found[i] && !waiting[i].flight) waiting[i] = Waiting{batch, missing_positions[keys[i]]};
+            }
+        }
+
+        std::vector<V> values;
+        values.reserve(keys.size());
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            if (found[i]) {
+                values.push_back(std::move(*found[i]));
+                continue;
+            }
+            Flight& flight = *waiting[i].flight;
+            co_await Wait(flight);
+            if (flight.error) std::rethrow_exception(flight.error);
+            values.push_back(flight.values[waiting[i].position]);
+        }
+        co_return values;
+    }
+
+    /// @brief Remember up to max_failures failed keys, their GetOrLoad fail without loading until Invalidate or Put. 0 disables
+    void SetCacheFailures(std::size_t max_failures) {
+        failures = LRUCache<K, std::exception_ptr>(max_failures);
+    }
+
+    void Put(K key, V value) {
+        failures.Erase(key);
+        cache.Put(std::move(key), std::move(value));
+    }
+    /// @brief Drop the cached value or failure of key, a load in progress is not cancelled
+    void Invalidate(const K& key) {
+        failures.Erase(key);
+        cache.Erase(key);
+    }
+    /// @brief Get the number of keys being loaded
+    std::size_t Loading() const noexcept { return flights.size(); }
+    Cache& Underlying() noexcept { return cache; }
+};
+
+LCORE_ASYNC_NAMESPACE_END
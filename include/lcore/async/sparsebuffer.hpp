@@ -0,0 +1,34 @@
+/**
+ * @file sparsebuffer.hpp
+ * @brief Awaiting the data of a ConcurrentSparseBuffer
+ */
+#pragma once
+#include "base.hpp"
+#include "task.hpp"
+#include "lcore/concurrentsparsebuffer.hpp"
+#include <coroutine>
+#include <cstdint>
+
+LCORE_ASYNC_NAMESPACE_BEGIN
+
+/**
+ * @brief Complete once [pos, pos + size) of a buffer is entirely written, e.g. to stream a download as it arrives
+ *
+ * The task suspends (co_await std::suspend_always) until the executor resumes it, and checks the range again
+ * only when the version of the buffer changed: waiting costs an atomic load per resume while nothing is written.
+ * The writers may run on other threads, the buffer must outlive the task.
+ */
+template <typename T, std::size_t PageBytes>
+Task<void> WaitForRange(const ConcurrentSparseBuffer<T, PageBytes>& buffer, std::size_t pos, std::size_t size) {
+    std::uint64_t seen = buffer.version();
+    if (buffer.has_data(pos, size)) co_return;
+    for (;;) {
+        co_await std::suspend_always();
+        std::uint64_t version = buffer.version();
+        if (version == seen) continue;
+        seen = version;
+        if (buffer.has_data(pos, size)) co_return;
+    }
+}
+
+LCORE_ASYNC_NAMESPACE_END
@@ -140,7 +140,7 @@ public:
     }
 protected:
     TaskType<IntType> Overflow(IntType c = Traits::eof()) override {
-        this->_buffer->ReAlloc();
+        this->_buffer->Reserve(this->buffer.current - this->buffer.begin + 2);
         if (c != Traits::eof()) {
             *this->buffer.current++ = Traits::to_char_type(c);
             this->_buffer->OnLengthChanged(this->buffer.current - this->buffer.begin);
@@ -151,7 +151,7 @@ public:
     TaskType<std::streamsize> SPutN(const CharType* s, std::streamsize n) override {
         if (this->buffer.current + n > this->buffer.end) {
             // Not enough space, reallocate
-            this->_buffer->ReAlloc(this->buffer.current - this->buffer.begin + n + 1);
+            this->_buffer->Reserve(this->buffer.current - this->buffer.begin + n + 1);
         }
         std::copy(s, s + n, this->buffer.current);
         this->buffer.current += n;
@@ -2,9 +2,11 @@
 #include "base.hpp"
 #include "lcore/class.hpp"
 #include "traits.hpp"
+#include "lcore/memstats.hpp"
 #include <coroutine>
 #include <utility>
 #include <optional>
+#include <type_traits>
 
 LCORE_ASYNC_NAMESPACE_BEGIN
 
@@ -21,6 +23,44 @@ public:
 template <typename T, typename SuspendHandleType = SuspendHandler<>>
 class Promise;
 
+namespace detail {
+
+/**
+ * @brief Links a task to the task it is awaiting
+ *
+ * Executors resume the outermost task of a chain of co_await: Task::resume() follows the links
+ * down to the innermost unfinished task, so a task awaiting another one that suspends is not resumed early.
+ */
+struct TaskLink {
+    std::coroutine_handle<> self{};
+    TaskLink* parent = nullptr;
+    TaskLink* child = nullptr;
+
+    /// @brief Get the innermost unfinished task awaited by this one, or this one
+    std::coroutine_handle<> Innermost() const noexcept {
+        const TaskLink* link = this;
+        while (link->child) link = link->child;
+        return link->self;
+    }
+    void ResumeInnermost() {
+        Innermost().resume();
+    }
+    /// @brief Record that the awaiting coroutine is suspended on this task
+    template <typename ParentPromise>
+    void LinkParent(std::coroutine_handle<ParentPromise> awaiting) noexcept {
+        if constexpr (std::is_base_of_v<TaskLink, ParentPromise>) {
+            parent = &awaiting.promise();
+            parent->child = this;
+        }
+    }
+    void UnlinkParent() noexcept {
+        if (parent) parent->child = nullptr;
+        parent = nullptr;
+    }
+};
+
+}
+
 template <typename T, typename SuspendHandlerType = SuspendHandler<>, typename PromiseType = Promise<T, SuspendHandlerType>>
 class Task;
 
@@ -28,7 +68,7 @@ template <typename T>
 using DefaultTaskWrapper = Task<T, SuspendHandler<>>;
 
 template <typename T, typename SuspendHandleType>
-class Promise: public SuspendHandleType {
+class Promise: public SuspendHandleType, public detail::TaskLink, public LCORE_NAMESPACE_NAME::detail::MemStatsTagged<MemSubsystem::Coroutine> {
 public:
     using value_type = T;
     using promise_type = Promise<T, SuspendHandleType>;
@@ -39,6 +79,7 @@ public:
 
     template <template <typename> typename TaskType = DefaultTaskWrapper>
     TaskType<T> get_return_object(){
+        this->self = handle_type::from_promise(*this);
         return TaskType<T>(handle_type::from_promise(*this));
     }
 
@@ -46,6 +87,7 @@ public:
         bool await_ready() const noexcept { return false; }
         void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
             auto& p = h.promise();
+            p.UnlinkParent();
             if (p.continuation) p.continuation.resume();
         }
         void await_resume() noexcept {}
@@ -116,7 +158,7 @@ private:
 };
 
 template <typename SuspendHandleType>
-class Promise<void, SuspendHandleType>: public SuspendHandleType {
+class Promise<void, SuspendHandleType>: public SuspendHandleType, public detail::TaskLink, public LCORE_NAMESPACE_NAME::detail::MemStatsTagged<MemSubsystem::Coroutine> {
 public:
     using value_type = void;
     using promise_type = Promise<void, SuspendHandleType>;
@@ -127,6 +169,7 @@ public:
 
     template <template <typename> typename TaskType = DefaultTaskWrapper>
     TaskType<void> get_return_object(){
+        this->self = handle_type::from_promise(*this);
         return TaskType<void>(handle_type::from_promise(*this));
     }
 
@@ -134,6 +177,7 @@ public:
         bool await_ready() const noexcept { return false; }
         void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
             auto& p = h.promise();
+            p.UnlinkParent();
             if (p.continuation) p.continuation.resume();
         }
         void await_resume() noexcept {}
@@ -211,20 +255,22 @@ public:
         if(handle) handle.destroy();
     }
 
+    struct awaiter {
+        std::coroutine_handle<promise_type> handle;
+        bool await_ready() const noexcept {
+            return !handle || handle.done();
+        }
+        template <typename AwaitingPromise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<AwaitingPromise> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            handle.promise().LinkParent(awaiting);
+            return handle.promise().Innermost(); // The task may itself be suspended on another one
+        }
+        T await_resume() {
+            return std::move(handle.promise()).consume_value_or_exception();
+        }
+    };
     auto operator co_await() && noexcept {
-        struct awaiter {
-            std::coroutine_handle<promise_type> handle;
-            bool await_ready() const noexcept {
-                return !handle || handle.done();
-            }
-            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
-                handle.promise().continuation = awaiting;
-                return handle;
-            }
-            T await_resume() {
-                return std::move(handle.promise()).consume_value_or_exception();
-            }
-        };
         return awaiter{handle};
     }
 
@@ -232,12 +278,13 @@ public:
         return handle.promise().ref_value_or_exception();
     }
     T consume_value() && requires MoveConstructible<T> {
-        return handle.promise().consume_value_or_exception();
+        return std::move(handle.promise()).consume_value_or_exception();
     }
     bool done() const noexcept { return !handle || handle.done(); }
     bool is_exception() { return handle.promise().has_exception(); }
     std::exception_ptr get_exception() { return handle.promise().get_exception(); }
-    void resume() { if(handle) handle.resume(); }
+    /// @brief Resume the task, or the innermost task it is awaiting
+    void resume() { if(handle) handle.promise().ResumeInnermost(); }
 };
 
 template <typename SuspendHandlerType, typename PromiseType>
@@ -274,20 +321,22 @@ public:
         if(handle) handle.destroy();
     }
 
+    struct awaiter {
+        std::coroutine_handle<promise_type> handle;
+        bool await_ready() const noexcept {
+            return !handle || handle.done();
+        }
+        template <typename AwaitingPromise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<AwaitingPromise> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            handle.promise().LinkParent(awaiting);
+            return handle.promise().Innermost(); // The task may itself be suspended on another one
+        }
+        void await_resume() {
+            handle.promise().get_value_or_exception();
+        }
+    };
     auto operator co_await() && noexcept {
-        struct awaiter {
-            std::coroutine_handle<promise_type> handle;
-            bool await_ready() const noexcept {
-                return !handle || handle.done();
-            }
-            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
-                handle.promise().continuation = awaiting;
-                return handle;
-            }
-            void await_resume() {
-                handle.promise().get_value_or_exception();
-            }
-        };
         return awaiter{handle};
     }
 
@@ -297,7 +346,8 @@ public:
     bool done() const noexcept { return !handle || handle.done(); }
     bool is_exception() { return handle.promise().has_exception(); }
     std::exception_ptr get_exception() { return handle.promise().get_exception(); }
-    void resume() { if(handle) handle.resume(); }
+    /// @brief Resume the task, or the innermost task it is awaiting
+    void resume() { if(handle) handle.promise().ResumeInnermost(); }
 };
 
 LCORE_ASYNC_NAMESPACE_END
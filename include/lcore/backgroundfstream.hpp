@@ -0,0 +1,268 @@
+/**
+ * @file backgroundfstream.hpp
+ * @brief An output file stream whose writes run on a background thread
+ */
+#pragma once
+#include "base.hpp"
+#include "fstream.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+LCORE_NAMESPACE_BEGIN
+
+/// @brief When a background stream waits for its data to reach the disk
+enum class FsyncPolicy {
+    Never,       ///< Leave it to the system
+    OnSync,      ///< In Sync(), after the buffers are written
+    EveryBuffer, ///< After each buffer is written, on the writer thread
+};
+
+/**
+ * @brief An output stream buffer that hands its full buffers to a writer thread
+ *
+ * The producer fills one of several large buffers. A full buffer is queued for the writer thread, and the producer
+ * goes on in a free one: it only blocks when every buffer is queued or being written, so a latency spike
+ * of the disk stalls the producer once the buffers are exhausted, not on each write.
+ * Sync() is a barrier: it returns once everything put before it is written, and synced to the disk unless the
+ * policy is FsyncPolicy::Never. Seeking syncs first. A write error is kept, and reported by Sync() and the later puts.
+ * @note Not thread-safe for several producers, the writer thread is the only other thread touching the handler
+ */
+template <typename CharT, typename Traits = std::char_traits<CharT>, typename Handler = DefaultFileHandler>
+class BasicBackgroundOFStreamBuffer: public BasicOStreamBuffer<CharT, Traits> {
+public:
+    using CharType = typename BasicOStreamBuffer<CharT, Traits>::CharType;
+    using TraitsType = typename BasicOStreamBuffer<CharT, Traits>::TraitsType;
+    using IntType = typename BasicOStreamBuffer<CharT, Traits>::IntType;
+    using PosType = typename BasicOStreamBuffer<CharT, Traits>::PosType;
+    using OffType = typename BasicOStreamBuffer<CharT, Traits>::OffType;
+
+    static constexpr size_t DefaultBufferSize = 1024 * 1024 / sizeof(CharType); ///< Default size of a buffer, in characters
+    static constexpr size_t DefaultBufferCount = 4;
+private:
+    /// @brief A full buffer waiting for the writer
+    struct Block {
+        CharType* data;
+        std::size_t size; ///< In characters
+        std::streamoff offset; ///< In the file
+    };
+
+    Handler* _fileHandler;
+    std::size_t _bufferSize; ///< Size of a buffer, in characters
+    FsyncPolicy _policy;
+    std::vector<std::unique_ptr<CharType[]>> _buffers;
+    std::streamsize _writePos = 0; ///< Position in the file of the beginning of the current buffer
+    std::mutex _mutex; // Of the fields below, shared with the writer
+    std::condition_variable _wake;    // The writer has work, or must stop
+    std::condition_variable _drained; // The writer freed a buffer
+    std::deque<Block> _queue;
+    std::vector<CharType*> _free;
+    bool _writing = false;
+    bool _stopping = false;
+    int _error = 0; ///< errno of the first failed write, the later ones are dropped
+    std::atomic<std::size_t> _stalls = 0;
+    std::thread _writer;
+
+    void RunWriter() {
+        std::unique_lock lock(_mutex);
+        for (;;) {
+            _wake.wait(lock, [&] { return _stopping || !_queue.empty(); });
+            if (_queue.empty()) return;
+            Block block = _queue.front();
+            _queue.pop_front();
+            _writing = true;
+            bool failed = _error != 0;
+            lock.unlock();
+            int error = 0;
+            if (!failed) {
+                try {
+                    std::streamsize bytes = block.size * sizeof(CharType);
+                    if (_fileHandler->WriteAt(block.data, bytes, block.offset) < bytes) error = EIO;
+                    else if (_policy == FsyncPolicy::EveryBuffer) _fileHandler->SyncToDisk();
+                } catch (const FileException& e) {
+                    error = e.errno_ ? e.errno_ : EIO;
+                }
+            }
+            lock.lock();
+            if (error && !_error) _error = error;
+            _free.push_back(block.data);
+            _writing = false;
+            _drained.notify_all();
+        }
+    }
+
+    /// @brief Queue the current buffer for the writer, and continue in a free one
+    void Submit() {
+        if (this->buffer.current == this->buffer.begin) return;
+        std::size_t size = this->buffer.current - this->buffer.begin;
+        std::unique_lock lock(_mutex);
+        _queue.push_back({this->buffer.begin, size, _writePos});
+        _writePos += size * sizeof(CharType);
+        _wake.notify_one();
+        if (_free.empty()) {
+            _stalls.fetch_add(1, std::memory_order_relaxed);
+            _drained.wait(lock, [&] { return !_free.empty(); });
+        }
+        this->buffer.begin = this->buffer.current = _free.back();
+        this->buffer.end = this->buffer.begin + _bufferSize;
+        _free.pop_back();
+    }
+
+    /// @brief Queue the current buffer, and wait for the writer to write everything
+    int Drain() {
+        Submit();
+        std::unique_lock lock(_mutex);
+        _drained.wait(lock, [&] { return _queue.empty() && !_writing; });
+        return _error;
+    }
+public:
+    /**
+     * @brief Start the writer thread of a file handler
+     * @param bufferSize The size of a buffer, in characters
+     * @param bufferCount The number of buffers, at least 2: one is filled while the others are written
+     * @param policy When to wait for the data to reach the disk
+     */
+    BasicBackgroundOFStreamBuffer(Handler* fileHandler, std::size_t bufferSize = DefaultBufferSize,
+                                  std::size_t bufferCount = DefaultBufferCount, FsyncPolicy policy = FsyncPolicy::Never)
+        : BasicOStreamBuffer<CharT, Traits>(), _fileHandler(fileHandler), _bufferSize(std::max<std::size_t>(bufferSize, 1)), _policy(policy) {
+        bufferCount = std::max<std::size_t>(bufferCount, 2);
+        for (std::size_t i = 0; i < bufferCount; ++i) {
+            _buffers.push_back(std::make_unique_for_overwrite<CharType[]>(_bufferSize));
+            if (i > 0) _free.push_back(_buffers.back().get());
+        }
+        this->buffer.begin = _buffers.front().get();
+        this->buffer.current = _buffers.front().get();
+        this->buffer.end = _buffers.front().get() + _bufferSize;
+        _writePos = _fileHandler->Tell();
+        _writer = std::thread([this] { RunWriter(); });
+    }
+    BasicBackgroundOFStreamBuffer(const BasicBackgroundOFStreamBuffer&) = delete;
+    BasicBackgroundOFStreamBuffer& operator=(const BasicBackgroundOFStreamBuffer&) = delete;
+    /// @brief Write what is buffered and stop the writer, the data is synced to the disk unless the policy is Never
+    ~BasicBackgroundOFStreamBuffer() {
+        try {
+            Sync();
+        } catch (...) {
+            // Nowhere to report the error from a destructor
+        }
+        {
+            std::lock_guard lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_one();
+        _writer.join();
+    }
+
+    PosType SeekPos(PosType pos) override {
+        Drain();
+        _fileHandler->Seek(pos * sizeof(CharType), IOSBase::SeekDir::Begin);
+        _writePos = _fileHandler->Tell();
+        return pos;
+    }
+
+    PosType SeekOff(OffType off, IOSBase::SeekDir dir) override {
+        if (dir == IOSBase::SeekDir::Current) return SeekPos(Tell() + off);
+        Drain();
+        _fileHandler->Seek(off * sizeof(CharType), dir);
+        _writePos = _fileHandler->Tell();
+        return _writePos / sizeof(CharType);
+    }
+
+    PosType Tell() const {
+        // _writePos is where the current buffer will be written
+        return _writePos / sizeof(CharType) + (this->buffer.current - this->buffer.begin);
+    }
+
+    std::size_t BufferSize() const noexcept { return _bufferSize; }
+    /// @brief Get the number of times the producer waited for a free buffer
+    std::size_t Stalls() const noexcept { return _stalls.load(std::memory_order_relaxed); }
+    /// @brief Get the errno of the first failed write, 0 if none failed
+    int Error() {
+        std::lock_guard lock(_mutex);
+        return _error;
+    }
+
+    std::streamsize SPutN(const CharType* s, std::streamsize n) override {
+        std::streamsize written = 0;
+        while (written < n) {
+            if (this->buffer.current == this->buffer.end) {
+                if (Overflow() == Traits::eof()) break; // A write failed
+                continue;
+            }
+            // Copy as much as the buffer holds at once
+            std::streamsize chunk = std::min<std::streamsize>(n - written, this->buffer.end - this->buffer.current);
+            Traits::copy(this->buffer.current, s + written, chunk);
+            this->buffer.current += chunk;
+            written += chunk;
+        }
+        return written;
+    }
+protected:
+    IntType Overflow(IntType c = Traits::eof()) override {
+        Submit();
+        if (Error() != 0) return Traits::eof();
+        if (c != Traits::eof()) {
+            *this->buffer.current++ = Traits::to_char_type(c); // Put the character into the buffer
+            return 1;
+        }
+        return 0;
+    }
+public:
+    /**
+     * @brief Wait until everything put is written, and synced to the disk unless the policy is Never
+     * @return 0, -1 if a write failed since the stream was opened
+     */
+    int Sync() override {
+        if (Drain() != 0) return -1;
+        if (_policy != FsyncPolicy::Never) _fileHandler->SyncToDisk();
+        return _fileHandler->Flush();
+    }
+};
+
+/**
+ * @brief A file output stream writing on a background thread, e.g. for logs that must not stall on the disk
+ * @see BasicBackgroundOFStreamBuffer
+ */
+template <typename CharT = char, typename Traits = std::char_traits<CharT>, typename Handler = DefaultFileHandler>
+class BasicBackgroundOFStream: public BasicOStream<CharT, Traits> {
+    Handler _fileHandler;
+    BasicBackgroundOFStreamBuffer<CharT, Traits, Handler> _buffer;
+public:
+    using CharType = typename BasicOStream<CharT, Traits>::CharType;
+    using TraitsType = typename BasicOStream<CharT, Traits>::TraitsType;
+    using IntType = typename BasicOStream<CharT, Traits>::IntType;
+    using PosType = typename BasicOStream<CharT, Traits>::PosType;
+    using OffType = typename BasicOStream<CharT, Traits>::OffType;
+    using BufferType = BasicBackgroundOFStreamBuffer<CharT, Traits, Handler>;
+
+    BasicBackgroundOFStream(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate,
+                            std::size_t bufferSize = BufferType::DefaultBufferSize, std::size_t bufferCount = BufferType::DefaultBufferCount,
+                            FsyncPolicy policy = FsyncPolicy::Never)
+        : BasicOStream<CharT, Traits>(), _fileHandler(path, mode), _buffer(&_fileHandler, bufferSize, bufferCount, policy) { this->OutputBuffer(&_buffer); }
+
+    BasicBackgroundOFStream(const String& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate,
+                            std::size_t bufferSize = BufferType::DefaultBufferSize, std::size_t bufferCount = BufferType::DefaultBufferCount,
+                            FsyncPolicy policy = FsyncPolicy::Never)
+        : BasicBackgroundOFStream(path.c_str(), mode, bufferSize, bufferCount, policy) {}
+
+    BasicBackgroundOFStream(const std::filesystem::path& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate,
+                            std::size_t bufferSize = BufferType::DefaultBufferSize, std::size_t bufferCount = BufferType::DefaultBufferCount,
+                            FsyncPolicy policy = FsyncPolicy::Never)
+        : BasicBackgroundOFStream(path.c_str(), mode, bufferSize, bufferCount, policy) {}
+
+    /// @brief Get the number of times the producer waited for a free buffer
+    std::size_t Stalls() const noexcept { return _buffer.Stalls(); }
+    /// @brief Get the errno of the first failed write, 0 if none failed
+    int Error() { return _buffer.Error(); }
+};
+
+using BackgroundOFStreamBuffer = BasicBackgroundOFStreamBuffer<char>;
+using BackgroundOFStream = BasicBackgroundOFStream<char>;
+
+LCORE_NAMESPACE_END
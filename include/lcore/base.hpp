@@ -21,6 +21,7 @@
 #include "traits.hpp"
 #include "rawptr.hpp"
 #include "class.hpp"
+#include <typeinfo>
 
 LCORE_NAMESPACE_BEGIN
 
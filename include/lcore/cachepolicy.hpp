@@ -0,0 +1,381 @@
+/**
+ * @file cachepolicy.hpp
+ * @brief Eviction policies of LRUCache
+ *
+ * A policy orders the entries of a cache by their 32-bit slab index and picks the one to evict.
+ * Its per-entry state is the trivially copyable Node, stored inside the cache entry and reached through
+ * a Nodes accessor: nodes[index] gives the Node, nodes.HashOf(index) the hash of the key (mixed, 32 bits)
+ * and nodes.WeightOf(index) the weight of the entry, fixed between OnInsert and OnRemove.
+ * The sizes of the segments are in weight, which is the number of entries with UnitWeigher.
+ *
+ * - Policy(max_weight)
+ * - OnInsert(index, nodes): a new entry, must not throw
+ * - OnAccess(index, nodes): a hit, by Get, Touch or a Put updating the value
+ * - OnMiss(hash): a lookup of a missing key
+ * - Victim(nodes): the entry to evict when the cache is full, called before OnInsert of the new entry,
+ *   as many times as needed to make room for it
+ * - OnRemove(index, nodes): the entry is evicted or erased
+ */
+#pragma once
+#include "base.hpp"
+#include "memstats.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+LCORE_NAMESPACE_BEGIN
+
+/// @brief The default weigher of LRUCache, every entry weighs 1 so the maximum weight is a number of entries
+struct UnitWeigher {
+    template <typename K, typename V>
+    constexpr std::size_t operator()(const K&, const V&) const noexcept { return 1; }
+};
+
+namespace detail {
+
+using CacheIndex = std::uint32_t;
+inline constexpr CacheIndex NullCacheIndex = ~CacheIndex(0);
+
+/// @brief A doubly linked list threaded through the prev and next fields of the nodes
+struct CacheList {
+    CacheIndex head = NullCacheIndex; // Most recently used
+    CacheIndex tail = NullCacheIndex; // Least recently used
+    std::size_t weight = 0;
+
+    template <typename Nodes>
+    void PushFront(CacheIndex index, const Nodes& nodes) noexcept {
+        auto& node = nodes[index];
+        node.prev = NullCacheIndex;
+        node.next = head;
+        if (head != NullCacheIndex) nodes[head].prev = index;
+        else tail = index;
+        head = index;
+        weight += nodes.WeightOf(index);
+    }
+    template <typename Nodes>
+    void Remove(CacheIndex index, const Nodes& nodes) noexcept {
+        auto& node = nodes[index];
+        if (node.prev != NullCacheIndex) nodes[node.prev].next = node.next;
+        else head = node.next;
+        if (node.next != NullCacheIndex) nodes[node.next].prev = node.prev;
+        else tail = node.prev;
+        weight -= nodes.WeightOf(index);
+    }
+    template <typename Nodes>
+    void MoveToFront(CacheIndex index, const Nodes& nodes) noexcept {
+        if (index == head) return;
+        Remove(index, nodes);
+        PushFront(index, nodes);
+    }
+};
+
+/**
+ * @brief Approximate access frequencies of keys, 4 rows of 4-bit saturating counters packed in 64-bit words
+ *
+ * The counts are halved every 10 increments per word so the estimate follows the recent popularity.
+ * One word (16 counters) per cached entry keeps the overestimates from collisions low.
+ * The counters of a key are in a single cache line, as in Caffeine's sketch.
+ */
+class CountMinSketch {
+    static constexpr std::size_t MinWords = 16;
+    static constexpr std::size_t MaxWords = std::size_t(1) << 24;
+
+    std::vector<std::uint64_t, TaggedAllocator<std::uint64_t, MemSubsystem::LRUCache>> table;
+    unsigned word_bits = 0;
+    std::size_t additions = 0;
+
+    /// @brief Get the counter of the key in each row, all in the same 64-byte block of 8 words so a lookup touches one cache line
+    void Positions(std::uint32_t hash, std::size_t (&positions)[4]) const noexcept {
+        std::uint64_t h = hash; // splitmix64 finalizer
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        h ^= h >> 31;
+        std::size_t block = (h >> (64 - (word_bits - 3))) << 3; // The top bits pick the block
+        for (std::size_t row = 0; row < 4; ++row) {
+            // Row i uses word 2i or 2i+1 of the block and one of its 16 counters, from 5 other bits each
+            std::size_t bits = (h >> (row * 5)) & 31;
+            positions[row] = ((block + row * 2 + (bits >> 4)) << 4) | (bits & 15);
+        }
+    }
+    unsigned Counter(std::size_t position) const noexcept {
+        return (table[position >> 4] >> ((position & 15) * 4)) & 15;
+    }
+public:
+    /// @brief Size the table for the given number of entries, the counts are reset
+    /// @note The table is left unchanged if it cannot be allocated, the sketch only makes admission better
+    void Resize(std::size_t entries) noexcept {
+        std::size_t words = std::min(std::bit_ceil(std::max(entries, MinWords)), MaxWords);
+        try {
+            table.assign(words, 0);
+        } catch (const std::bad_alloc&) {
+            return;
+        }
+        word_bits = std::countr_zero(words);
+        additions = 0;
+    }
+    bool Empty() const noexcept { return table.empty(); }
+
+    /// @brief Count one use, only the smallest counters are raised (conservative update) to limit the overestimates
+    void Increment(std::uint32_t hash) noexcept {
+        if (table.empty()) return;
+        std::size_t positions[4];
+        Positions(hash, positions);
+        unsigned frequency = 15;
+        for (std::size_t position: positions) frequency = std::min(frequency, Counter(position));
+        if (frequency == 15) return;
+        for (std::size_t position: positions) {
+            if (Counter(position) == frequency) table[position >> 4] += std::uint64_t(1) << ((position & 15) * 4);
+        }
+        if (++additions >= table.size() * 10) Age();
+    }
+    unsigned Frequency(std::uint32_t hash) const noexcept {
+        if (table.empty()) return 0;
+        std::size_t positions[4];
+        Positions(hash, positions);
+        unsigned frequency = 15;
+        for (std::size_t position: positions) frequency = std::min(frequency, Counter(position));
+        return frequency;
+    }
+    /// @brief Halve all the counters
+    void Age() noexcept {
+        for (auto& word: table) word = (word >> 1) & 0x7777777777777777ull;
+        additions /= 2;
+    }
+};
+
+}
+
+/// @brief Evict the least recently used entry
+class LRUPolicy {
+public:
+    using Index = detail::CacheIndex;
+    struct Node {
+        Index prev;
+        Index next;
+    };
+
+    explicit LRUPolicy(std::size_t) noexcept {}
+
+    template <typename Nodes>
+    void OnInsert(Index index, const Nodes& nodes) noexcept { list.PushFront(index, nodes); }
+    template <typename Nodes>
+    void OnAccess(Index index, const Nodes& nodes) noexcept { list.MoveToFront(index, nodes); }
+    void OnMiss(std::uint32_t) noexcept {}
+    template <typename Nodes>
+    Index Victim(const Nodes&) noexcept { return list.tail; }
+    template <typename Nodes>
+    void OnRemove(Index index, const Nodes& nodes) noexcept { list.Remove(index, nodes); }
+private:
+    detail::CacheList list;
+};
+
+/**
+ * @brief Approximate LRU giving a second chance to the entries used since the hand last passed
+ *
+ * A hit only sets a flag, nothing is relinked: this is the cheapest policy, the one to pick when hits are
+ * recorded from readers sharing a lock.
+ */
+class ClockPolicy {
+public:
+    using Index = detail::CacheIndex;
+    struct Node {
+        Index prev;
+        Index next;
+        bool referenced;
+    };
+
+    explicit ClockPolicy(std::size_t) noexcept {}
+
+    /// @brief Insert behind the hand, the entry is the last one to be considered
+    template <typename Nodes>
+    void OnInsert(Index index, const Nodes& nodes) noexcept {
+        Node& node = nodes[index];
+        node.referenced = false;
+        if (hand == detail::NullCacheIndex) {
+            node.prev = node.next = hand = index;
+            return;
+        }
+        node.next = hand;
+        node.prev = nodes[hand].prev;
+        nodes[node.prev].next = index;
+        nodes[hand].prev = index;
+    }
+    template <typename Nodes>
+    void OnAccess(Index index, const Nodes& nodes) noexcept { nodes[index].referenced = true; }
+    void OnMiss(std::uint32_t) noexcept {}
+    /// @brief Sweep the hand over the referenced entries, clearing their flag
+    template <typename Nodes>
+    Index Victim(const Nodes& nodes) noexcept {
+        while (nodes[hand].referenced) {
+            nodes[hand].referenced = false;
+            hand = nodes[hand].next;
+        }
+        return hand;
+    }
+    template <typename Nodes>
+    void OnRemove(Index index, const Nodes& nodes) noexcept {
+        Node& node = nodes[index];
+        if (node.next == index) {
+            hand = detail::NullCacheIndex;
+            return;
+        }
+        nodes[node.prev].next = node.next;
+        nodes[node.next].prev = node.prev;
+        if (hand == index) hand = node.next;
+    }
+private:
+    Index hand = detail::NullCacheIndex;
+};
+
+/**
+ * @brief Segmented LRU: new entries are on probation, a second hit protects them
+ *
+ * The victim is taken from the probation segment first, so a scan of keys used once
+ * only replaces other probationary entries and the protected ones (80% of the cache) survive it.
+ */
+class SLRUPolicy {
+public:
+    using Index = detail::CacheIndex;
+    struct Node {
+        Index prev;
+        Index next;
+        bool protect;
+    };
+
+    explicit SLRUPolicy(std::size_t max_weight) noexcept : protected_max(max_weight - max_weight / 5) {}
+
+    template <typename Nodes>
+    void OnInsert(Index index, const Nodes& nodes) noexcept {
+        nodes[index].protect = false;
+        probation.PushFront(index, nodes);
+    }
+    template <typename Nodes>
+    void OnAccess(Index index, const Nodes& nodes) noexcept {
+        if (nodes[index].protect) {
+            protect.MoveToFront(index, nodes);
+            return;
+        }
+        probation.Remove(index, nodes);
+        nodes[index].protect = true;
+        protect.PushFront(index, nodes);
+        while (protect.weight > protected_max && protect.tail != index) {
+            // Demote the least recently used protected entries
+            Index demoted = protect.tail;
+            protect.Remove(demoted, nodes);
+            nodes[demoted].protect = false;
+            probation.PushFront(demoted, nodes);
+        }
+    }
+    void OnMiss(std::uint32_t) noexcept {}
+    template <typename Nodes>
+    Index Victim(const Nodes&) noexcept {
+        return probation.tail != detail::NullCacheIndex ? probation.tail : protect.tail;
+    }
+    template <typename Nodes>
+    void OnRemove(Index index, const Nodes& nodes) noexcept {
+        (nodes[index].protect ? protect : probation).Remove(index, nodes);
+    }
+private:
+    std::size_t protected_max;
+    detail::CacheList probation;
+    detail::CacheList protect;
+};
+
+/**
+ * @brief W-TinyLFU: a small LRU window in front of a segmented LRU guarded by a frequency filter
+ *
+ * New entries go to the window (1% of the cache). When it overflows, the entry leaving it only enters
+ * the main segments if a CountMinSketch estimates it was used more often than the entry it would evict there,
+ * hits and misses both count. Recency-skewed traces are served by the window, frequency-skewed ones by the filter,
+ * and a scan of keys used once never gets past the window.
+ */
+class TinyLFUPolicy {
+public:
+    using Index = detail::CacheIndex;
+    struct Node {
+        Index prev;
+        Index next;
+        std::uint8_t segment;
+    };
+
+    explicit TinyLFUPolicy(std::size_t max_weight) noexcept
+        : max_weight(max_weight), window_max(std::max<std::size_t>(max_weight / 100, 1)) {
+        std::size_t main_max = max_weight - std::min(max_weight, window_max);
+        protected_max = main_max - main_max / 5;
+    }
+
+    template <typename Nodes>
+    void OnInsert(Index index, const Nodes& nodes) noexcept {
+        ++entries;
+        if (sketch.Empty() && window.weight + probation.weight + protect.weight >= max_weight / 2) {
+            // Allocated once the cache is half full, as Caffeine does: a small cache costs nothing and there is no eviction before.
+            // Twice the entries is the maximum with UnitWeigher, and follows the average weight otherwise
+            sketch.Resize(std::min(max_weight, entries * 2));
+        }
+        sketch.Increment(nodes.HashOf(index));
+        nodes[index].segment = Window;
+        window.PushFront(index, nodes);
+        while (window.weight > window_max && window.tail != index) {
+            // Victim() already made room, or the cache is not full yet
+            Index candidate = window.tail;
+            window.Remove(candidate, nodes);
+            nodes[candidate].segment = Probation;
+            probation.PushFront(candidate, nodes);
+        }
+    }
+    template <typename Nodes>
+    void OnAccess(Index index, const Nodes& nodes) noexcept {
+        sketch.Increment(nodes.HashOf(index));
+        Node& node = nodes[index];
+        if (node.segment == Window) {
+            window.MoveToFront(index, nodes);
+        } else if (node.segment == Protected) {
+            protect.MoveToFront(index, nodes);
+        } else {
+            probation.Remove(index, nodes);
+            node.segment = Protected;
+            protect.PushFront(index, nodes);
+            while (protect.weight > protected_max && protect.tail != index) {
+                Index demoted = protect.tail;
+                protect.Remove(demoted, nodes);
+                nodes[demoted].segment = Probation;
+                probation.PushFront(demoted, nodes);
+            }
+        }
+    }
+    void OnMiss(std::uint32_t hash) noexcept { sketch.Increment(hash); }
+    /// @brief Pick between the entry about to leave the window and the probation victim, by frequency
+    template <typename Nodes>
+    Index Victim(const Nodes& nodes) const noexcept {
+        Index victim = probation.tail != detail::NullCacheIndex ? probation.tail : protect.tail;
+        if (window.weight < window_max || victim == detail::NullCacheIndex) {
+            return victim != detail::NullCacheIndex ? victim : window.tail;
+        }
+        Index candidate = window.tail;
+        return sketch.Frequency(nodes.HashOf(candidate)) > sketch.Frequency(nodes.HashOf(victim)) ? victim : candidate;
+    }
+    template <typename Nodes>
+    void OnRemove(Index index, const Nodes& nodes) noexcept {
+        --entries;
+        switch (nodes[index].segment) {
+            case Window: window.Remove(index, nodes); break;
+            case Probation: probation.Remove(index, nodes); break;
+            default: protect.Remove(index, nodes); break;
+        }
+    }
+private:
+    enum Segment : std::uint8_t { Window, Probation, Protected };
+
+    std::size_t max_weight;
+    std::size_t window_max;
+    std::size_t protected_max;
+    std::size_t entries = 0;
+    detail::CacheList window;
+    detail::CacheList probation;
+    detail::CacheList protect;
+    detail::CountMinSketch sketch;
+};
+
+LCORE_NAMESPACE_END
@@ -0,0 +1,151 @@
+/**
+ * @file cachestats.hpp
+ * @brief Hit, miss, eviction and load counters of LRUCache
+ *
+ * The Stats template parameter of the caches records the events through:
+ * - RecordHit() / RecordMiss(): a lookup
+ * - RecordPut(): an insertion or update
+ * - RecordEviction(cause): an entry removed by the cache itself, or by Clear()
+ * - RecordLoad(nanoseconds, success): a load of a missing value, by a loading cache
+ * NoCacheStats compiles all of them out, CacheStatsCounter counts them.
+ */
+#pragma once
+#include "base.hpp"
+#include <atomic>
+#include <cstdint>
+
+LCORE_NAMESPACE_BEGIN
+
+/// @brief Why an entry left the cache, erasing an entry is not an eviction
+enum class EvictionCause: std::uint8_t {
+    Size,    // To make room, or the entry outgrew the cache
+    Expired, // Its deadline passed
+    Cleared, // Dropped by Clear()
+};
+
+/// @brief A snapshot of the counters of a cache
+struct CacheStats {
+    static constexpr std::size_t CauseCount = 3;
+
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t puts = 0;
+    std::uint64_t evictions[CauseCount] = {};
+    std::uint64_t load_successes = 0;
+    std::uint64_t load_failures = 0;
+    std::uint64_t load_time = 0; // Total time spent loading, in nanoseconds
+    std::size_t size = 0;        // The number of entries when the snapshot was taken
+    std::size_t weight = 0;      // Their total weight
+
+    std::uint64_t Requests() const noexcept { return hits + misses; }
+    /// @brief Get the ratio of lookups that hit, 1 if there was none
+    double HitRate() const noexcept {
+        std::uint64_t requests = Requests();
+        return requests == 0 ? 1.0 : static_cast<double>(hits) / static_cast<double>(requests);
+    }
+    std::uint64_t Evictions(EvictionCause cause) const noexcept {
+        return evictions[static_cast<std::size_t>(cause)];
+    }
+    std::uint64_t Evictions() const noexcept {
+        std::uint64_t total = 0;
+        for (std::uint64_t count: evictions) total += count;
+        return total;
+    }
+    std::uint64_t Loads() const noexcept { return load_successes + load_failures; }
+    /// @brief Get the mean load time in nanoseconds, 0 if nothing was loaded
+    double AverageLoadTime() const noexcept {
+        std::uint64_t loads = Loads();
+        return loads == 0 ? 0.0 : static_cast<double>(load_time) / static_cast<double>(loads);
+    }
+
+    /// @brief Add the counters of another snapshot, e.g. of another shard
+    CacheStats& operator+=(const CacheStats& other) noexcept {
+        hits += other.hits;
+        misses += other.misses;
+        puts += other.puts;
+        for (std::size_t i = 0; i < CauseCount; ++i) evictions[i] += other.evictions[i];
+        load_successes += other.load_successes;
+        load_failures += other.load_failures;
+        load_time += other.load_time;
+        size += other.size;
+        weight += other.weight;
+        return *this;
+    }
+};
+
+/// @brief The default Stats of the caches, records nothing and takes no space
+struct NoCacheStats {
+    static constexpr bool Enabled = false;
+
+    void RecordHit() const noexcept {}
+    void RecordMiss() const noexcept {}
+    void RecordPut() const noexcept {}
+    void RecordEviction(EvictionCause) const noexcept {}
+    void RecordLoad(std::uint64_t, bool) const noexcept {}
+};
+
+/**
+ * @brief Counts the events of a cache with relaxed atomics
+ *
+ * The counters may be bumped by concurrent readers, as ConcurrentLRUCache does under its shared lock,
+ * and read while they are: each one is exact but a snapshot is not atomic as a whole.
+ */
+class CacheStatsCounter {
+    std::atomic<std::uint64_t> hits = 0;
+    std::atomic<std::uint64_t> misses = 0;
+    std::atomic<std::uint64_t> puts = 0;
+    std::atomic<std::uint64_t> evictions[CacheStats::CauseCount] = {};
+    std::atomic<std::uint64_t> load_successes = 0;
+    std::atomic<std::uint64_t> load_failures = 0;
+    std::atomic<std::uint64_t> load_time = 0;
+
+    static void Add(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+    static std::uint64_t Load(const std::atomic<std::uint64_t>& counter) noexcept {
+        return counter.load(std::memory_order_relaxed);
+    }
+    static void Store(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept {
+        counter.store(value, std::memory_order_relaxed);
+    }
+public:
+    static constexpr bool Enabled = true;
+
+    CacheStatsCounter() noexcept = default;
+    CacheStatsCounter(const CacheStatsCounter& other) noexcept { *this = other; }
+    CacheStatsCounter& operator=(const CacheStatsCounter& other) noexcept {
+        Store(hits, Load(other.hits));
+        Store(misses, Load(other.misses));
+        Store(puts, Load(other.puts));
+        for (std::size_t i = 0; i < CacheStats::CauseCount; ++i) Store(evictions[i], Load(other.evictions[i]));
+        Store(load_successes, Load(other.load_successes));
+        Store(load_failures, Load(other.load_failures));
+        Store(load_time, Load(other.load_time));
+        return *this;
+    }
+
+    void RecordHit() noexcept { Add(hits, 1); }
+    void RecordMiss() noexcept { Add(misses, 1); }
+    void RecordPut() noexcept { Add(puts, 1); }
+    void RecordEviction(EvictionCause cause) noexcept { Add(evictions[static_cast<std::size_t>(cause)], 1); }
+    void RecordLoad(std::uint64_t nanoseconds, bool success) noexcept {
+        Add(success ? load_successes : load_failures, 1);
+        Add(load_time, nanoseconds);
+    }
+
+    /// @brief Get the counters, the size and weight are left to the cache
+    CacheStats Snapshot() const noexcept {
+        CacheStats stats;
+        stats.hits = Load(hits);
+        stats.misses = Load(misses);
+        stats.puts = Load(puts);
+        for (std::size_t i = 0; i < CacheStats::CauseCount; ++i) stats.evictions[i] = Load(evictions[i]);
+        stats.load_successes = Load(load_successes);
+        stats.load_failures = Load(load_failures);
+        stats.load_time = Load(load_time);
+        return stats;
+    }
+    void Reset() noexcept { *this = CacheStatsCounter(); }
+};
+
+LCORE_NAMESPACE_END
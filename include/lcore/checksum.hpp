@@ -0,0 +1,38 @@
+/**
+ * @file checksum.hpp
+ * @brief Checksums of the data written to files
+ */
+#pragma once
+#include "base.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+LCORE_NAMESPACE_BEGIN
+
+namespace detail {
+
+/// @brief A fast 64-bit checksum of a byte range, detects torn and partial writes (not an adversary)
+inline std::uint64_t Checksum64(const void* data, std::size_t size, std::uint64_t seed = 0) noexcept {
+    constexpr std::uint64_t Prime = 0x9E3779B97F4A7C15ull;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    std::uint64_t hash = seed ^ (size * Prime);
+    for (; size >= 8; size -= 8, bytes += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * Prime;
+        hash ^= hash >> 29;
+    }
+    if (size > 0) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes, size);
+        hash = (hash ^ word) * Prime;
+    }
+    hash ^= hash >> 32;
+    hash *= 0xBF58476D1CE4E5B9ull;
+    return hash ^ (hash >> 29);
+}
+
+}
+
+LCORE_NAMESPACE_END
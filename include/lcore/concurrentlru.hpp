@@ -0,0 +1,241 @@
+/**
+ * @file concurrentlru.hpp
+ * @brief A thread-safe LRU cache for read-heavy workloads
+ */
+#pragma once
+#include "base.hpp"
+#include "lru.hpp"
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+
+LCORE_NAMESPACE_BEGIN
+
+/**
+ * @brief A thread-safe LRU cache split into lock-striped shards
+ *
+ * Keys are spread over the shards by hash, each shard is an LRUCache behind a reader/writer lock.
+ * A Get only takes the shared lock: the hit is recorded into a small read buffer, picked by thread,
+ * and the recency updates are applied in batches under the exclusive lock, by the next writer
+ * or by the reader whose hit fills half a buffer (as Caffeine does). That reader waits for the lock, a try_lock would
+ * seldom win against the other readers, while they go on filling the other half.
+ * Hits dropped while a buffer is full only make the order approximate.
+ * @tparam Policy The eviction policy of each shard, see LRUCache
+ * @tparam Weigher The cost of an entry, see LRUCache. Each shard gets an equal share of the budget,
+ * an entry heavier than a share is not cached
+ * @tparam StatsRecorder Counts the events of each shard, see LRUCache. Stats() sums the shards
+ * @note The evictor is called with the shard locked, it must not access the cache
+ */
+template <
+    typename K,
+    typename V,
+    typename Evictor = InplaceFunction<void(const K&, const V&)>,
+    typename KView = K,
+    typename Hash = std::hash<KView>,
+    typename KeyEqual = std::equal_to<>,
+    typename Policy = LRUPolicy,
+    typename Weigher = UnitWeigher,
+    typename StatsRecorder = NoCacheStats
+>
+class ConcurrentLRUCache {
+public:
+    using KeyType = K;
+    using ValueType = V;
+    using EvictorType = Evictor;
+    using CacheType = LRUCache<K, V, Evictor, KView, Hash, KeyEqual, Policy, Weigher, void, StatsRecorder>;
+private:
+    using EntryRef = typename CacheType::EntryRef;
+
+    static constexpr std::size_t CacheLineSize = 64;
+    static constexpr std::size_t ReadBufferSize = 16;
+    static constexpr std::size_t DrainThreshold = ReadBufferSize / 2; ///< Hits buffered before a reader drains
+    static constexpr std::size_t MaxReadBuffers = 16;
+
+    /// @brief Hits recorded by the readers sharing a stripe, written under the shared lock, drained under the exclusive one
+    struct alignas(CacheLineSize) ReadBuffer {
+        std::atomic<std::uint32_t> size = 0;
+        std::atomic<std::uint64_t> refs[ReadBufferSize];
+    };
+    struct alignas(CacheLineSize) Shard {
+        std::shared_mutex mutex;
+        CacheType cache;
+        std::unique_ptr<ReadBuffer[]> buffers;
+
+        Shard(std::size_t max_size, const EvictorType& evictor, const Weigher& weigher, std::size_t buffer_count)
+            : cache(max_size, evictor, weigher), buffers(new ReadBuffer[buffer_count]) {}
+    };
+
+    [[no_unique_address]] Hash hasher;
+    std::size_t shard_mask;
+    std::size_t buffer_mask;
+    std::unique_ptr<std::unique_ptr<Shard>[]> shards;
+
+    static std::size_t ThreadStripe() noexcept {
+        static std::atomic<std::size_t> next = 0;
+        static thread_local std::size_t stripe = next.fetch_add(1, std::memory_order_relaxed);
+        return stripe;
+    }
+
+    Shard& ShardOf(const KView& key) const noexcept {
+        std::uint64_t hash = hasher(key);
+        // splitmix64 finalizer, independent of the Fibonacci hashing inside the shard
+        hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+        hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+        hash ^= hash >> 31;
+        return *shards[hash & shard_mask];
+    }
+
+    /// @brief Apply the recorded hits, the exclusive lock must be held
+    void Drain(Shard& shard) noexcept {
+        for (std::size_t i = 0; i <= buffer_mask; ++i) {
+            ReadBuffer& buffer = shard.buffers[i];
+            std::size_t size = std::min<std::size_t>(buffer.size.load(std::memory_order_relaxed), ReadBufferSize);
+            for (std::size_t j = 0; j < size; ++j) {
+                std::uint64_t packed = buffer.refs[j].load(std::memory_order_relaxed);
+                shard.cache.Touch(EntryRef{static_cast<std::uint32_t>(packed >> 32), static_cast<std::uint32_t>(packed)});
+            }
+            buffer.size.store(0, std::memory_order_relaxed);
+        }
+    }
+    /// @brief Record a hit, the shared lock must be held
+    /// @return true for the one hit reaching the drain threshold, its reader drains the buffers
+    bool Record(Shard& shard, EntryRef ref) noexcept {
+        ReadBuffer& buffer = shard.buffers[ThreadStripe() & buffer_mask];
+        std::uint32_t slot = buffer.size.fetch_add(1, std::memory_order_relaxed);
+        if (slot < ReadBufferSize) {
+            buffer.refs[slot].store((std::uint64_t(ref.index) << 32) | ref.generation, std::memory_order_relaxed);
+        }
+        return slot + 1 == DrainThreshold;
+    }
+public:
+    /// @param max_size The maximum number of entries or total weight, split evenly over the shards
+    /// @param shard_count The number of shards rounded up to a power of 2, 0 picks 4 per hardware thread
+    /// @param evictor Called with every entry evicted to make room or dropped by Clear()
+    ConcurrentLRUCache(std::size_t max_size, std::size_t shard_count = 0, EvictorType evictor = nullptr, Weigher weigher = {}) {
+        std::size_t threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+        if (shard_count == 0) shard_count = threads * 4;
+        // No more shards than max_size, so that none is left without room
+        shard_count = std::min(std::bit_ceil(shard_count), std::bit_floor(std::max<std::size_t>(max_size, 1)));
+        shard_mask = shard_count - 1;
+        buffer_mask = std::bit_ceil(std::min(threads, MaxReadBuffers)) - 1;
+
+        // The first max_size % shard_count shards take one more, the sizes add up to max_size
+        shards.reset(new std::unique_ptr<Shard>[shard_count]);
+        for (std::size_t i = 0; i < shard_count; ++i) {
+            std::size_t shard_size = max_size / shard_count + (i < max_size % shard_count);
+            shards[i] = std::make_unique<Shard>(shard_size, evictor, weigher, buffer_mask + 1);
+        }
+    }
+    ConcurrentLRUCache(const ConcurrentLRUCache&) = delete;
+    ConcurrentLRUCache& operator=(const ConcurrentLRUCache&) = delete;
+
+    /// @brief Look up an entry, the recency update is deferred
+    /// @return A copy of the value, the entry may be evicted as soon as the shard is unlocked
+    std::optional<ValueType> Get(const KView& key) {
+        std::optional<ValueType> result;
+        Visit(key, [&result](const ValueType& value) { result.emplace(value); });
+        return result;
+    }
+
+    /// @brief Call func with the value under the shared lock, without copying it
+    /// @return true if the entry was found
+    template <typename Func>
+    bool Visit(const KView& key, Func&& func) {
+        Shard& shard = ShardOf(key);
+        bool drain;
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            EntryRef ref;
+            auto value = shard.cache.Peek(key, &ref);
+            if (!value) {
+                shard.cache.Recorder().RecordMiss();
+                return false;
+            }
+            shard.cache.Recorder().RecordHit();
+            func(*value);
+            drain = Record(shard, ref);
+        }
+        if (drain) {
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            Drain(shard);
+        }
+        return true;
+    }
+
+    /// @brief Insert or update an entry, evicting an entry of its shard when full
+    void Put(K key, V value) {
+        Shard& shard = ShardOf(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        Drain(shard);
+        shard.cache.Put(std::move(key), std::move(value));
+    }
+
+    bool Exists(const KView& key) const {
+        Shard& shard = ShardOf(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.cache.Exists(key);
+    }
+
+    /// @brief Remove an entry without calling the evictor
+    bool Erase(const KView& key) {
+        Shard& shard = ShardOf(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        Drain(shard);
+        return shard.cache.Erase(key);
+    }
+
+    /// @brief Drop all the entries, calling the evictor on each
+    void Clear() {
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            Shard& shard = *shards[i];
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            // The buffered references would match the entries refilled from the start of the slab
+            for (std::size_t j = 0; j <= buffer_mask; ++j) shard.buffers[j].size.store(0, std::memory_order_relaxed);
+            shard.cache.Clear();
+        }
+    }
+
+    /// @brief Get the number of entries, not a snapshot when other threads write
+    std::size_t Size() const {
+        std::size_t size = 0;
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            Shard& shard = *shards[i];
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            size += shard.cache.Size();
+        }
+        return size;
+    }
+    /// @brief Get the maximum number of entries or total weight, summed over the shards
+    std::size_t MaxSize() const noexcept {
+        std::size_t max_size = 0;
+        for (std::size_t i = 0; i <= shard_mask; ++i) max_size += shards[i]->cache.MaxSize();
+        return max_size;
+    }
+    /// @brief Get the total weight of the entries, not a snapshot when other threads write
+    std::size_t Weight() const {
+        std::size_t weight = 0;
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            Shard& shard = *shards[i];
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            weight += shard.cache.Weight();
+        }
+        return weight;
+    }
+    /// @brief Get the counters summed over the shards, not a snapshot when other threads access the cache
+    CacheStats Stats() const requires StatsRecorder::Enabled {
+        CacheStats stats;
+        for (std::size_t i = 0; i <= shard_mask; ++i) {
+            Shard& shard = *shards[i];
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            stats += shard.cache.Stats();
+        }
+        return stats;
+    }
+    std::size_t ShardCount() const noexcept { return shard_mask + 1; }
+};
+
+LCORE_NAMESPACE_END
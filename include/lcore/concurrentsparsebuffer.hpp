@@ -0,0 +1,243 @@
+/**
+ * @file concurrentsparsebuffer.hpp
+ * @brief A SparseBuffer written by several threads at once, and waited on by its readers
+ */
+#pragma once
+#include "base.hpp"
+#include "rangeset.hpp"
+#include "sparsebuffer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <optional>
+#include <utility>
+#include <vector>
+
+LCORE_NAMESPACE_BEGIN
+
+/**
+ * @brief A sparse buffer safe to write from several threads, e.g. parallel range downloads of one object
+ *
+ * Data lives in the pages of SparseBuffer, allocated outside any lock and installed under a short exclusive lock;
+ * writers copy their data without holding a lock, so writes of distinct pages or ranges run in parallel.
+ * The ranges holding data are published after the copy, under a mutex held for a RangeSet update:
+ * a reader seeing a range in has_data, read or wait_for_range also sees its data.
+ *
+ * Readers wait for data with wait_for_range (blocking), or async::WaitForRange (see async/sparsebuffer.hpp).
+ * @note Concurrent writes of the same elements leave either value. clear() must not run concurrently with anything else,
+ * it invalidates the spans returned by read and readv
+ */
+template <typename T = char, std::size_t PageBytes = 64 * 1024>
+class ConcurrentSparseBuffer {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+
+    static constexpr size_type page_size = SparseBuffer<T, PageBytes>::page_size;
+
+    using Page = typename SparseBuffer<T, PageBytes>::Page;
+private:
+    std::map<size_type, Page> pages; // Map of pages, key is the index of the page
+    mutable std::shared_mutex pages_mutex;
+    RangeSet<size_type> valid; // Ranges holding data
+    size_type total_size = 0;  // Total size of the sparse buffer
+    mutable std::size_t waiters = 0; // Threads in wait_for_range
+    mutable std::mutex ranges_mutex; // Of valid, total_size and waiters
+    mutable std::condition_variable filled;
+    std::atomic<std::uint64_t> generation = 0; // Bumped by each write
+
+    /// @brief Get a page, allocated and installed if missing
+    inline T* page_for_write(size_type index) {
+        {
+            std::shared_lock lock(pages_mutex);
+            auto it = pages.find(index);
+            if (it != pages.end()) return it->second.data();
+        }
+        Page page;
+        page.allocate();
+        std::unique_lock lock(pages_mutex);
+        return pages.try_emplace(index, std::move(page)).first->second.data();
+    }
+    /// @brief Get an existing page, the pages of valid data always exist
+    inline const T* page_for_read(size_type index) const {
+        std::shared_lock lock(pages_mutex);
+        return pages.find(index)->second.data();
+    }
+
+    inline void copy_in(size_type pos, const T* data, size_type size) {
+        while (size > 0) {
+            size_type offset = pos % page_size;
+            size_type count = std::min(size, page_size - offset);
+            std::copy_n(data, count, page_for_write(pos / page_size) + offset);
+            pos += count;
+            data += count;
+            size -= count;
+        }
+    }
+
+    /// @brief Publish a written range and wake the waiting readers
+    inline void publish(size_type pos, size_type size) {
+        bool notify;
+        {
+            std::lock_guard lock(ranges_mutex);
+            valid.insert(pos, pos + size);
+            total_size = std::max(total_size, pos + size);
+            generation.fetch_add(1, std::memory_order_release);
+            notify = waiters > 0;
+        }
+        if (notify) filled.notify_all();
+    }
+public:
+    inline ConcurrentSparseBuffer() = default;
+    inline explicit ConcurrentSparseBuffer(size_type size) : total_size(size) {}
+    ConcurrentSparseBuffer(const ConcurrentSparseBuffer&) = delete;
+    ConcurrentSparseBuffer& operator=(const ConcurrentSparseBuffer&) = delete;
+
+    /// @brief Get the total size of the sparse buffer
+    inline size_type size() const {
+        std::lock_guard lock(ranges_mutex);
+        return total_size;
+    }
+    /// @brief Get the number of contiguous ranges of data in the sparse buffer
+    inline size_type chunk_count() const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.size();
+    }
+    /// @brief Get a copy of the contiguous ranges of data
+    inline RangeSet<size_type> get_ranges() const {
+        std::lock_guard lock(ranges_mutex);
+        return valid;
+    }
+    inline bool has_data(size_type pos) const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.contains(pos);
+    }
+    /// @brief Check if [pos, pos + size) is entirely written
+    inline bool has_data(size_type pos, size_type size) const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.contains(pos, pos + size);
+    }
+    /// @brief Get the number of elements holding data, in O(1)
+    inline size_type covered_size() const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.length();
+    }
+    /// @brief Check if [pos, pos + size) holds data, in O(log n)
+    inline bool is_complete(size_type pos, size_type size) const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.contains(pos, pos + size);
+    }
+    /// @brief Check if the whole buffer, [0, size()), holds data
+    inline bool is_complete() const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.contains(0, total_size);
+    }
+    /// @brief Get the ranges of [begin, end) holding no data, in O(log n + holes)
+    inline std::vector<std::pair<size_type, size_type>> holes(size_type begin, size_type end) const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.gaps(begin, end);
+    }
+    /// @brief Get the ranges of the buffer holding no data
+    inline std::vector<std::pair<size_type, size_type>> holes() const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.gaps(0, total_size);
+    }
+    /// @brief Get the first range holding no data at or after pos, in O(log n), std::nullopt if the rest of the buffer is complete
+    inline std::optional<std::pair<size_type, size_type>> first_hole_after(size_type pos) const {
+        std::lock_guard lock(ranges_mutex);
+        return valid.first_gap(pos, total_size);
+    }
+    /// @brief Get a counter bumped by each write, to poll for new data cheaply
+    inline std::uint64_t version() const noexcept { return generation.load(std::memory_order_acquire); }
+
+    /// @brief Read data from the sparse buffer, return a span of the data read
+    /// @note The span stops at the end of the data or of the page holding pos, read again from its end for the rest
+    inline std::span<const T> read(size_type pos, size_type size) const {
+        size_type read_size;
+        {
+            std::lock_guard lock(ranges_mutex);
+            auto range = valid.find(pos);
+            if (range == valid.end()) return {};
+            read_size = std::min({size, range->second - pos, page_size - pos % page_size});
+        }
+        return std::span<const T>(page_for_read(pos / page_size) + pos % page_size, read_size);
+    }
+    /// @brief Get the data at [pos, pos + size) without copying it, up to the first gap, one span per page
+    inline std::vector<std::span<const T>> readv(size_type pos, size_type size) const {
+        std::vector<std::span<const T>> spans;
+        size_type end;
+        {
+            std::lock_guard lock(ranges_mutex);
+            auto range = valid.find(pos);
+            if (range == valid.end()) return spans;
+            end = range->second - pos > size ? pos + size : range->second;
+        }
+        std::shared_lock lock(pages_mutex);
+        auto page = pages.find(pos / page_size);
+        for (; pos < end; ++page) {
+            size_type count = std::min(end - pos, page_size - pos % page_size);
+            spans.emplace_back(page->second.data() + pos % page_size, count);
+            pos += count;
+        }
+        return spans;
+    }
+
+    /// @brief Write data to the sparse buffer, return the number of elements written
+    inline size_type write(size_type pos, std::span<const T> data) {
+        if (data.empty()) return 0;
+        copy_in(pos, data.data(), data.size());
+        publish(pos, data.size());
+        return data.size();
+    }
+    /// @brief Write data to the sparse buffer, without overwriting existing data, return the number of elements written
+    inline size_type write_sparse(size_type pos, std::span<const T> data) {
+        if (data.empty()) return 0;
+        std::vector<std::pair<size_type, size_type>> gaps;
+        {
+            std::lock_guard lock(ranges_mutex);
+            valid.for_each_gap(pos, pos + data.size(), [&](size_type begin, size_type end) { gaps.emplace_back(begin, end); });
+        }
+        for (auto [begin, end]: gaps) copy_in(begin, data.data() + (begin - pos), end - begin);
+        publish(pos, data.size());
+        return data.size();
+    }
+
+    /// @brief Block until [pos, pos + size) is entirely written
+    inline void wait_for_range(size_type pos, size_type size) const {
+        std::unique_lock lock(ranges_mutex);
+        ++waiters;
+        filled.wait(lock, [&] { return valid.contains(pos, pos + size); });
+        --waiters;
+    }
+    /// @brief Block until [pos, pos + size) is entirely written, or the timeout expires
+    /// @return true if the range is written
+    template <typename Rep, typename Period>
+    inline bool wait_for_range(size_type pos, size_type size, std::chrono::duration<Rep, Period> timeout) const {
+        std::unique_lock lock(ranges_mutex);
+        ++waiters;
+        bool written = filled.wait_for(lock, timeout, [&] { return valid.contains(pos, pos + size); });
+        --waiters;
+        return written;
+    }
+
+    /// @brief Clear the sparse buffer, not thread-safe
+    inline void clear() {
+        std::scoped_lock lock(pages_mutex, ranges_mutex);
+        pages.clear();
+        valid.clear();
+        total_size = 0;
+    }
+};
+
+LCORE_NAMESPACE_END
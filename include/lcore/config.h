@@ -0,0 +1,8 @@
+#define LCORE_ENABLE_RECORDSTACK
+#define LCORE_ENABLE_ASSERT
+/* #undef LCORE_ENABLE_MEMSTATS */
+/* #undef LCORE_DEBUG */
+#define LCORE_NAMESPACE_NAME lcore
+
+#define LCORE_NAMESPACE_BEGIN namespace lcore {
+#define LCORE_NAMESPACE_END }
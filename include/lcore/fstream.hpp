@@ -1,8 +1,19 @@
 #pragma once
 #include "iostream.hpp"
 #include "string.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 LCORE_NAMESPACE_BEGIN
 
@@ -22,8 +33,30 @@ public:
     inline const char* what() const noexcept override { return "Failed to open file"; }
 };
 
+/// @brief Access pattern hints for a file, see posix_fadvise
+enum class FileAccess {
+    Normal,
+    Sequential, ///< Read ahead aggressively
+    Random      ///< Do not read ahead
+};
+
+namespace detail {
+#ifndef _WIN32
+inline void AdviseFile(int fd, FileAccess access, std::streamoff offset, std::streamsize length) {
+#ifdef POSIX_FADV_SEQUENTIAL
+    int advice = access == FileAccess::Sequential ? POSIX_FADV_SEQUENTIAL
+               : access == FileAccess::Random     ? POSIX_FADV_RANDOM
+                                                  : POSIX_FADV_NORMAL;
+    ::posix_fadvise(fd, offset, length, advice); // Only a hint, failures are ignored
+#endif
+}
+#endif
+}
+
+/// @brief A file handler on std::FILE, for platforms without pread and pwrite
 class FileStreamHandler {
     std::FILE *filePtr;
+    std::streamoff position = -1; ///< Position of filePtr after the last operation, -1 if unknown
 public:
     IOSBase::IOMode lastOperation = IOSBase::IOMode::In;
     FileStreamHandler(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read | IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate) {
@@ -44,6 +77,7 @@ public:
     
     void Seek(std::streampos pos, IOSBase::SeekDir dir = IOSBase::SeekDir::Begin) {
         if (std::fseek(filePtr, pos, (int)dir) != 0) { throw FileException(errno); }
+        position = dir == IOSBase::SeekDir::Begin ? std::streamoff(pos) : -1;
     }
 
     std::streampos Tell() const {
@@ -55,24 +89,168 @@ public:
     std::streamsize Read(void* buffer, std::streamsize size) {
         auto bytesRead = std::fread(buffer, 1, size, filePtr);
         if (bytesRead < 0) throw FileException(errno);
+        if (position >= 0) position += bytesRead;
         return bytesRead;
     }
 
     std::streamsize Write(const void* buffer, std::streamsize size) {
         auto bytesWritten = std::fwrite(buffer, 1, size, filePtr);
         if (bytesWritten < 0) throw FileException(errno);
+        if (position >= 0) position += bytesWritten;
         return bytesWritten;
     }
 
+    /// @brief Read at offset, seeking only when the last operation did not end there or was a write
+    std::streamsize ReadAt(void* buffer, std::streamsize size, std::streamoff offset) {
+        if (lastOperation != IOSBase::IOMode::In || position != offset) Seek(offset);
+        lastOperation = IOSBase::IOMode::In;
+        return Read(buffer, size);
+    }
+
+    /// @brief Write at offset, seeking only when the last operation did not end there or was a read
+    std::streamsize WriteAt(const void* buffer, std::streamsize size, std::streamoff offset) {
+        if (lastOperation != IOSBase::IOMode::Out || position != offset) Seek(offset);
+        lastOperation = IOSBase::IOMode::Out;
+        return Write(buffer, size);
+    }
+
+    /// @brief Get the size of the file
+    std::streamoff Size() {
+        Seek(0, IOSBase::SeekDir::End);
+        return Tell();
+    }
+
     int Flush() {
         if (std::fflush(filePtr) != 0) {
             throw FileException(errno);
         }
         return 0; // Return 0 on success
     }
+
+    /// @brief Flush, then wait for the data to reach the disk
+    void SyncToDisk() {
+        Flush();
+#ifdef _WIN32
+        if (_commit(_fileno(filePtr)) != 0) throw FileException(errno);
+#else
+        if (::fsync(fileno(filePtr)) != 0) throw FileException(errno);
+#endif
+    }
+
+    /// @brief Hint how the file will be accessed, from offset for length bytes, 0 for the rest of the file
+    void Advise(FileAccess access, std::streamoff offset = 0, std::streamsize length = 0) {
+#ifndef _WIN32
+        detail::AdviseFile(fileno(filePtr), access, offset, length);
+#endif
+    }
+};
+
+#ifndef _WIN32
+/**
+ * @brief A file handler on a raw file descriptor, reading and writing with pread and pwrite at explicit offsets
+ *
+ * Nothing is buffered under the stream buffers, and reads and writes at different offsets need no seek between them.
+ * Seek, Read and Write move a position kept in the handler, the offset of the file descriptor is never used.
+ * In append mode the file is opened with O_APPEND and written with write(): each write lands at the end of the file,
+ * whatever its offset, so several appenders (e.g. processes sharing a log) never overwrite each other.
+ */
+class PosixFileHandler {
+    int fd;
+    std::streamoff position = 0; ///< Offset of Read and Write
+    bool append = false; ///< Opened with O_APPEND, every write goes to the end of the file
+public:
+    PosixFileHandler(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read | IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate) {
+        bool read = bool(mode & IOSBase::OpenMode::Read);
+        append = bool(mode & IOSBase::OpenMode::Append);
+        bool write = bool(mode & IOSBase::OpenMode::Write) || append;
+        int flags = read && write ? O_RDWR : write ? O_WRONLY : O_RDONLY;
+        // As fopen: writing creates the file, and truncates it unless reading or appending
+        if (write) flags |= O_CREAT;
+        if (append) flags |= O_APPEND;
+        if (write && !append && (bool(mode & IOSBase::OpenMode::Truncate) || !read)) flags |= O_TRUNC;
+        fd = ::open(path, flags | O_CLOEXEC, 0666);
+        if (fd < 0) {
+            throw FileOpenException(path, mode, errno);
+        }
+        if (append) position = Size();
+    }
+    PosixFileHandler(const PosixFileHandler&) = delete;
+    PosixFileHandler& operator=(const PosixFileHandler&) = delete;
+    ~PosixFileHandler() { ::close(fd); }
+
+    void Seek(std::streampos pos, IOSBase::SeekDir dir = IOSBase::SeekDir::Begin) {
+        std::streamoff base = dir == IOSBase::SeekDir::Begin ? 0 : dir == IOSBase::SeekDir::Current ? position : Size();
+        if (base + std::streamoff(pos) < 0) throw FileException(EINVAL);
+        position = base + std::streamoff(pos);
+    }
+
+    std::streampos Tell() const { return position; }
+
+    /// @brief Read size bytes at offset, fewer only at the end of the file
+    std::streamsize ReadAt(void* buffer, std::streamsize size, std::streamoff offset) {
+        std::streamsize bytesRead = 0;
+        while (bytesRead < size) {
+            ssize_t count = ::pread(fd, static_cast<char*>(buffer) + bytesRead, size - bytesRead, offset + bytesRead);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                throw FileException(errno);
+            }
+            if (count == 0) break; // End of file
+            bytesRead += count;
+        }
+        position = offset + bytesRead;
+        return bytesRead;
+    }
+
+    /// @brief Write size bytes at offset, or at the end of the file in append mode, even if another writer extended it
+    std::streamsize WriteAt(const void* buffer, std::streamsize size, std::streamoff offset) {
+        std::streamsize bytesWritten = 0;
+        const char* bytes = static_cast<const char*>(buffer);
+        while (bytesWritten < size) {
+            ssize_t count = append ? ::write(fd, bytes + bytesWritten, size - bytesWritten)
+                                   : ::pwrite(fd, bytes + bytesWritten, size - bytesWritten, offset + bytesWritten);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                throw FileException(errno);
+            }
+            bytesWritten += count;
+        }
+        position = append ? ::lseek(fd, 0, SEEK_CUR) : offset + bytesWritten;
+        return bytesWritten;
+    }
+
+    std::streamsize Read(void* buffer, std::streamsize size) { return ReadAt(buffer, size, position); }
+    std::streamsize Write(const void* buffer, std::streamsize size) { return WriteAt(buffer, size, position); }
+
+    /// @brief Get the size of the file
+    std::streamoff Size() const {
+        struct stat info;
+        if (::fstat(fd, &info) != 0) throw FileException(errno);
+        return info.st_size;
+    }
+
+    /// @brief Nothing is buffered in the handler, written data is already in the kernel
+    int Flush() { return 0; }
+
+    /// @brief Wait for the written data to reach the disk
+    void SyncToDisk() {
+        if (::fsync(fd) != 0) throw FileException(errno);
+    }
+
+    /// @brief Hint how the file will be accessed, from offset for length bytes, 0 for the rest of the file
+    void Advise(FileAccess access, std::streamoff offset = 0, std::streamsize length = 0) {
+        detail::AdviseFile(fd, access, offset, length);
+    }
+
+    int FileDescriptor() const noexcept { return fd; }
 };
 
-template <typename CharT, typename Traits = std::char_traits<CharT>>
+using DefaultFileHandler = PosixFileHandler;
+#else
+using DefaultFileHandler = FileStreamHandler;
+#endif
+
+template <typename CharT, typename Traits = std::char_traits<CharT>, typename Handler = DefaultFileHandler>
 class BasicIFStreamBuffer: public BasicIStreamBuffer<CharT, Traits> {
 public:
     using CharType = typename BasicIStreamBuffer<CharT, Traits>::CharType;
@@ -81,24 +259,25 @@ public:
     using PosType = typename BasicIStreamBuffer<CharT, Traits>::PosType;
     using OffType = typename BasicIStreamBuffer<CharT, Traits>::OffType;
 
-    static constexpr size_t BufferSize = 1024; ///< Size of the read buffer
+    static constexpr size_t DefaultBufferSize = 64 * 1024 / sizeof(CharType); ///< Default size of the read buffer, in characters
 private:
-    FileStreamHandler* _fileHandler;
-    std::array<CharType, BufferSize> _readBuffer; ///< Buffer for reading data from the file
-    std::streamsize _readPos = 0; ///< Current position in the file handler for reading
+    Handler* _fileHandler;
+    std::size_t _bufferSize; ///< Size of the read buffer, in characters
+    std::unique_ptr<CharType[]> _readBuffer; ///< Buffer for reading data from the file
+    std::streamsize _readPos = 0; ///< Position in the file of the end of the buffer
 
     // We don't consider the case where the file size is not an integer multiple of T
 public:
-    BasicIFStreamBuffer(FileStreamHandler* fileHandler)
-        : BasicIStreamBuffer<CharT, Traits>(), _fileHandler(fileHandler) {
-        this->buffer.begin = _readBuffer.data();
-        this->buffer.current = _readBuffer.data();
-        this->buffer.end = _readBuffer.data();  // Initially empty buffer
+    BasicIFStreamBuffer(Handler* fileHandler, std::size_t bufferSize = DefaultBufferSize)
+        : BasicIStreamBuffer<CharT, Traits>(), _fileHandler(fileHandler), _bufferSize(std::max<std::size_t>(bufferSize, 1)),
+          _readBuffer(std::make_unique_for_overwrite<CharType[]>(_bufferSize)) {
+        this->buffer.begin = _readBuffer.get();
+        this->buffer.current = _readBuffer.get();
+        this->buffer.end = _readBuffer.get();  // Initially empty buffer
         this->_readPos = this->_fileHandler->Tell();
     }
 
     PosType SeekPos(PosType pos) override {
-        _fileHandler->lastOperation = IOSBase::IOMode::In;
         _fileHandler->Seek(pos * sizeof(CharType), IOSBase::SeekDir::Begin);
         _readPos = _fileHandler->Tell();
         this->Underflow(); // Ensure the buffer is filled after seeking
@@ -106,49 +285,50 @@ public:
     }
 
     PosType SeekOff(OffType off, IOSBase::SeekDir dir) override {
-        _fileHandler->lastOperation = IOSBase::IOMode::In;
+        if (dir == IOSBase::SeekDir::Current) return SeekPos(Tell() + off); // Relative to what was read, not to the buffer
         _fileHandler->Seek(off * sizeof(CharType), dir);
         _readPos = _fileHandler->Tell();
         this->Underflow(); // Ensure the buffer is filled after seeking
-        return _fileHandler->Tell() / sizeof(CharType);
+        return Tell();
     }
 
     PosType Tell() const {
         return _readPos / sizeof(CharType) - (this->buffer.end - this->buffer.current);
     }
+
+    std::size_t BufferSize() const noexcept { return _bufferSize; }
     
     IntType Showmanyc() const override {
-        if (_fileHandler->lastOperation != IOSBase::IOMode::In) {
-            _fileHandler->Seek(_readPos, IOSBase::SeekDir::Begin);
-            _fileHandler->lastOperation = IOSBase::IOMode::In;
-        }
-        _fileHandler->Seek(0, IOSBase::SeekDir::End);
-        auto endPos = _fileHandler->Tell();
-        _fileHandler->Seek(_readPos, IOSBase::SeekDir::Begin);
-        return static_cast<IntType>(endPos - _readPos) / sizeof(CharType);
+        return static_cast<IntType>(_fileHandler->Size() - _readPos) / sizeof(CharType);
     }
 protected:
     IntType Underflow() override {
-        if (_fileHandler->lastOperation != IOSBase::IOMode::In) {
-            _fileHandler->Seek(_readPos, IOSBase::SeekDir::Begin);
-            _fileHandler->lastOperation = IOSBase::IOMode::In;
-        }
-        auto roff = _fileHandler->Read(_readBuffer.data(), BufferSize);
+        auto roff = _fileHandler->ReadAt(_readBuffer.get(), _bufferSize * sizeof(CharType), _readPos);
+        this->buffer.current = this->buffer.begin;
+        this->buffer.end = this->buffer.begin + roff / sizeof(CharType);
         if (roff <= 0) {
             return Traits::eof(); // No more data to read
         }
-        this->buffer.current = this->buffer.begin;
-        this->buffer.end = this->buffer.begin + roff / sizeof(CharType);
         _readPos += roff;
         return Traits::to_int_type(*this->buffer.current);
     }
-    IntType Uflow() override {
-        this->Underflow(); // Ensure the buffer is filled
-        return Traits::to_int_type(*this->buffer.current++);
+public:
+    std::streamsize SGetN(CharType* s, std::streamsize n) override {
+        // Take what is buffered first
+        std::streamsize count = std::min<std::streamsize>(n, this->buffer.end - this->buffer.current);
+        Traits::copy(s, this->buffer.current, count);
+        this->buffer.current += count;
+        // Read large requests straight into s, the buffer would only add a copy
+        if (n - count >= static_cast<std::streamsize>(_bufferSize)) {
+            std::streamsize bytes = _fileHandler->ReadAt(s + count, (n - count) * sizeof(CharType), _readPos);
+            _readPos += bytes;
+            return count + bytes / sizeof(CharType);
+        }
+        return count + BasicIStreamBuffer<CharT, Traits>::SGetN(s + count, n - count);
     }
 };
 
-template <typename CharT, typename Traits = std::char_traits<CharT>>
+template <typename CharT, typename Traits = std::char_traits<CharT>, typename Handler = DefaultFileHandler>
 class BasicOFStreamBuffer: public BasicOStreamBuffer<CharT, Traits> {
 public:
     using CharType = typename BasicOStreamBuffer<CharT, Traits>::CharType;
@@ -157,67 +337,83 @@ public:
     using PosType = typename BasicOStreamBuffer<CharT, Traits>::PosType;
     using OffType = typename BasicOStreamBuffer<CharT, Traits>::OffType;
 
-    static constexpr size_t BufferSize = 1024; ///< Size of the write buffer
+    static constexpr size_t DefaultBufferSize = 64 * 1024 / sizeof(CharType); ///< Default size of the write buffer, in characters
 private:
-    FileStreamHandler* _fileHandler;
-    std::array<CharType, BufferSize> _writeBuffer; ///< Buffer for writing data to the file
-    std::streamsize _writePos = 0; ///< Current position in the file handler for writing
+    Handler* _fileHandler;
+    std::size_t _bufferSize; ///< Size of the write buffer, in characters
+    std::unique_ptr<CharType[]> _writeBuffer; ///< Buffer for writing data to the file
+    std::streamsize _writePos = 0; ///< Position in the file of the beginning of the buffer
 public:
-    BasicOFStreamBuffer(FileStreamHandler* fileHandler)
-        : BasicOStreamBuffer<CharT, Traits>(), _fileHandler(fileHandler) {
-        this->buffer.begin = _writeBuffer.data();
-        this->buffer.current = _writeBuffer.data();
-        this->buffer.end = _writeBuffer.data() + BufferSize;
+    BasicOFStreamBuffer(Handler* fileHandler, std::size_t bufferSize = DefaultBufferSize)
+        : BasicOStreamBuffer<CharT, Traits>(), _fileHandler(fileHandler), _bufferSize(std::max<std::size_t>(bufferSize, 1)),
+          _writeBuffer(std::make_unique_for_overwrite<CharType[]>(_bufferSize)) {
+        this->buffer.begin = _writeBuffer.get();
+        this->buffer.current = _writeBuffer.get();
+        this->buffer.end = _writeBuffer.get() + _bufferSize;
         this->_writePos = this->_fileHandler->Tell();
     }
+    /// @brief Write what is buffered, the base class can only call its own Sync
+    ~BasicOFStreamBuffer() {
+        try {
+            this->Overflow();
+        } catch (...) {
+            // Nowhere to report the error from a destructor
+        }
+    }
 
     PosType SeekPos(PosType pos) override {
-        _fileHandler->lastOperation = IOSBase::IOMode::Out;
+        this->Overflow(); // The buffered characters belong before the seek
         _fileHandler->Seek(pos * sizeof(CharType), IOSBase::SeekDir::Begin);
         _writePos = _fileHandler->Tell();
-        this->Overflow(); // Ensure the buffer is flushed after seeking
         return pos;
     }
 
     PosType SeekOff(OffType off, IOSBase::SeekDir dir) override {
-        _fileHandler->lastOperation = IOSBase::IOMode::Out;
+        if (dir == IOSBase::SeekDir::Current) return SeekPos(Tell() + off); // Relative to what was written, not to the file
+        this->Overflow(); // The buffered characters belong before the seek
         _fileHandler->Seek(off * sizeof(CharType), dir);
         _writePos = _fileHandler->Tell();
-        this->Overflow(); // Ensure the buffer is flushed after seeking
-        return _fileHandler->Tell() / sizeof(CharType);
+        return Tell();
     }
 
     PosType Tell() const {
-        return _writePos / sizeof(CharType) - (this->buffer.end - this->buffer.current);
+        // _writePos is where the buffered characters will be written
+        return _writePos / sizeof(CharType) + (this->buffer.current - this->buffer.begin);
     }
 
+    std::size_t BufferSize() const noexcept { return _bufferSize; }
+
     std::streamsize SPutN(const CharType* s, std::streamsize n) override {
-        if (_fileHandler->lastOperation != IOSBase::IOMode::Out) {
-            _fileHandler->Seek(_writePos, IOSBase::SeekDir::Begin);
-            _fileHandler->lastOperation = IOSBase::IOMode::Out;
-        }
-        std::streamsize bytesWritten = 0;
-        while (bytesWritten < n) {
+        std::streamsize written = 0;
+        while (written < n) {
+            std::streamsize left = n - written;
+            if (this->buffer.current == this->buffer.begin && left >= static_cast<std::streamsize>(_bufferSize)) {
+                // The buffer is empty and would only add a copy, write straight from s
+                std::streamsize bytes = _fileHandler->WriteAt(s + written, left * sizeof(CharType), _writePos);
+                _writePos += bytes;
+                written += bytes / sizeof(CharType);
+                if (bytes < left * static_cast<std::streamsize>(sizeof(CharType))) break; // Write failed
+                continue;
+            }
             if (this->buffer.current == this->buffer.end) {
-                if (Overflow(Traits::to_int_type(*s)) == Traits::eof()) break; // No more space in the buffer
+                if (Overflow() == Traits::eof()) break; // Flush failed
+                continue;
             }
-            *this->buffer.current++ = *s++;
-            ++bytesWritten;
+            // Copy as much as the buffer holds at once
+            std::streamsize chunk = std::min<std::streamsize>(left, this->buffer.end - this->buffer.current);
+            Traits::copy(this->buffer.current, s + written, chunk);
+            this->buffer.current += chunk;
+            written += chunk;
         }
-        _writePos += bytesWritten * sizeof(CharType);
-        return bytesWritten;
+        return written;
     }
 protected:
     IntType Overflow(IntType c = Traits::eof()) override {
         // The buffer content ( begin -> current ) will be written to the file
-        if (_fileHandler->lastOperation != IOSBase::IOMode::Out) {
-            _fileHandler->Seek(_writePos, IOSBase::SeekDir::Begin);
-            _fileHandler->lastOperation = IOSBase::IOMode::Out;
-        }
         IntType wsize = 0;
         if (this->buffer.current != this->buffer.begin) {
             std::streamsize bytesToWrite = this->buffer.current - this->buffer.begin;
-            if (_fileHandler->Write(this->buffer.begin, bytesToWrite * sizeof(CharType)) < bytesToWrite * sizeof(CharType)) {
+            if (_fileHandler->WriteAt(this->buffer.begin, bytesToWrite * sizeof(CharType), _writePos) < bytesToWrite * std::streamsize(sizeof(CharType))) {
                 return Traits::eof(); // Write failed, what happened?
             }
             this->buffer.current = this->buffer.begin; // Reset the buffer
@@ -237,11 +433,15 @@ public:
     }
 }; 
 
-// Simple wrapper for std::ifstream
-template <typename CharT = char, typename Traits = std::char_traits<CharT>>
+/**
+ * @brief A file input stream
+ * @tparam Handler The file handler, PosixFileHandler where pread is available, else FileStreamHandler
+ * @note The file is opened with a sequential access hint, call Advise(FileAccess::Random) before seeking around
+ */
+template <typename CharT = char, typename Traits = std::char_traits<CharT>, typename Handler = DefaultFileHandler>
 class BasicIFStream: public BasicIStream<CharT, Traits> {
-    FileStreamHandler _fileHandler;
-    BasicIFStreamBuffer<CharT, Traits> _buffer;
+    Handler _fileHandler;
+    BasicIFStreamBuffer<CharT, Traits, Handler> _buffer;
 public:
     using CharType = typename BasicIStream<CharT, Traits>::CharType;
     using TraitsType = typename BasicIStream<CharT, Traits>::TraitsType;
@@ -249,20 +449,32 @@ public:
     using PosType = typename BasicIStream<CharT, Traits>::PosType;
     using OffType = typename BasicIStream<CharT, Traits>::OffType;
 
-    BasicIFStream(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read)
-        : BasicIStream<CharT, Traits>(), _fileHandler(path, mode), _buffer(&_fileHandler) { this->InputBuffer(&_buffer); }
+    static constexpr size_t DefaultBufferSize = BasicIFStreamBuffer<CharT, Traits, Handler>::DefaultBufferSize;
 
-    BasicIFStream(const String& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read)
-        : BasicIStream<CharT, Traits>(), _fileHandler(path.c_str(), mode), _buffer(&_fileHandler) { this->InputBuffer(&_buffer); }
+    BasicIFStream(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read, std::size_t bufferSize = DefaultBufferSize)
+        : BasicIStream<CharT, Traits>(), _fileHandler(path, mode), _buffer(&_fileHandler, bufferSize) {
+        this->InputBuffer(&_buffer);
+        _fileHandler.Advise(FileAccess::Sequential);
+    }
+
+    BasicIFStream(const String& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read, std::size_t bufferSize = DefaultBufferSize)
+        : BasicIFStream(path.c_str(), mode, bufferSize) {}
 
-    BasicIFStream(const std::filesystem::path& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read)
-        : BasicIStream<CharT, Traits>(), _fileHandler(path.c_str(), mode), _buffer(&_fileHandler) { this->InputBuffer(&_buffer); }
+    BasicIFStream(const std::filesystem::path& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read, std::size_t bufferSize = DefaultBufferSize)
+        : BasicIFStream(path.c_str(), mode, bufferSize) {}
+
+    /// @brief Hint how the file will be read, from offset for length bytes, 0 for the rest of the file
+    void Advise(FileAccess access, std::streamoff offset = 0, std::streamsize length = 0) { _fileHandler.Advise(access, offset, length); }
 };
 
-template <typename CharT = char, typename Traits = std::char_traits<CharT>>
+/**
+ * @brief A file output stream
+ * @tparam Handler The file handler, PosixFileHandler where pwrite is available, else FileStreamHandler
+ */
+template <typename CharT = char, typename Traits = std::char_traits<CharT>, typename Handler = DefaultFileHandler>
 class BasicOFStream: public BasicOStream<CharT, Traits> {
-    FileStreamHandler _fileHandler;
-    BasicOFStreamBuffer<CharT, Traits> _buffer;
+    Handler _fileHandler;
+    BasicOFStreamBuffer<CharT, Traits, Handler> _buffer;
 public:
     using CharType = typename BasicOStream<CharT, Traits>::CharType;
     using TraitsType = typename BasicOStream<CharT, Traits>::TraitsType;
@@ -270,21 +482,26 @@ public:
     using PosType = typename BasicOStream<CharT, Traits>::PosType;
     using OffType = typename BasicOStream<CharT, Traits>::OffType;
 
-    BasicOFStream(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate)
-        : BasicOStream<CharT, Traits>(), _fileHandler(path, mode), _buffer(&_fileHandler) { this->OutputBuffer(&_buffer); }
+    static constexpr size_t DefaultBufferSize = BasicOFStreamBuffer<CharT, Traits, Handler>::DefaultBufferSize;
+
+    BasicOFStream(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate, std::size_t bufferSize = DefaultBufferSize)
+        : BasicOStream<CharT, Traits>(), _fileHandler(path, mode), _buffer(&_fileHandler, bufferSize) { this->OutputBuffer(&_buffer); }
 
-    BasicOFStream(const String& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate)
-        : BasicOStream<CharT, Traits>(), _fileHandler(path.c_str(), mode), _buffer(&_fileHandler) { this->OutputBuffer(&_buffer); }
+    BasicOFStream(const String& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate, std::size_t bufferSize = DefaultBufferSize)
+        : BasicOFStream(path.c_str(), mode, bufferSize) {}
 
-    BasicOFStream(const std::filesystem::path& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate)
-        : BasicOStream<CharT, Traits>(), _fileHandler(path.c_str(), mode), _buffer(&_fileHandler) { this->OutputBuffer(&_buffer); }
+    BasicOFStream(const std::filesystem::path& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate, std::size_t bufferSize = DefaultBufferSize)
+        : BasicOFStream(path.c_str(), mode, bufferSize) {}
+
+    /// @brief Hint how the file will be accessed, from offset for length bytes, 0 for the rest of the file
+    void Advise(FileAccess access, std::streamoff offset = 0, std::streamsize length = 0) { _fileHandler.Advise(access, offset, length); }
 };
 
-template <typename CharT = char, typename Traits = std::char_traits<CharT>>
+template <typename CharT = char, typename Traits = std::char_traits<CharT>, typename Handler = DefaultFileHandler>
 class BasicIOFStream: public BasicIOStream<CharT, Traits> {
-    FileStreamHandler _fileHandler;
-    BasicIFStreamBuffer<CharT, Traits> _inputBuffer;
-    BasicOFStreamBuffer<CharT, Traits> _outputBuffer;
+    Handler _fileHandler;
+    BasicIFStreamBuffer<CharT, Traits, Handler> _inputBuffer;
+    BasicOFStreamBuffer<CharT, Traits, Handler> _outputBuffer;
 public:
     using CharType = typename BasicIOStream<CharT, Traits>::CharType;
     using TraitsType = typename BasicIOStream<CharT, Traits>::TraitsType;
@@ -292,23 +509,22 @@ public:
     using PosType = typename BasicIOStream<CharT, Traits>::PosType;
     using OffType = typename BasicIOStream<CharT, Traits>::OffType;
 
-    BasicIOFStream(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read | IOSBase::OpenMode::Write)
-        : BasicIOStream<CharT, Traits>(), _fileHandler(path, mode), _inputBuffer(&_fileHandler), _outputBuffer(&_fileHandler) {
-        this->InputBuffer(&_inputBuffer);
-        this->OutputBuffer(&_outputBuffer);
-    }
+    static constexpr size_t DefaultBufferSize = BasicIFStreamBuffer<CharT, Traits, Handler>::DefaultBufferSize;
 
-    BasicIOFStream(const String& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read | IOSBase::OpenMode::Write)
-        : BasicIOStream<CharT, Traits>(), _fileHandler(path.c_str(), mode), _inputBuffer(&_fileHandler), _outputBuffer(&_fileHandler) {
+    BasicIOFStream(const char* path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read | IOSBase::OpenMode::Write, std::size_t bufferSize = DefaultBufferSize)
+        : BasicIOStream<CharT, Traits>(), _fileHandler(path, mode), _inputBuffer(&_fileHandler, bufferSize), _outputBuffer(&_fileHandler, bufferSize) {
         this->InputBuffer(&_inputBuffer);
         this->OutputBuffer(&_outputBuffer);
     }
 
-    BasicIOFStream(const std::filesystem::path& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read | IOSBase::OpenMode::Write)
-        : BasicIOStream<CharT, Traits>(), _fileHandler(path.c_str(), mode), _inputBuffer(&_fileHandler), _outputBuffer(&_fileHandler) {
-        this->InputBuffer(&_inputBuffer);
-        this->OutputBuffer(&_outputBuffer);
-    }
+    BasicIOFStream(const String& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read | IOSBase::OpenMode::Write, std::size_t bufferSize = DefaultBufferSize)
+        : BasicIOFStream(path.c_str(), mode, bufferSize) {}
+
+    BasicIOFStream(const std::filesystem::path& path, IOSBase::OpenMode mode = IOSBase::OpenMode::Read | IOSBase::OpenMode::Write, std::size_t bufferSize = DefaultBufferSize)
+        : BasicIOFStream(path.c_str(), mode, bufferSize) {}
+
+    /// @brief Hint how the file will be accessed, from offset for length bytes, 0 for the rest of the file
+    void Advise(FileAccess access, std::streamoff offset = 0, std::streamsize length = 0) { _fileHandler.Advise(access, offset, length); }
 };
 
 using IFStream = BasicIFStream<char>;
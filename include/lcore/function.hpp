@@ -0,0 +1,238 @@
+/**
+ * @file function.hpp
+ * @brief Allocation-free type-erased callables
+ *
+ * InplaceFunction<Sig, N> owns its callable like std::function, but keeps it in N bytes of inline storage
+ * and never allocates; callables which do not fit are rejected at compile time.
+ * FunctionRef<Sig> refers to a callable owned by someone else, for parameters which are only invoked during the call.
+ */
+#pragma once
+#include "base.hpp"
+#include "exception.hpp"
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+LCORE_NAMESPACE_BEGIN
+
+template <typename Signature, size_t Capacity = 4 * sizeof(void*)>
+class InplaceFunction;
+
+template <typename Signature>
+class FunctionRef;
+
+namespace detail {
+
+template <typename T>
+struct IsInplaceFunction: std::false_type {};
+template <typename Signature, size_t Capacity>
+struct IsInplaceFunction<InplaceFunction<Signature, Capacity>>: std::true_type {};
+
+template <typename T>
+struct IsFunctionRef: std::false_type {};
+template <typename Signature>
+struct IsFunctionRef<FunctionRef<Signature>>: std::true_type {};
+
+/// @brief Lifetime operations of the callable stored in InplaceFunction, nullptr for trivially copyable callables
+struct InplaceOperations {
+    void (*copy)(void* dst, const void* src);
+    void (*move)(void* dst, void* src) noexcept;
+    void (*destroy)(void* storage) noexcept;
+};
+
+/// @brief Invoker of an empty InplaceFunction, shared by all capacities
+template <typename Ret, typename ...Args>
+struct InplaceEmpty {
+    [[noreturn]] static Ret Invoke(void*, Args&&...) {
+        throw RuntimeError("Called an empty InplaceFunction");
+    }
+};
+
+/// @brief Null function pointers make an empty function, like std::function
+template <typename F>
+inline bool IsNullCallable(const F& f) noexcept {
+    if constexpr (std::is_pointer_v<F> || std::is_member_pointer_v<F>) return f == nullptr;
+    else return false;
+}
+
+}
+
+/// @brief A std::function alike callable wrapper with fixed inline storage, it never allocates
+/// @tparam Ret The return type
+/// @tparam Args The parameter types
+/// @tparam Capacity The size of the inline storage, the callable must fit into it
+template <typename Ret, typename ...Args, size_t Capacity>
+class InplaceFunction<Ret(Args...), Capacity> {
+    template <typename, size_t>
+    friend class InplaceFunction;
+
+    using Invoker = Ret (*)(void* storage, Args&&... args);
+    using Operations = detail::InplaceOperations;
+    static constexpr Invoker InvokeEmpty = &detail::InplaceEmpty<Ret, Args...>::Invoke;
+
+    template <typename F>
+    struct Model {
+        static Ret Invoke(void* storage, Args&&... args) {
+            return std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+        }
+        static void Copy(void* dst, const void* src) {
+            new (dst) F(*static_cast<const F*>(src));
+        }
+        static void Move(void* dst, void* src) noexcept {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void Destroy(void* storage) noexcept {
+            static_cast<F*>(storage)->~F();
+        }
+        static constexpr Operations table{Copy, Move, Destroy};
+        static constexpr const Operations* operations = std::is_trivially_copyable_v<F> ? nullptr : &table;
+    };
+
+    alignas(std::max_align_t) mutable unsigned char m_storage[Capacity];
+    Invoker m_invoke = InvokeEmpty;
+    const Operations* m_operations = nullptr;
+
+    template <typename F>
+    void Emplace(F&& f) {
+        using Callable = std::decay_t<F>;
+        static_assert(sizeof(Callable) <= Capacity, "The callable does not fit into the inline storage of InplaceFunction, increase the capacity");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "The callable is over-aligned for InplaceFunction");
+        static_assert(std::is_nothrow_move_constructible_v<Callable>, "The callable of InplaceFunction must be nothrow move constructible");
+        if (detail::IsNullCallable(f)) return;
+        new (m_storage) Callable(std::forward<F>(f));
+        m_invoke = &Model<Callable>::Invoke;
+        m_operations = Model<Callable>::operations;
+    }
+
+    template <size_t OtherCapacity>
+    void CopyFrom(const InplaceFunction<Ret(Args...), OtherCapacity>& other) {
+        if (other.m_operations) other.m_operations->copy(m_storage, other.m_storage);
+        else std::memcpy(m_storage, other.m_storage, OtherCapacity < Capacity ? OtherCapacity : Capacity);
+        m_invoke = other.m_invoke;
+        m_operations = other.m_operations;
+    }
+    template <size_t OtherCapacity>
+    void MoveFrom(InplaceFunction<Ret(Args...), OtherCapacity>& other) noexcept {
+        if (other.m_operations) other.m_operations->move(m_storage, other.m_storage);
+        else std::memcpy(m_storage, other.m_storage, OtherCapacity < Capacity ? OtherCapacity : Capacity);
+        m_invoke = other.m_invoke;
+        m_operations = other.m_operations;
+        other.m_invoke = InvokeEmpty;
+        other.m_operations = nullptr;
+    }
+public:
+    using ResultType = Ret;
+    static constexpr size_t capacity = Capacity;
+
+    InplaceFunction() noexcept = default;
+    InplaceFunction(std::nullptr_t) noexcept {}
+
+    /// @brief Store a callable, it must fit into the inline storage
+    template <typename F>
+    requires (!detail::IsInplaceFunction<std::decay_t<F>>::value) && std::is_invocable_r_v<Ret, std::decay_t<F>&, Args...> && CopyConstructible<std::decay_t<F>>
+    InplaceFunction(F&& f) {
+        Emplace(std::forward<F>(f));
+    }
+
+    InplaceFunction(const InplaceFunction& other) { CopyFrom(other); }
+    InplaceFunction(InplaceFunction&& other) noexcept { MoveFrom(other); }
+    /// @brief Convert from a function with a smaller storage
+    template <size_t OtherCapacity>
+    requires (OtherCapacity < Capacity)
+    InplaceFunction(const InplaceFunction<Ret(Args...), OtherCapacity>& other) { CopyFrom(other); }
+    template <size_t OtherCapacity>
+    requires (OtherCapacity < Capacity)
+    InplaceFunction(InplaceFunction<Ret(Args...), OtherCapacity>&& other) noexcept { MoveFrom(other); }
+
+    ~InplaceFunction() { Reset(); }
+
+    InplaceFunction& operator=(const InplaceFunction& other) {
+        if (this != &other) {
+            InplaceFunction copy(other); // The copy may throw, keep this intact until it succeeded
+            Reset();
+            MoveFrom(copy);
+        }
+        return *this;
+    }
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+    InplaceFunction& operator=(std::nullptr_t) noexcept {
+        Reset();
+        return *this;
+    }
+    template <typename F>
+    requires (!detail::IsInplaceFunction<std::decay_t<F>>::value) && std::is_invocable_r_v<Ret, std::decay_t<F>&, Args...> && CopyConstructible<std::decay_t<F>>
+    InplaceFunction& operator=(F&& f) {
+        Reset();
+        Emplace(std::forward<F>(f));
+        return *this;
+    }
+
+    /// @brief Destroy the stored callable
+    void Reset() noexcept {
+        if (m_operations) m_operations->destroy(m_storage);
+        m_invoke = InvokeEmpty;
+        m_operations = nullptr;
+    }
+
+    explicit operator bool() const noexcept { return m_invoke != InvokeEmpty; }
+    friend bool operator==(const InplaceFunction& f, std::nullptr_t) noexcept { return !f; }
+
+    /// @brief Invoke the stored callable
+    /// @throw RuntimeError if the function is empty
+    Ret operator()(Args... args) const {
+        return m_invoke(m_storage, std::forward<Args>(args)...);
+    }
+};
+
+/// @brief A non-owning reference to a callable, the callable must outlive the reference
+/// Two pointers wide and trivially copyable, pass it by value where a callback is only invoked during the call.
+template <typename Ret, typename ...Args>
+class FunctionRef<Ret(Args...)> {
+    using Invoker = Ret (*)(void* object, Args&&... args);
+
+    void* m_object;
+    Invoker m_invoke;
+
+    template <typename F>
+    static Ret InvokeObject(void* object, Args&&... args) {
+        return std::invoke(*static_cast<F*>(object), std::forward<Args>(args)...);
+    }
+    template <typename F>
+    static Ret InvokeFunction(void* function, Args&&... args) {
+        return std::invoke(reinterpret_cast<F>(function), std::forward<Args>(args)...);
+    }
+public:
+    /// @brief Refer to a callable object, it is not copied
+    template <typename F>
+    requires (!detail::IsFunctionRef<std::decay_t<F>>::value) && (!std::is_function_v<std::remove_reference_t<F>>) && (!std::is_pointer_v<std::decay_t<F>>)
+        && std::is_invocable_r_v<Ret, std::remove_reference_t<F>&, Args...>
+    FunctionRef(F&& f) noexcept
+        : m_object(const_cast<void*>(static_cast<const void*>(std::addressof(f)))),
+          m_invoke(&InvokeObject<std::remove_reference_t<F>>) {}
+
+    /// @brief Refer to a function
+    template <typename F>
+    requires std::is_function_v<F> && std::is_invocable_r_v<Ret, F*, Args...>
+    FunctionRef(F* f) noexcept
+        : m_object(reinterpret_cast<void*>(f)),
+          m_invoke(&InvokeFunction<F*>) {}
+
+    FunctionRef(const FunctionRef&) noexcept = default;
+    FunctionRef& operator=(const FunctionRef&) noexcept = default;
+
+    /// @brief Invoke the referred callable
+    Ret operator()(Args... args) const {
+        return m_invoke(m_object, std::forward<Args>(args)...);
+    }
+};
+
+LCORE_NAMESPACE_END
@@ -5,6 +5,8 @@
 #include "exception.hpp"
 #include "traits.hpp"
 #include "pointer.hpp"
+#include "scan.hpp"
+#include <algorithm>
 #include <iostream>
 
 LCORE_NAMESPACE_BEGIN
@@ -132,8 +134,11 @@ public:
             if (this->buffer.current == this->buffer.end) {
                 if (Underflow() == Traits::eof()) break; // No more data to read
             }
-            *s++ = *this->buffer.current++;
-            ++count;
+            // Copy all that is buffered at once
+            std::streamsize chunk = std::min<std::streamsize>(n - count, this->buffer.end - this->buffer.current);
+            Traits::copy(s + count, this->buffer.current, chunk);
+            this->buffer.current += chunk;
+            count += chunk;
         }
         return count; // Return the number of characters read
     }
@@ -142,7 +147,7 @@ public:
     // Implementation details
     // Peek a character from the stream without removing it
     IntType SBumpC() {
-        if (this->buffer.current == this->buffer.end) this->Underflow();
+        if (this->buffer.current == this->buffer.end && this->Underflow() == Traits::eof()) return Traits::eof();
         return Traits::to_int_type(*this->buffer.current);
     }
     // Get a character from the stream and remove it
@@ -150,6 +155,20 @@ public:
         if (this->buffer.current == this->buffer.end) return this->Uflow();
         return Traits::to_int_type(*this->buffer.current++);
     }
+    /// @brief Append the characters before the next delimiter to out, whole buffered spans at a time, and consume the delimiter
+    /// @return true if the delimiter was found, false if the stream ended first
+    bool ScanUntil(CharType delimiter, std::basic_string<CharType, Traits>& out) {
+        for (;;) {
+            if (this->buffer.current == this->buffer.end && this->Underflow() == Traits::eof()) return false;
+            const CharType* found = detail::FindChar<CharType, Traits>(this->buffer.current, this->buffer.end, delimiter);
+            out.append(this->buffer.current, found - this->buffer.current);
+            if (found != this->buffer.end) {
+                this->buffer.current = const_cast<CharType*>(found) + 1;
+                return true;
+            }
+            this->buffer.current = this->buffer.end;
+        }
+    }
 };
 
 template <
@@ -267,10 +286,7 @@ public:
     /// @brief Read a line from the input stream into a string
     std::basic_string<CharType, Traits> GetLine(CharType delimiter = '\n') {
         std::basic_string<CharType, Traits> line;
-        IntType c;
-        while ((c = Traits::to_char_type(this->GetCh())) != Traits::eof() && c != Traits::to_char_type(delimiter)) {
-            line.push_back(c);
-        }
+        this->InputBuffer()->ScanUntil(delimiter, line);
         return line;
     }
 };
@@ -1,86 +1,649 @@
 #pragma once
 #include "base.hpp"
+#include "cachepolicy.hpp"
+#include "cachestats.hpp"
+#include "function.hpp"
+#include "memstats.hpp"
+#include "timerwheel.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
 #include <functional>
-#include <list>
-#include <map>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 LCORE_NAMESPACE_BEGIN
 
+/**
+ * @brief A cache holding at most max_size entries, or max_size of weight, evicting the least recently used one by default
+ *
+ * Entries live in a slab, allocated in segments so they never move, and are ordered by the eviction policy through 32-bit indices.
+ * An open-addressing index (linear probing, backward-shift deletion) maps keys to entries:
+ * each key is stored once, lookups are O(1) and a Put does not allocate once the slab has grown.
+ * @tparam KView The type taken by lookups, hashing a KView must give the same value as hashing the K it refers to
+ * @tparam Hash The hash function of KView. If it and KeyEqual are transparent (define is_transparent), lookups take
+ * any key type they accept and no K is built, e.g. StringHash looks up String keys from a StringView or a const char*
+ * @tparam KeyEqual Compares a K with a KView
+ * @tparam Policy Picks the entry to evict: LRUPolicy, ClockPolicy, SLRUPolicy or TinyLFUPolicy (see cachepolicy.hpp)
+ * @tparam Weigher Gives the cost of an entry as std::size_t(const K&, const V&), e.g. its size in bytes.
+ * With the default UnitWeigher the cost is 1 and max_size bounds the number of entries
+ * @tparam Clock A std::chrono clock enabling the expiry of entries (SetExpireAfterWrite, SetExpireAfterAccess, SetRefreshAhead).
+ * With the default void, expiry is compiled out and entries carry no deadline
+ * @tparam StatsRecorder Counts hits, misses, puts and evictions for Stats(): CacheStatsCounter.
+ * With the default NoCacheStats nothing is recorded (see cachestats.hpp)
+ * @note The evictor can take the weight of the entry as a third argument, to account the freed memory
+ */
 template <
     typename K,
     typename V,
-    typename Evictor = std::function<void(const K&, const V&)>,
-    typename KView = K
+    typename Evictor = InplaceFunction<void(const K&, const V&)>,
+    typename KView = K,
+    typename Hash = std::hash<KView>,
+    typename KeyEqual = std::equal_to<>,
+    typename Policy = LRUPolicy,
+    typename Weigher = UnitWeigher,
+    typename Clock = void,
+    typename StatsRecorder = NoCacheStats
 >
 class LRUCache {
 public:
     using KeyType = K;
     using ValueType = V;
     using EvictorType = Evictor;
+    using KeyViewType = KView;
+    using PolicyType = Policy;
+    using WeigherType = Weigher;
+    using ClockType = Clock;
+    using StatsRecorderType = StatsRecorder;
+    /// @brief Called with the key of an entry close to its expiry, see SetRefreshAhead
+    using RefresherType = InplaceFunction<void(const K&)>;
 
-    LRUCache(std::size_t max_size, EvictorType evictor = nullptr)
-        : max_size(max_size), evictor(evictor) {}
+    /// @brief The largest supported number of entries, they are linked by 32-bit indices
+    static constexpr std::size_t MaxEntries = std::size_t(1) << 31;
+private:
+    static constexpr bool Weighted = !std::is_same_v<Weigher, UnitWeigher>;
+    struct NoWeight {};
+    static constexpr bool Expiring = !std::is_void_v<Clock>;
+    struct NoExpiry {};
+    /// @brief A key type Q can be looked up as is, without converting it to KView
+    template <typename Q>
+    static constexpr bool Transparent = requires { typename Hash::is_transparent; typename KeyEqual::is_transparent; }
+        && std::is_invocable_r_v<std::size_t, const Hash&, const Q&> && std::is_invocable_r_v<bool, const KeyEqual&, const K&, const Q&>;
+    template <typename Q>
+    static constexpr bool LookupKey = std::is_same_v<Q, K> || std::is_same_v<Q, KView> || Transparent<Q>;
+    /// @brief The expiry settings, in nanoseconds, 0 disables
+    struct ExpirySettings {
+        std::int64_t after_write = 0;
+        std::int64_t after_access = 0;
+        std::int64_t refresh_ahead = 0;
+        RefresherType refresher;
+    };
+    using Index = detail::CacheIndex;
+    using Node = typename Policy::Node;
+    static constexpr Index NullIndex = detail::NullCacheIndex;
+    static constexpr std::size_t MaxSegmentShift = 12; // 4096 entries per slab segment
+    static constexpr std::size_t MinTableSize = 16;
+    static constexpr std::size_t NotFound = ~std::size_t(0);
 
-    ValueType* Get(KView key) {
-        auto it = cache_map.find(key);
-        if (it == cache_map.end()) {
-            return nullptr; // Not found
+    struct Item {
+        KeyType key;
+        ValueType value;
+    };
+    static_assert(std::is_trivially_copyable_v<Node>, "The policy node must be trivially copyable");
+
+    struct Entry {
+        Node node;
+        std::uint32_t tag; // High bits of the hash, also locate the home slot. Links the free list while the entry is unused
+        std::uint32_t generation; // Bumped whenever the item is destroyed, invalidates the EntryRef
+        [[no_unique_address]] std::conditional_t<Weighted, std::size_t, NoWeight> weight;
+        [[no_unique_address]] std::conditional_t<Expiring, detail::TimerNode, NoExpiry> timer;
+        union {
+            Item item; // Constructed while the entry is in use
+        };
+        Entry() {}
+        ~Entry() {}
+    };
+    /// @brief A slot of the index, the tag filters out most mismatches without touching the entry
+    struct Slot {
+        Index entry = NullIndex;
+        std::uint32_t tag = 0;
+    };
+
+    /// @brief Gives the policy access to the nodes
+    struct Nodes {
+        const LRUCache& cache;
+        Node& operator[](Index index) const noexcept { return cache.At(index).node; }
+        std::uint32_t HashOf(Index index) const noexcept { return cache.At(index).tag; }
+        std::size_t WeightOf(Index index) const noexcept { return cache.WeightOf(index); }
+    };
+    /// @brief Gives the timer wheel access to the timer nodes
+    struct Timers {
+        const LRUCache& cache;
+        detail::TimerNode& operator[](Index index) const noexcept { return cache.At(index).timer; }
+    };
+
+    using EntryAllocator = TaggedAllocator<Entry, MemSubsystem::LRUCache>;
+    using SlotAllocator = TaggedAllocator<Slot, MemSubsystem::LRUCache>;
+
+public:
+    /// @brief Refers to an entry, stays safe to use after the entry is evicted or erased (see Touch)
+    struct EntryRef {
+        std::uint32_t index = NullIndex;
+        std::uint32_t generation = 0;
+    };
+
+    /// @param max_size The maximum number of entries clamped to MaxEntries, or the maximum total weight with a Weigher
+    /// @param evictor Called with every entry evicted to make room, expired or dropped by Clear()
+    LRUCache(std::size_t max_size, EvictorType evictor = nullptr, WeigherType weigher = {})
+        : max_size(Weighted ? max_size : std::min(max_size, MaxEntries)), evictor(std::move(evictor)), weigher(std::move(weigher)),
+          policy(this->max_size),
+          segment_shift(std::min<std::size_t>(MaxSegmentShift, std::bit_width(std::max<std::size_t>(this->max_size, 1) - 1))) {}
+
+    /// @brief Clone the slab entry by entry, so the copy keeps the indices and the policy state
+    LRUCache(const LRUCache& other)
+        : max_size(other.max_size), evictor(other.evictor), weigher(other.weigher), policy(other.policy), hasher(other.hasher),
+          equal(other.equal), expiry(other.expiry), wheel(other.wheel), recorder(other.recorder), segment_shift(other.segment_shift) {
+        try {
+            while (used < other.used) {
+                Index index = AllocateEntry();
+                const Entry& source = other.At(index);
+                At(index).node = source.node;
+                At(index).tag = source.tag;
+                At(index).generation = source.generation;
+                At(index).weight = source.weight;
+                At(index).timer = source.timer;
+            }
+            table = other.table;
+            table_shift = other.table_shift;
+            for (const Slot& slot: table) {
+                if (slot.entry == NullIndex) continue;
+                new (&At(slot.entry).item) Item(other.At(slot.entry).item);
+                ++count; // Release() destroys the first count items of the table
+            }
+        } catch (...) {
+            Release();
+            throw;
         }
-        // Move the accessed item to the front of the LRU list
-        lru_list.splice(lru_list.begin(), lru_list, it->second.lru_it);
-        return &it->second.value;
+        free_head = other.free_head;
+        weight = other.weight;
+    }
+    LRUCache(LRUCache&& other) noexcept
+        : max_size(other.max_size), evictor(std::move(other.evictor)), weigher(std::move(other.weigher)), policy(std::move(other.policy)),
+          hasher(std::move(other.hasher)), equal(std::move(other.equal)), expiry(std::move(other.expiry)), wheel(std::move(other.wheel)),
+          recorder(other.recorder), segment_shift(other.segment_shift) {
+        other.policy = Policy(other.max_size);
+        if constexpr (Expiring) other.wheel.Clear(); // Its timers are ours now
+        Swap(other);
     }
+    LRUCache& operator=(LRUCache other) noexcept {
+        std::swap(max_size, other.max_size);
+        std::swap(evictor, other.evictor);
+        std::swap(weigher, other.weigher);
+        std::swap(policy, other.policy);
+        std::swap(hasher, other.hasher);
+        std::swap(equal, other.equal);
+        std::swap(expiry, other.expiry);
+        std::swap(wheel, other.wheel);
+        std::swap(recorder, other.recorder);
+        std::swap(segment_shift, other.segment_shift);
+        Swap(other);
+        return *this;
+    }
+    ~LRUCache() { Release(); }
+
+    /// @brief Look up an entry and record the hit, for LRUPolicy it becomes the most recently used
+    /// @return The value, nullptr if not found. The pointer is valid until the entry is evicted or erased
+    ValueType* Get(const KView& key) { return GetEntry(key); }
+    template <typename Q> requires Transparent<Q>
+    ValueType* Get(const Q& key) { return GetEntry(key); }
 
+    /// @brief Insert or update an entry, evicting the ones chosen by the policy until it fits
+    /// @note An entry heavier than max_size is not cached, the previous value of the key is evicted
     void Put(K key, V value) {
-        auto it = cache_map.find(key);
-        if (it != cache_map.end()) {
-            // Update existing item
-            it->second.value = std::move(value);
-            lru_list.splice(lru_list.begin(), lru_list, it->second.lru_it);
-            return;
-        }
-        // Insert new item
-        if (cache_map.size() >= max_size) {
-            // Evict the least recently used item
-            const K& lru_key = lru_list.back();
-            auto lru_it = cache_map.find(lru_key);
-            if (lru_it != cache_map.end()) {
-                if (evictor) {
-                    evictor(lru_it->second.key, lru_it->second.value);
-                }
-                cache_map.erase(lru_it);
-            }
-            lru_list.pop_back();
+        Emplace(std::move(key), std::move(value));
+    }
+    /**
+     * @brief Insert or update an entry, constructing the value from args in place
+     *
+     * The key is looked up as is when the Hash is transparent, and only converted to a K when the entry is inserted.
+     * @return The value, nullptr if the entry is heavier than max_size: it is not cached and the previous value of the key is evicted
+     */
+    template <typename KArg, typename... Args>
+    ValueType* Emplace(KArg&& key, Args&&... args) {
+        if constexpr (LookupKey<std::remove_cvref_t<KArg>>) {
+            return EmplaceEntry(std::as_const(key), std::forward<KArg>(key), std::forward<Args>(args)...);
+        } else {
+            const KView view(key);
+            return EmplaceEntry(view, std::forward<KArg>(key), std::forward<Args>(args)...);
         }
-        lru_list.push_front(key);
-        cache_map[key] = {std::move(key), std::move(value), lru_list.begin()};
     }
 
-    bool Exists(KView key) const {
-        return cache_map.find(key) != cache_map.end();
+    /// @brief Look up an entry without recording the hit
+    /// @param ref If not null, receives a reference for a later Touch
+    const ValueType* Peek(const KView& key, EntryRef* ref = nullptr) const { return PeekEntry(key, ref); }
+    template <typename Q> requires Transparent<Q>
+    const ValueType* Peek(const Q& key, EntryRef* ref = nullptr) const { return PeekEntry(key, ref); }
+
+    /// @brief Record a hit on an entry found by Peek, nothing happens if it is gone
+    void Touch(EntryRef ref) noexcept {
+        if (ref.index >= used || At(ref.index).generation != ref.generation) return;
+        policy.OnAccess(ref.index, Nodes{*this});
+        if constexpr (Expiring) OnRead(ref.index, Now());
     }
 
+    bool Exists(const KView& key) const { return ExistsEntry(key); }
+    template <typename Q> requires Transparent<Q>
+    bool Exists(const Q& key) const { return ExistsEntry(key); }
+
+    /// @brief Remove an entry without calling the evictor
+    /// @return true if the entry existed
+    bool Erase(const KView& key) { return EraseEntry(key); }
+    template <typename Q> requires Transparent<Q>
+    bool Erase(const Q& key) { return EraseEntry(key); }
+
+    /// @brief Drop all the entries, calling the evictor on each, and release the memory
     void Clear() {
         if (evictor) {
-            for (const auto& pair : cache_map) {
-                evictor(pair.second.key, pair.second.value);
+            for (const Slot& slot: table) {
+                if (slot.entry != NullIndex) NotifyEvicted(slot.entry);
             }
         }
-        cache_map.clear();
-        lru_list.clear();
+        for (std::size_t i = 0; i < count; ++i) recorder.RecordEviction(EvictionCause::Cleared);
+        Release();
     }
-private:
-    struct CacheItem {
-        KeyType key;
-        ValueType value;
-        typename std::list<KeyType>::iterator lru_it;
-    };
 
+    std::size_t Size() const noexcept { return count; }
+    std::size_t MaxSize() const noexcept { return max_size; }
+    /// @brief Get the total weight of the entries, the number of entries with UnitWeigher
+    std::size_t Weight() const noexcept { return weight; }
+
+    /// @brief Expire entries a fixed time after they were written, 0 disables. Applies to the entries written afterwards
+    template <typename Rep, typename Period>
+    void SetExpireAfterWrite(std::chrono::duration<Rep, Period> duration) requires Expiring {
+        expiry.after_write = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+    /// @brief Expire entries a fixed time after they were last read or written, 0 disables.
+    /// Combined with SetExpireAfterWrite, the earliest deadline applies
+    template <typename Rep, typename Period>
+    void SetExpireAfterAccess(std::chrono::duration<Rep, Period> duration) requires Expiring {
+        expiry.after_access = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+    /**
+     * @brief Ask for a reload of the entries read within window of their expire-after-write deadline
+     *
+     * The refresher is called once per write, on the first read in the window, and should start loading the key
+     * in the background: the cache keeps serving the current value until the reload completes with a Put.
+     * It may call Put directly, though not with a different weight.
+     */
+    template <typename Rep, typename Period>
+    void SetRefreshAhead(std::chrono::duration<Rep, Period> window, RefresherType refresher) requires Expiring {
+        expiry.refresh_ahead = std::chrono::duration_cast<std::chrono::nanoseconds>(window).count();
+        expiry.refresher = std::move(refresher);
+    }
+    /**
+     * @brief Remove the expired entries, calling the evictor on each
+     *
+     * Put does it before inserting, call it to free the memory of a cache that is only read.
+     * It costs the number of timer wheel buckets passed since the last call, not a scan of the entries.
+     */
+    void CleanUp() requires Expiring { CleanUp(Now()); }
+    bool Empty() const noexcept { return count == 0; }
+
+    /// @brief Get a snapshot of the counters along with the current size and weight
+    CacheStats Stats() const noexcept requires StatsRecorder::Enabled {
+        CacheStats stats = recorder.Snapshot();
+        stats.size = count;
+        stats.weight = weight;
+        return stats;
+    }
+    /// @brief Get the recorder, for the wrappers looking up through Peek and the loading caches timing their loads
+    StatsRecorder& Recorder() const noexcept { return recorder; }
+private:
     std::size_t max_size;
     EvictorType evictor;
-    std::list<KeyType> lru_list; // Most recently used at front
-    std::map<KeyType, CacheItem> cache_map;
+    [[no_unique_address]] Weigher weigher;
+    Policy policy;
+    [[no_unique_address]] Hash hasher;
+    [[no_unique_address]] KeyEqual equal;
+    [[no_unique_address]] std::conditional_t<Expiring, ExpirySettings, NoExpiry> expiry;
+    [[no_unique_address]] std::conditional_t<Expiring, detail::TimerWheel, NoExpiry> wheel;
+    [[no_unique_address]] mutable StatsRecorder recorder;
+
+    std::size_t segment_shift;
+    std::vector<Entry*> segments;               // Slab segments of (1 << segment_shift) entries
+    std::vector<Slot, SlotAllocator> table;     // Open-addressing index, size is a power of 2
+    std::size_t table_shift = 32;               // 32 - log2(table.size())
+    Index used = 0;                             // Entries handed out from the slab
+    Index free_head = NullIndex;                // Erased entries, linked by tag
+    std::size_t count = 0;
+    std::size_t weight = 0;                     // Sum of the weights of the entries
+
+    template <typename Q>
+    ValueType* GetEntry(const Q& key) {
+        std::uint32_t tag = Tag(key);
+        auto pos = FindSlot(key, tag);
+        if (pos == NotFound) {
+            policy.OnMiss(tag);
+            recorder.RecordMiss();
+            return nullptr; // Not found
+        }
+        Index index = table[pos].entry;
+        if constexpr (Expiring) {
+            std::int64_t now = Now();
+            if (At(index).timer.deadline <= now) {
+                Evict(index, EvictionCause::Expired);
+                policy.OnMiss(tag);
+                recorder.RecordMiss();
+                return nullptr;
+            }
+            policy.OnAccess(index, Nodes{*this});
+            OnRead(index, now);
+        } else {
+            policy.OnAccess(index, Nodes{*this});
+        }
+        recorder.RecordHit();
+        return &At(index).item.value;
+    }
+    template <typename Q>
+    const ValueType* PeekEntry(const Q& key, EntryRef* ref) const {
+        auto pos = FindSlot(key, Tag(key));
+        if (pos == NotFound) return nullptr;
+        Index index = table[pos].entry;
+        if constexpr (Expiring) {
+            if (At(index).timer.deadline <= Now()) return nullptr;
+        }
+        if (ref) *ref = EntryRef{index, At(index).generation};
+        return &At(index).item.value;
+    }
+    template <typename Q>
+    bool ExistsEntry(const Q& key) const {
+        if constexpr (Expiring) return PeekEntry(key, nullptr) != nullptr;
+        else return FindSlot(key, Tag(key)) != NotFound;
+    }
+    template <typename Q>
+    bool EraseEntry(const Q& key) {
+        auto pos = FindSlot(key, Tag(key));
+        if (pos == NotFound) return false;
+        Index index = table[pos].entry;
+        RemoveSlot(pos);
+        Remove(index);
+        return true;
+    }
+
+    /// @brief Emplace with the key to look up, the key to build the K from and the arguments of the V
+    template <typename Q, typename KArg, typename... Args>
+    ValueType* EmplaceEntry(const Q& lookup, KArg&& key, Args&&... args) {
+        std::uint32_t tag = Tag(lookup);
+        recorder.RecordPut();
+        std::int64_t now = 0;
+        if constexpr (Expiring) {
+            now = Now();
+            CleanUp(now); // Expired entries make room before live ones are evicted
+        }
+        auto pos = FindSlot(lookup, tag);
+        if (pos != NotFound) {
+            if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::remove_cvref_t<Args>, V> && ...)) {
+                return Update(table[pos].entry, now, std::forward<Args>(args)...);
+            } else {
+                return Update(table[pos].entry, now, V(std::forward<Args>(args)...));
+            }
+        }
 
+        std::size_t cost = 1;
+        if constexpr (!Weighted) {
+            if (cost > max_size) return nullptr;
+            MakeRoom(cost);
+        }
+        Index index = AllocateEntry();
+        Entry& entry = At(index);
+        try {
+            if ((count + 1) * 4 > table.size() * 3) Rehash(std::max(MinTableSize, table.size() * 2));
+            new (&entry.item) Item{K(std::forward<KArg>(key)), V(std::forward<Args>(args)...)};
+        } catch (...) {
+            FreeEntry(index);
+            throw;
+        }
+        if constexpr (Weighted) {
+            // The weight is known once the item is built, the victims are evicted after
+            cost = weigher(std::as_const(entry.item.key), std::as_const(entry.item.value));
+            try {
+                if (cost <= max_size) MakeRoom(cost);
+            } catch (...) {
+                entry.item.~Item();
+                FreeEntry(index);
+                throw;
+            }
+            if (cost > max_size) {
+                entry.item.~Item();
+                FreeEntry(index);
+                return nullptr;
+            }
+            entry.weight = cost;
+        }
+        entry.tag = tag;
+        policy.OnInsert(index, Nodes{*this});
+        InsertSlot(index, tag);
+        ++count;
+        weight += cost;
+        if constexpr (Expiring) {
+            entry.timer.deadline = detail::TimerNode::Never; // Not scheduled yet
+            OnWrite(index, now);
+        }
+        return &entry.item.value;
+    }
+    /// @brief Set the value of an existing entry, the policy sees it as a new entry if its weight changes
+    template <typename Value>
+    ValueType* Update(Index index, std::int64_t now, Value&& value) {
+        Item& item = At(index).item;
+        std::size_t cost = weigher(std::as_const(item.key), std::as_const(value));
+        if (cost > max_size) {
+            Evict(index);
+            return nullptr;
+        }
+        if (cost == WeightOf(index)) {
+            item.value = std::forward<Value>(value);
+            if constexpr (Expiring) OnWrite(index, now);
+            policy.OnAccess(index, Nodes{*this});
+            return &item.value;
+        }
+        // Out of the policy while the others make room, so the entry cannot be its own victim
+        policy.OnRemove(index, Nodes{*this});
+        try {
+            while (weight - WeightOf(index) + cost > max_size) Evict(policy.Victim(Nodes{*this}));
+            item.value = std::forward<Value>(value);
+        } catch (...) {
+            policy.OnInsert(index, Nodes{*this});
+            throw;
+        }
+        weight = weight - WeightOf(index) + cost;
+        if constexpr (Weighted) At(index).weight = cost;
+        policy.OnInsert(index, Nodes{*this});
+        if constexpr (Expiring) OnWrite(index, now);
+        return &item.value;
+    }
+    /// @brief Evict until an entry of weight cost fits
+    void MakeRoom(std::size_t cost) {
+        while (count > 0 && (weight + cost > max_size || count >= MaxEntries)) {
+            Evict(policy.Victim(Nodes{*this}));
+        }
+    }
+
+    template <typename Key>
+    std::uint32_t Tag(const Key& key) const {
+        std::size_t hash = hasher(key);
+        if constexpr (sizeof(std::size_t) == 8) {
+            return static_cast<std::uint32_t>((hash * 0x9E3779B97F4A7C15ull) >> 32); // Fibonacci hashing spreads identity hashes
+        } else {
+            return static_cast<std::uint32_t>(hash * 0x9E3779B9u);
+        }
+    }
+    std::size_t Home(std::uint32_t tag) const noexcept { return tag >> table_shift; }
+
+    Entry& At(Index index) const noexcept {
+        return segments[index >> segment_shift][index & ((Index(1) << segment_shift) - 1)];
+    }
+    std::size_t WeightOf(Index index) const noexcept {
+        if constexpr (Weighted) return At(index).weight;
+        else return 1;
+    }
+
+    void NotifyEvicted(Index index) {
+        const Item& item = At(index).item;
+        if constexpr (std::is_invocable_v<EvictorType&, const K&, const V&, std::size_t>) {
+            evictor(item.key, item.value, WeightOf(index));
+        } else {
+            evictor(item.key, item.value);
+        }
+    }
+    /// @brief Destroy an entry whose slot is already removed
+    void Remove(Index index) noexcept {
+        if constexpr (Expiring) wheel.Deschedule(index, Timers{*this});
+        policy.OnRemove(index, Nodes{*this});
+        weight -= WeightOf(index);
+        At(index).item.~Item();
+        FreeEntry(index);
+        --count;
+    }
+    void Evict(Index index, EvictionCause cause = EvictionCause::Size) {
+        recorder.RecordEviction(cause);
+        if (evictor) NotifyEvicted(index);
+        RemoveSlot(SlotOf(index));
+        Remove(index);
+    }
+
+    static std::int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+    static std::int64_t Deadline(std::int64_t now, std::int64_t duration) noexcept {
+        if (duration <= 0 || now > detail::TimerNode::Never - duration) return detail::TimerNode::Never;
+        return now + duration;
+    }
+    void OnWrite(Index index, std::int64_t now) noexcept {
+        detail::TimerNode& timer = At(index).timer;
+        timer.write_deadline = Deadline(now, expiry.after_write);
+        timer.refreshing = false;
+        wheel.Reschedule(index, std::min(timer.write_deadline, Deadline(now, expiry.after_access)), Timers{*this});
+    }
+    void OnRead(Index index, std::int64_t now) {
+        detail::TimerNode& timer = At(index).timer;
+        if (expiry.after_access > 0) {
+            wheel.Reschedule(index, std::min(timer.write_deadline, Deadline(now, expiry.after_access)), Timers{*this});
+        }
+        if (expiry.refresh_ahead > 0 && !timer.refreshing && expiry.refresher
+            && timer.write_deadline != detail::TimerNode::Never && timer.write_deadline - expiry.refresh_ahead <= now) {
+            timer.refreshing = true;
+            expiry.refresher(At(index).item.key);
+        }
+    }
+    void CleanUp(std::int64_t now) {
+        wheel.Advance(now, Timers{*this}, [this](Index index) { Evict(index, EvictionCause::Expired); });
+    }
+
+    template <typename Key>
+    std::size_t FindSlot(const Key& key, std::uint32_t tag) const {
+        if (count == 0) return NotFound;
+        std::size_t mask = table.size() - 1;
+        for (std::size_t pos = Home(tag);; pos = (pos + 1) & mask) {
+            const Slot& slot = table[pos];
+            if (slot.entry == NullIndex) return NotFound;
+            if (slot.tag == tag && equal(At(slot.entry).item.key, key)) return pos;
+        }
+    }
+    /// @brief Find the slot pointing at an entry
+    std::size_t SlotOf(Index index) const noexcept {
+        std::size_t mask = table.size() - 1;
+        std::size_t pos = Home(At(index).tag);
+        while (table[pos].entry != index) pos = (pos + 1) & mask;
+        return pos;
+    }
+    void InsertSlot(Index index, std::uint32_t tag) noexcept {
+        std::size_t mask = table.size() - 1;
+        std::size_t pos = Home(tag);
+        while (table[pos].entry != NullIndex) pos = (pos + 1) & mask;
+        table[pos] = Slot{index, tag};
+    }
+    /// @brief Remove a slot, shifting back the following slots of the probe sequence instead of leaving a tombstone
+    void RemoveSlot(std::size_t hole) noexcept {
+        std::size_t mask = table.size() - 1;
+        for (std::size_t pos = (hole + 1) & mask; table[pos].entry != NullIndex; pos = (pos + 1) & mask) {
+            std::size_t home = Home(table[pos].tag);
+            if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+                table[hole] = table[pos];
+                hole = pos;
+            }
+        }
+        table[hole] = Slot{};
+    }
+    void Rehash(std::size_t size) {
+        std::vector<Slot, SlotAllocator> old(size);
+        old.swap(table);
+        table_shift = 32 - std::countr_zero(size);
+        for (const Slot& slot: old) {
+            if (slot.entry != NullIndex) InsertSlot(slot.entry, slot.tag);
+        }
+    }
+
+    Index AllocateEntry() {
+        if (free_head != NullIndex) {
+            Index index = free_head;
+            free_head = At(index).tag;
+            return index;
+        }
+        if ((used >> segment_shift) == segments.size()) {
+            EntryAllocator allocator;
+            std::size_t segment_size = std::size_t(1) << segment_shift;
+            Entry* segment = allocator.allocate(segment_size);
+            std::uninitialized_default_construct_n(segment, segment_size);
+            for (std::size_t i = 0; i < segment_size; ++i) segment[i].generation = 0;
+            try {
+                segments.push_back(segment);
+            } catch (...) {
+                allocator.deallocate(segment, segment_size);
+                throw;
+            }
+        }
+        return used++;
+    }
+    void FreeEntry(Index index) noexcept {
+        ++At(index).generation;
+        At(index).tag = free_head;
+        free_head = index;
+    }
+
+    void Swap(LRUCache& other) noexcept {
+        std::swap(segments, other.segments);
+        std::swap(table, other.table);
+        std::swap(table_shift, other.table_shift);
+        std::swap(used, other.used);
+        std::swap(free_head, other.free_head);
+        std::swap(count, other.count);
+        std::swap(weight, other.weight);
+    }
+    void Release() noexcept {
+        std::size_t remaining = count;
+        for (std::size_t pos = 0; remaining > 0; ++pos) {
+            if (table[pos].entry == NullIndex) continue;
+            At(table[pos].entry).item.~Item();
+            --remaining;
+        }
+        EntryAllocator allocator;
+        for (Entry* segment: segments) {
+            allocator.deallocate(segment, std::size_t(1) << segment_shift);
+        }
+        segments.clear();
+        table = {};
+        table_shift = 32;
+        used = 0;
+        free_head = NullIndex;
+        count = 0;
+        weight = 0;
+        policy = Policy(max_size);
+        if constexpr (Expiring) wheel.Clear();
+    }
 };
 
 LCORE_NAMESPACE_END
@@ -0,0 +1,237 @@
+/**
+ * @file mappedfile.hpp
+ * @brief A file mapped into memory, shared with the other processes mapping it
+ */
+#pragma once
+#include "base.hpp"
+#include "exception.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+LCORE_NAMESPACE_BEGIN
+
+/**
+ * @brief Maps a whole file into memory (MAP_SHARED): the writes to Data() go to the file
+ *
+ * The writes reach the disk when the system flushes the pages, or at the latest on Sync().
+ * A process crash loses nothing written to the mapping, a system crash may lose or tear any page not synced.
+ * @throw SystemError When the file cannot be opened, resized or mapped
+ */
+class MappedFile {
+public:
+    enum class Mode {
+        ReadOnly,
+        ReadWrite, // Creates the file if it does not exist
+    };
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    std::byte* data = nullptr;
+    std::size_t size = 0;
+    Mode mode = Mode::ReadOnly;
+
+#ifdef _WIN32
+    [[noreturn]] static void Fail() { throw SystemError(static_cast<int>(GetLastError())); }
+#else
+    [[noreturn]] static void Fail() { throw SystemError(errno); }
+#endif
+
+    void Map() {
+        if (size == 0) return; // Nothing to map, an empty mapping is an error
+#ifdef _WIN32
+        DWORD protect = mode == Mode::ReadWrite ? PAGE_READWRITE : PAGE_READONLY;
+        mapping = CreateFileMappingW(file, nullptr, protect, DWORD(std::uint64_t(size) >> 32), DWORD(size), nullptr);
+        if (!mapping) Fail();
+        void* view = MapViewOfFile(mapping, mode == Mode::ReadWrite ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+        if (!view) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            Fail();
+        }
+        data = static_cast<std::byte*>(view);
+#else
+        int protect = mode == Mode::ReadWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* view = mmap(nullptr, size, protect, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) Fail();
+        data = static_cast<std::byte*>(view);
+#endif
+    }
+    void Unmap() noexcept {
+        if (!data) return;
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        munmap(data, size);
+#endif
+        data = nullptr;
+    }
+    void Swap(MappedFile& other) noexcept {
+#ifdef _WIN32
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#else
+        std::swap(fd, other.fd);
+#endif
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(mode, other.mode);
+    }
+public:
+    MappedFile() noexcept = default;
+    /**
+     * @brief Open and map a file
+     * @param min_size In ReadWrite mode, the file is extended with zeros to at least this size
+     */
+    MappedFile(const char* path, Mode mode = Mode::ReadWrite, std::size_t min_size = 0): mode(mode) {
+#ifdef _WIN32
+        DWORD access = mode == Mode::ReadWrite ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+        DWORD disposition = mode == Mode::ReadWrite ? OPEN_ALWAYS : OPEN_EXISTING;
+        file = CreateFileA(path, access, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) Fail();
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx(file, &length)) {
+            Close();
+            Fail();
+        }
+        size = static_cast<std::size_t>(length.QuadPart);
+#else
+        fd = open(path, mode == Mode::ReadWrite ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+        if (fd < 0) Fail();
+        struct stat status;
+        if (fstat(fd, &status) != 0) {
+            int error = errno;
+            Close();
+            throw SystemError(error);
+        }
+        size = static_cast<std::size_t>(status.st_size);
+#endif
+        try {
+            if (mode == Mode::ReadWrite && size < min_size) Resize(min_size);
+            else Map();
+        } catch (...) {
+            Close();
+            throw;
+        }
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { Swap(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        MappedFile(std::move(other)).Swap(*this);
+        return *this;
+    }
+    ~MappedFile() { Close(); }
+
+    /// @brief Unmap and close the file, the writes are left to the system to flush
+    void Close() noexcept {
+        Unmap();
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        size = 0;
+    }
+
+    /// @brief Truncate or extend the file with zeros and map it again, Data() changes
+    void Resize(std::size_t new_size) {
+        Unmap();
+#ifdef _WIN32
+        LARGE_INTEGER length;
+        length.QuadPart = static_cast<LONGLONG>(new_size);
+        if (!SetFilePointerEx(file, length, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) Fail();
+#else
+        if (ftruncate(fd, static_cast<off_t>(new_size)) != 0) Fail();
+#endif
+        size = new_size;
+        Map();
+    }
+
+    /**
+     * @brief Write the modified pages of a range to the disk
+     * @param wait Return once they are written, otherwise only schedule the writes
+     */
+    void Sync(std::size_t offset, std::size_t length, bool wait = true) {
+        if (!data || length == 0) return;
+        std::size_t page = PageSize();
+        std::size_t begin = offset / page * page;
+#ifdef _WIN32
+        if (!FlushViewOfFile(data + begin, offset + length - begin)) Fail();
+        if (wait && !FlushFileBuffers(file)) Fail();
+#else
+        if (msync(data + begin, offset + length - begin, wait ? MS_SYNC : MS_ASYNC) != 0) Fail();
+#endif
+    }
+    void Sync(bool wait = true) { Sync(0, size, wait); }
+
+    /// @brief How a range of the mapping will be accessed, see madvise
+    enum class Advice {
+        Normal,
+        Sequential, // Read ahead aggressively, drop the pages behind
+        Random,     // Do not read ahead
+        WillNeed,   // Read the range ahead now
+        DontNeed,   // The range will not be accessed soon
+    };
+    /// @brief Hint the system how a range will be accessed, only a hint: failures are ignored, and it does nothing on Windows
+    void Advise(std::size_t offset, std::size_t length, Advice advice) noexcept {
+        if (!data || offset >= size) return;
+        length = std::min(length, size - offset);
+#ifndef _WIN32
+        std::size_t begin = offset / PageSize() * PageSize();
+        int flag = advice == Advice::Sequential ? MADV_SEQUENTIAL
+                 : advice == Advice::Random     ? MADV_RANDOM
+                 : advice == Advice::WillNeed   ? MADV_WILLNEED
+                 : advice == Advice::DontNeed   ? MADV_DONTNEED
+                                                : MADV_NORMAL;
+        madvise(data + begin, offset + length - begin, flag);
+#endif
+    }
+
+    std::byte* Data() noexcept { return data; }
+    const std::byte* Data() const noexcept { return data; }
+    std::size_t Size() const noexcept { return size; }
+    bool IsOpen() const noexcept {
+#ifdef _WIN32
+        return file != INVALID_HANDLE_VALUE;
+#else
+        return fd >= 0;
+#endif
+    }
+
+    /// @brief Get the granularity of the mappings and of Sync
+    static std::size_t PageSize() noexcept {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+#else
+        static const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        return page;
+#endif
+    }
+};
+
+LCORE_NAMESPACE_END
@@ -0,0 +1,253 @@
+/**
+ * @file mappedsparsebuffer.hpp
+ * @brief A SparseBuffer stored in a sparse file, resumable after a restart
+ */
+#pragma once
+#include "base.hpp"
+#include "checksum.hpp"
+#include "exception.hpp"
+#include "mappedfile.hpp"
+#include "rangeset.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <utility>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+LCORE_NAMESPACE_BEGIN
+
+/**
+ * @brief A sparse buffer whose data lives in a memory-mapped sparse file, so its size is not bounded by the memory
+ *
+ * The file is extended without being written, leaving holes that take no disk space until data is written there,
+ * and the system pages the mapping in and out on demand. The ranges holding data are tracked in a RangeSet,
+ * persisted by sync() to a sidecar file next to the data (path + ".ranges"): opening the buffer again after a restart,
+ * or a crash, finds the data written before the last sync(), e.g. to resume a partial download.
+ *
+ * sync() writes the data to the disk before the sidecar is replaced, so the sidecar never lists data that was not written.
+ * A missing or damaged sidecar leaves the buffer empty, the data file is then overwritten as it is written again.
+ * @tparam T A trivially copyable element type
+ * @note The spans returned by read are valid until the next write past capacity(), resize or destruction,
+ * which may map the file again
+ */
+template <typename T = char>
+class MappedSparseBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "MappedSparseBuffer stores its elements as bytes in a file");
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+private:
+    static constexpr std::uint64_t Magic = 0x455352415053434Cull; // "LCSPARSE"
+    static constexpr std::uint32_t Version = 1;
+    /// @brief The file grows by at least this many bytes at a time when written past its end
+    static constexpr std::size_t GrowthBytes = std::size_t(1) << 24;
+
+    struct SidecarHeader {
+        std::uint64_t magic;
+        std::uint32_t version;
+        std::uint32_t element_size;
+        std::uint64_t size;
+        std::uint64_t count;
+        std::uint64_t checksum; // Of size and the ranges
+    };
+
+    MappedFile file;
+    std::filesystem::path sidecar_path;
+    RangeSet<size_type> valid; // Ranges holding data
+    size_type total_size = 0;  // Total size of the sparse buffer
+    bool dirty = false;        // Written since the last sync
+
+    inline T* elements() noexcept { return reinterpret_cast<T*>(file.Data()); }
+    inline const T* elements() const noexcept { return reinterpret_cast<const T*>(file.Data()); }
+
+    /// @brief Extend the file to hold at least end elements
+    inline void reserve(size_type end) {
+        if (end <= capacity()) return;
+        std::size_t bytes = std::max(end * sizeof(T), std::min(file.Size() * 2, file.Size() + (std::size_t(1) << 30)));
+        bytes = std::max(bytes, GrowthBytes);
+        file.Resize((bytes + GrowthBytes - 1) / GrowthBytes * GrowthBytes);
+    }
+
+    static std::uint64_t ranges_checksum(std::uint64_t size, const std::vector<std::uint64_t>& ranges) noexcept {
+        return detail::Checksum64(ranges.data(), ranges.size() * sizeof(std::uint64_t), detail::Checksum64(&size, sizeof(size)));
+    }
+
+    /// @brief Load the ranges saved by sync(), those past the end of the file are dropped
+    inline void load() {
+        std::FILE* sidecar = std::fopen(sidecar_path.string().c_str(), "rb");
+        if (!sidecar) return;
+        SidecarHeader header;
+        std::vector<std::uint64_t> ranges;
+        bool ok = std::fread(&header, sizeof(header), 1, sidecar) == 1 && header.magic == Magic && header.version == Version &&
+                  header.element_size == sizeof(T) && header.count <= file.Size();
+        if (ok) {
+            ranges.resize(header.count * 2);
+            ok = std::fread(ranges.data(), sizeof(std::uint64_t), ranges.size(), sidecar) == ranges.size() &&
+                 ranges_checksum(header.size, ranges) == header.checksum;
+        }
+        std::fclose(sidecar);
+        if (!ok) return;
+        total_size = header.size;
+        for (std::size_t i = 0; i < ranges.size(); i += 2) {
+            valid.insert(std::min<std::uint64_t>(ranges[i], capacity()), std::min<std::uint64_t>(ranges[i + 1], capacity()));
+        }
+    }
+
+    /// @brief Replace the sidecar with the current ranges, through a temporary file renamed over it
+    inline void save() {
+        std::vector<std::uint64_t> ranges;
+        ranges.reserve(valid.size() * 2);
+        for (const auto& [begin, end]: valid) {
+            ranges.push_back(begin);
+            ranges.push_back(end);
+        }
+        SidecarHeader header{Magic, Version, sizeof(T), total_size, valid.size(), ranges_checksum(total_size, ranges)};
+        std::filesystem::path temporary = sidecar_path;
+        temporary += ".tmp";
+        std::FILE* sidecar = std::fopen(temporary.string().c_str(), "wb");
+        if (!sidecar) throw SystemError(errno);
+        bool ok = std::fwrite(&header, sizeof(header), 1, sidecar) == 1 &&
+                  std::fwrite(ranges.data(), sizeof(std::uint64_t), ranges.size(), sidecar) == ranges.size() &&
+                  std::fflush(sidecar) == 0;
+#ifdef _WIN32
+        ok = ok && _commit(_fileno(sidecar)) == 0;
+#else
+        ok = ok && fsync(fileno(sidecar)) == 0;
+#endif
+        int error = errno;
+        std::fclose(sidecar);
+        if (!ok) throw SystemError(error);
+        std::filesystem::rename(temporary, sidecar_path);
+    }
+public:
+    /**
+     * @brief Open or create the data file at path and load its ranges from the sidecar
+     * @param size The size of the buffer if it is created, e.g. the length of a download. The file is extended as needed
+     * @throw SystemError When the file cannot be opened or mapped
+     */
+    inline explicit MappedSparseBuffer(const std::filesystem::path& path, size_type size = 0)
+        : file(path.string().c_str(), MappedFile::Mode::ReadWrite), sidecar_path(path) {
+        sidecar_path += ".ranges";
+        load();
+        if (valid.empty()) {
+            total_size = size;
+            if (file.Size() != size * sizeof(T)) file.Resize(size * sizeof(T)); // Leftover data is dropped
+        }
+    }
+    MappedSparseBuffer(const MappedSparseBuffer&) = delete;
+    MappedSparseBuffer& operator=(const MappedSparseBuffer&) = delete;
+    /// @brief Sync, and give the file its final size
+    inline ~MappedSparseBuffer() {
+        try {
+            sync();
+            if (file.Size() > total_size * sizeof(T)) file.Resize(total_size * sizeof(T));
+        } catch (...) {
+            // The data of the last sync is kept
+        }
+    }
+
+    /// @brief Get the total size of the sparse buffer
+    inline size_type size() const { return total_size; }
+    /// @brief Get the number of elements the file holds before it must grow
+    inline size_type capacity() const { return file.Size() / sizeof(T); }
+    /// @brief Check if the sparse buffer is empty
+    inline bool empty() const { return total_size == 0; }
+    /// @brief Get the number of contiguous ranges of data in the sparse buffer
+    inline size_type chunk_count() const { return valid.size(); }
+    /// @brief Get the contiguous ranges of data, as {begin, end} pairs
+    inline const RangeSet<size_type>& get_ranges() const { return valid; }
+    inline bool has_data(size_type pos) const { return valid.contains(pos); }
+
+    /// @brief Get the number of elements holding data, in O(1)
+    inline size_type covered_size() const { return valid.length(); }
+    /// @brief Check if [pos, pos + size) holds data, in O(log n)
+    inline bool is_complete(size_type pos, size_type size) const { return valid.contains(pos, pos + size); }
+    /// @brief Check if the whole buffer, [0, size()), holds data
+    inline bool is_complete() const { return valid.contains(0, total_size); }
+    /// @brief Get the ranges of [begin, end) holding no data, in O(log n + holes)
+    inline std::vector<std::pair<size_type, size_type>> holes(size_type begin, size_type end) const { return valid.gaps(begin, end); }
+    /// @brief Get the ranges of the buffer holding no data
+    inline std::vector<std::pair<size_type, size_type>> holes() const { return valid.gaps(0, total_size); }
+    /// @brief Get the first range holding no data at or after pos, in O(log n), std::nullopt if the rest of the buffer is complete
+    inline std::optional<std::pair<size_type, size_type>> first_hole_after(size_type pos) const { return valid.first_gap(pos, total_size); }
+    /// @brief Read data from the sparse buffer, return a span of the data read, up to the first gap
+    inline std::span<const T> read(size_type pos, size_type size) const {
+        auto range = valid.find(pos);
+        if (range == valid.end()) return {};
+        return std::span<const T>(elements() + pos, std::min(size, range->second - pos));
+    }
+    inline std::span<T> read(size_type pos, size_type size) {
+        std::span<const T> data = std::as_const(*this).read(pos, size);
+        return std::span<T>(const_cast<T*>(data.data()), data.size());
+    }
+    /// @brief Write data to the sparse buffer, return the number of elements written
+    inline size_type write(size_type pos, std::span<const T> data) {
+        if (data.empty()) return 0;
+        reserve(pos + data.size());
+        std::memcpy(elements() + pos, data.data(), data.size_bytes());
+        valid.insert(pos, pos + data.size());
+        total_size = std::max(total_size, pos + data.size());
+        dirty = true;
+        return data.size();
+    }
+    /// @brief Write data to the sparse buffer, without overwriting existing data, return the number of elements written
+    inline size_type write_sparse(size_type pos, std::span<const T> data) {
+        if (data.empty()) return 0;
+        reserve(pos + data.size());
+        valid.for_each_gap(pos, pos + data.size(), [&](size_type begin, size_type end) {
+            std::memcpy(elements() + begin, data.data() + (begin - pos), (end - begin) * sizeof(T));
+        });
+        valid.insert(pos, pos + data.size());
+        total_size = std::max(total_size, pos + data.size());
+        dirty = true;
+        return data.size();
+    }
+    /**
+     * @brief Resize the sparse buffer, if the new size is smaller, truncate the buffer and the file
+     *
+     * The sidecar is saved before the file is truncated: the truncated part reads back as zeros once the file grows
+     * again, so a sidecar still listing it would pass those zeros for data after a crash.
+     * @throw SystemError When the sync before the truncation fails, the file is then not truncated
+     */
+    inline void resize(size_type new_size) {
+        bool shrink = new_size < total_size;
+        if (shrink) valid.erase(new_size, total_size);
+        total_size = new_size;
+        dirty = true;
+        if (shrink && capacity() > new_size) {
+            sync();
+            file.Resize(new_size * sizeof(T));
+        }
+    }
+
+    /**
+     * @brief Write the data to the disk, then save the ranges to the sidecar
+     * @throw SystemError When a write fails, the sidecar of the previous sync is kept
+     */
+    inline void sync() {
+        if (!dirty) return;
+        file.Sync();
+        save();
+        dirty = false;
+    }
+};
+
+LCORE_NAMESPACE_END
@@ -1,9 +1,14 @@
 #pragma once
 #include "base.hpp"
+#include "allocator.hpp"
 #include "traits.hpp"
 #include "exception.hpp"
+#include "memstats.hpp"
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
 
 LCORE_NAMESPACE_BEGIN
 
@@ -30,14 +35,193 @@ public:
     }
 };
 
+/// @brief Allocation counters of the control block pool
+struct ControlBlockPoolStats {
+    size_t allocations = 0;         ///< Control blocks handed out
+    size_t deallocations = 0;       ///< Control blocks given back
+    size_t pool_hits = 0;           ///< Allocations served from a free list, without calling the system allocator
+    size_t system_allocations = 0;  ///< Allocations calling the system allocator (chunk refills and oversized blocks)
+};
+
 namespace detail {
 
+/// @brief Pool for the control blocks of SharedPtr, on the size-class pools of SizeClassAllocator
+/// Blocks come from the thread cache of BlockPools: a block freed by another thread goes to the cache
+/// of that thread, whose surplus goes back to the shared lists. Larger blocks use the global operator new.
+class ControlBlockPool: public StaticClass {
+    struct Counters {
+        std::atomic<size_t> allocations = 0;
+        std::atomic<size_t> deallocations = 0;
+        std::atomic<size_t> poolHits = 0;
+        std::atomic<size_t> systemAllocations = 0;
+    };
+    static Counters& GetCounters() noexcept {
+        static Counters counters;
+        return counters;
+    }
+
+    static void Bump(std::atomic<size_t>& counter) noexcept { counter.fetch_add(1, std::memory_order_relaxed); }
+public:
+    /// @brief Allocate memory for a control block of the given size
+    static void* Allocate(size_t size) {
+        auto& counters = GetCounters();
+        Bump(counters.allocations);
+        if (!SizeClass::Fits(size, alignof(std::max_align_t))) [[unlikely]] {
+            Bump(counters.systemAllocations);
+            return ::operator new(size);
+        }
+        size_t reserved;
+        void* p = BlockPools::Allocate(SizeClass::Index(size), reserved);
+        Bump(reserved ? counters.systemAllocations : counters.poolHits);
+        return p;
+    }
+
+    /// @brief Give back memory obtained from Allocate() with the same size
+    static void Deallocate(void* p, size_t size) noexcept {
+        if (!p) return;
+        auto& counters = GetCounters();
+        Bump(counters.deallocations);
+        if (!SizeClass::Fits(size, alignof(std::max_align_t))) [[unlikely]] {
+            ::operator delete(p, size);
+            return;
+        }
+        BlockPools::Deallocate(p, SizeClass::Index(size));
+    }
+
+    static ControlBlockPoolStats Stats() noexcept {
+        auto& counters = GetCounters();
+        return ControlBlockPoolStats{
+            counters.allocations.load(std::memory_order_relaxed),
+            counters.deallocations.load(std::memory_order_relaxed),
+            counters.poolHits.load(std::memory_order_relaxed),
+            counters.systemAllocations.load(std::memory_order_relaxed),
+        };
+    }
+};
+
+/// @brief Mixin routing the allocation of a control block to the ControlBlockPool
+template <MemSubsystem Subsystem = MemSubsystem::ControlBlock>
+struct PooledControlBlock {
+    static void* operator new(size_t size) {
+        void* p = ControlBlockPool::Allocate(size);
+        MemStatsAllocate(Subsystem, size);
+        return p;
+    }
+    static void operator delete(void* p, size_t size) {
+        MemStatsDeallocate(Subsystem, size);
+        ControlBlockPool::Deallocate(p, size);
+    }
+    // Blocks embedding an over-aligned object (MakePtr) bypass the pool, which only aligns to max_align_t
+    static void* operator new(size_t size, std::align_val_t alignment) {
+        void* p = ::operator new(size, alignment);
+        MemStatsAllocate(Subsystem, size);
+        return p;
+    }
+    static void operator delete(void* p, size_t size, std::align_val_t alignment) {
+        MemStatsDeallocate(Subsystem, size);
+        ::operator delete(p, size, alignment);
+    }
+};
+
+/// @brief A thread owning biased reference counts (see MakeBiasedPtr)
+/// Other threads queue the blocks whose shared count went negative, the owner merges them later.
+/// Records are never freed: control blocks keep pointing at the record of their owner after it exits.
+class BiasedRefOwner {
+public:
+    using MergeFunction = void (*)(void* block);
+private:
+    struct QueuedBlock {
+        void* block;
+        MergeFunction merge;
+    };
+    struct Guard {
+        ~Guard() {
+            if (!t_current) return;
+            t_current->Exit();
+            t_current = nullptr;
+        }
+    };
+
+    std::mutex m_mutex;
+    bool m_alive = true;
+    std::vector<QueuedBlock> m_queue;
+    std::atomic<bool> m_pending = false;
+    BiasedRefOwner* m_next = nullptr;
+
+    static inline std::atomic<BiasedRefOwner*> s_records = nullptr; // Keeps every record reachable
+    static inline thread_local BiasedRefOwner* t_current = nullptr;
+    static inline thread_local Guard t_guard;
+
+    void Exit() {
+        std::vector<QueuedBlock> blocks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_alive = false;
+            blocks.swap(m_queue);
+        }
+        for (auto& queued: blocks) queued.merge(queued.block);
+    }
+public:
+    /// @brief Get the record of the current thread, created on demand
+    static BiasedRefOwner* Current() {
+        if (!t_current) {
+            t_current = new BiasedRefOwner();
+            t_current->m_next = s_records.load(std::memory_order_relaxed);
+            while (!s_records.compare_exchange_weak(t_current->m_next, t_current, std::memory_order_release)) {}
+            (void)&t_guard; // Register the guard, queued blocks are merged on thread exit
+        }
+        return t_current;
+    }
+    /// @brief Get the record of the current thread, nullptr if it never owned a biased block
+    static BiasedRefOwner* Peek() noexcept { return t_current; }
+
+    /// @brief Queue a block for an explicit merge by the owner
+    /// @return false if the owner thread is gone, the caller has to merge the block itself
+    bool Enqueue(void* block, MergeFunction merge) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_alive) return false;
+        m_queue.push_back({block, merge});
+        m_pending.store(true, std::memory_order_release);
+        return true;
+    }
+    /// @brief Check whether blocks are waiting for a merge
+    bool Pending() const noexcept { return m_pending.load(std::memory_order_relaxed); }
+    /// @brief Merge the queued blocks, must be called from the owner thread
+    void Drain() {
+        if (!m_pending.load(std::memory_order_acquire)) return;
+        std::vector<QueuedBlock> blocks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            blocks.swap(m_queue);
+            m_pending.store(false, std::memory_order_relaxed);
+        }
+        for (auto& queued: blocks) queued.merge(queued.block);
+    }
+};
+
+/// @brief State of a control block in biased reference counting mode
+struct BiasedRefCount {
+    std::atomic<BiasedRefOwner*> owner = nullptr; ///< Cleared once the counts are merged
+    std::atomic<size_t> count = 0;                ///< Only modified by the owner thread
+    std::atomic<bool> queued = false;
+};
+
 // Control block for SharedPtr & WeakPtr
 template <template <typename> typename AtomicType = std::atomic>
 class ControlBlockBase {
 public:
     AtomicType<size_t> shared_count = 1; // Start with 1 for the initial shared_ptr
-    AtomicType<size_t> weak_count = 0;
+    AtomicType<size_t> weak_count = 1; // The shared references together hold one, dropped by Release()
+    /// @brief Biased reference counting state, nullptr unless the block comes from MakeBiasedPtr
+    BiasedRefCount* biased = nullptr;
+
+    /**
+     * Biased mode: references taken on the owner thread are counted by biased->count with plain loads and stores,
+     * the other threads use shared_count, which may go "negative" (wraps around) when they drop references created by the owner.
+     * When the owner count drops to zero (or the owner explicitly merges a queued block), it is added to shared_count
+     * together with MergedBias, after that shared_count alone holds the number of references plus MergedBias.
+     */
+    static constexpr size_t MergedBias = size_t(1) << 62;
 
     /// @brief Destroy the object (Do not deallocate the memory!!!)
     virtual void Destory() = 0;
@@ -45,38 +229,106 @@ public:
     virtual void Deallocate() = 0;
     virtual ~ControlBlockBase() = default;
 
-    void Ref() noexcept { ++shared_count; }
+    void Ref() noexcept {
+        if (biased) [[unlikely]] return BiasedRef();
+        ++shared_count;
+    }
     bool Unref() {
-        if (--shared_count == 0) {
-            /**
-             * Why weak_count is cached here?
-             * When Destory() is called, the target object may own weak references to this control block.
-             * WeakUnref() will be called and weak_count will be decremented.
-             * if weak_count reaches 0, this control block will be deallocated by WeakUnref().
-             * When Destory() is returned, this control block is deallocated and the weak_count is no longer valid.
-             * So we cache the weak_count before calling Destory() to ensure that we can safely check if the control block is deallocated.
-             */
-            size_t weak_count = this->weak_count;
-            Destory();
-            if (weak_count == 0) {
-                Deallocate();
-                return true; // Indicates that the control block is deallocated
-            }
-        }
+        if (biased) [[unlikely]] return BiasedUnref();
+        if (--shared_count == 0) return Release();
         return false; // Indicates that the control block is still alive
     }
     void WeakRef() noexcept { ++weak_count; }
     bool WeakUnref() {
-        if (--weak_count == 0 && shared_count == 0) {
+        if (--weak_count == 0) {
             Deallocate();
             return true; // Indicates that the control block is deallocated
         }
         return false; // Indicates that the control block is still alive
     }
+
+    /// @brief Get the number of shared references, only approximate for a biased block read by another thread
+    size_t UseCount() const noexcept {
+        if (!biased) return shared_count;
+        size_t shared = shared_count;
+        if (IsMerged(shared)) return shared - MergedBias;
+        return biased->count.load(std::memory_order_relaxed) + shared;
+    }
+    /// @brief Check whether the object is destroyed
+    bool Expired() const noexcept {
+        if (biased) return size_t(shared_count) == MergedBias;
+        return shared_count == 0;
+    }
+private:
+    bool Release() {
+        /**
+         * The weak reference of the shared ones is only dropped once Destory() returns:
+         * the target object may own weak references to this control block (EnableSharedFromThis),
+         * and another thread may drop the last WeakPtr while the object is being destroyed,
+         * neither may deallocate the block under Destory().
+         */
+        Destory();
+        return WeakUnref();
+    }
+
+    static constexpr bool IsNegative(size_t shared) noexcept { return shared >= (size_t(1) << 63); }
+    static constexpr bool IsMerged(size_t shared) noexcept { return !IsNegative(shared) && shared >= MergedBias / 2; }
+
+    bool IsOwner(BiasedRefOwner* self) const noexcept {
+        return self && biased->owner.load(std::memory_order_relaxed) == self;
+    }
+
+    void BiasedRef() noexcept {
+        if (IsOwner(BiasedRefOwner::Peek())) {
+            biased->count.store(biased->count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        shared_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool BiasedUnref() {
+        auto self = BiasedRefOwner::Peek();
+        if (IsOwner(self)) {
+            size_t count = biased->count.load(std::memory_order_relaxed) - 1;
+            biased->count.store(count, std::memory_order_relaxed);
+            bool deallocated = count == 0 && Merge();
+            if (self->Pending()) [[unlikely]] self->Drain();
+            return deallocated;
+        }
+        // Pin the block first: once the count is decremented, a merge on another thread may release it
+        WeakRef();
+        size_t shared = shared_count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        if (shared == MergedBias) {
+            Release();
+        } else if (IsNegative(shared) && !biased->queued.exchange(true, std::memory_order_acq_rel)) {
+            // The owner count holds references dropped by this thread, ask the owner to merge, MergeQueued drops the pin
+            auto owner = biased->owner.load(std::memory_order_acquire);
+            if (owner && owner->Enqueue(this, &MergeQueued)) return false;
+            // Merged meanwhile, or the owner thread is gone and its count will never change again
+            if (owner) Merge();
+        }
+        return WeakUnref();
+    }
+
+    /// @brief Move the owner count into shared_count
+    bool Merge() {
+        size_t count = biased->count.load(std::memory_order_relaxed);
+        biased->count.store(0, std::memory_order_relaxed);
+        biased->owner.store(nullptr, std::memory_order_release);
+        size_t shared = shared_count.fetch_add(count + MergedBias, std::memory_order_acq_rel) + count + MergedBias;
+        if (shared == MergedBias) return Release();
+        return false;
+    }
+
+    static void MergeQueued(void* block) {
+        auto cb = static_cast<ControlBlockBase*>(block);
+        if (cb->biased->owner.load(std::memory_order_relaxed)) cb->Merge();
+        cb->WeakUnref();
+    }
 };
 
 template <typename T, template <typename> typename AtomicType = std::atomic>
-class ControlBlock : public ControlBlockBase<AtomicType> {
+class ControlBlock : public ControlBlockBase<AtomicType>, public PooledControlBlock<> {
 public:
     using Pointer = RawPtr<T>;
     Pointer ptr;
@@ -94,7 +346,7 @@ public:
 
 template <typename T, typename Deleter, template <typename> typename AtomicType = std::atomic>
 requires InvokeAble<Deleter, T*>
-class ControlBlockDeleter : public ControlBlockBase<AtomicType> {
+class ControlBlockDeleter : public ControlBlockBase<AtomicType>, public PooledControlBlock<> {
 public:
     using Pointer = RawPtr<T>;
     Pointer ptr;
@@ -196,6 +448,8 @@ class SharedPtr {
     friend class WeakPtr;
     template <typename U, typename... Args>
     friend SharedPtr<U> MakePtr(Args&&... args);
+    template <typename U, typename... Args>
+    friend SharedPtr<U> MakeBiasedPtr(Args&&... args);
 protected:
     RawPtr<T> m_tptr;
     RawPtr<detail::ControlBlockBase<>> m_cb = nullptr;
@@ -383,7 +637,7 @@ public:
 
     /// @brief Get the use count of the shared pointer
     inline size_t UseCount() const noexcept {
-        return m_cb ? size_t(m_cb->shared_count) : 0;
+        return m_cb ? m_cb->UseCount() : 0;
     }
 
     /// @brief Swap the shared pointer with another
@@ -527,7 +781,7 @@ public:
 
     // Interface methods
     inline bool Expired() const noexcept {
-        return !m_cb || m_cb->shared_count == 0;
+        return !m_cb || m_cb->Expired();
     }
     
     inline SharedPtr<T> Lock() const noexcept {
@@ -540,7 +794,7 @@ public:
     inline constexpr bool IsConst() const noexcept { return std::is_const_v<T>; }
 
     inline size_t UseCount() const noexcept {
-        return m_cb ? size_t(m_cb->shared_count) : 0;
+        return m_cb ? m_cb->UseCount() : 0;
     }
 };
 
@@ -551,9 +805,9 @@ using Ptr = SharedPtr<T>;
 template <typename T, typename... Args>
 inline SharedPtr<T> MakePtr(Args&&... args) {
     // return SharedPtr<T>(new T(std::forward<Args>(args)...));
-    struct CbWithT: public detail::ControlBlockBase<> {
-        char mem[sizeof(T)];
-        
+    struct CbWithT: public detail::ControlBlockBase<>, public detail::PooledControlBlock<MemSubsystem::MakePtr> {
+        alignas(T) char mem[sizeof(T)];
+
         CbWithT(Args&&... args) {
             new (mem) T(std::forward<Args>(args)...); // Placement new to construct T in the memory
             this->shared_count = 0; // Start with 0 for the initial shared_ptr
@@ -567,14 +821,8 @@ inline SharedPtr<T> MakePtr(Args&&... args) {
             delete this; // Deallocate the control block itself
         }
     };
-    auto mem = new char[sizeof(CbWithT)];
-    try {
-        auto cb = new (mem) CbWithT{std::forward<Args>(args)...};
-        return SharedPtr<T>(RawPtr<T>(reinterpret_cast<T*>(cb->mem)), cb);
-    } catch (...) {
-        delete[] mem; // Clean up memory in case of exception
-        throw;
-    }
+    auto cb = new CbWithT{std::forward<Args>(args)...}; // The memory is released if the constructor of T throws
+    return SharedPtr<T>(RawPtr<T>(reinterpret_cast<T*>(cb->mem)), cb);
 };
 
 template <typename T, typename... Args>
@@ -582,6 +830,46 @@ inline SharedPtr<T> New(Args&&... args) {
     return MakePtr<T>(std::forward<Args>(args)...);
 };
 
+/// @brief Create a shared pointer in biased reference counting mode, owned by the current thread
+/// Copies and releases on the owner thread are plain (non-atomic) increments and decrements,
+/// other threads use an atomic counter, both are merged once the owner drops its last reference.
+/// Suited to objects created and mostly used on one thread, but occasionally shared with others.
+template <typename T, typename... Args>
+inline SharedPtr<T> MakeBiasedPtr(Args&&... args) {
+    struct CbWithT: public detail::ControlBlockBase<>, public detail::PooledControlBlock<MemSubsystem::MakePtr> {
+        detail::BiasedRefCount state;
+        alignas(T) char mem[sizeof(T)];
+
+        CbWithT(Args&&... args) {
+            new (mem) T(std::forward<Args>(args)...); // Placement new to construct T in the memory
+            this->shared_count = 0; // All the references are counted by the owner
+            this->state.owner = detail::BiasedRefOwner::Current();
+            this->biased = &state;
+        }
+
+        void Destory() override {
+            T* obj = reinterpret_cast<T*>(mem);
+            obj->~T(); // Call the destructor of T
+        }
+        void Deallocate() override {
+            delete this; // Deallocate the control block itself
+        }
+    };
+    auto cb = new CbWithT{std::forward<Args>(args)...};
+    return SharedPtr<T>(RawPtr<T>(reinterpret_cast<T*>(cb->mem)), cb);
+}
+
+/// @brief Merge the biased blocks of the current thread which other threads queued
+/// This is also done when the owner drops a reference and when it exits, call it on threads that rarely do either.
+inline void DrainBiasedRefQueue() {
+    if (auto owner = detail::BiasedRefOwner::Peek()) owner->Drain();
+}
+
+/// @brief Get the allocation counters of the pool behind SharedPtr(RawPtr) control blocks
+inline ControlBlockPoolStats GetControlBlockPoolStats() noexcept {
+    return detail::ControlBlockPool::Stats();
+}
+
 /// @brief Unique pointer
 /// @tparam T The type of the pointer
 /// @tparam Deleter The deleter of the pointer
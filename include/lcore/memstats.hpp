@@ -0,0 +1,155 @@
+/**
+ * @file memstats.hpp
+ * @brief Per-subsystem memory accounting
+ *
+ * Built with LCORE_ENABLE_MEMSTATS, the allocations of the library containers are counted per subsystem,
+ * DumpMemStats() shows which part of the library grows in a long-running process.
+ * Without it every hook compiles to nothing and the counters stay zero.
+ */
+#pragma once
+#include "base.hpp"
+#include <atomic>
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <new>
+
+LCORE_NAMESPACE_BEGIN
+
+#ifdef LCORE_ENABLE_MEMSTATS
+inline constexpr bool MemStatsEnabled = true;
+#else
+inline constexpr bool MemStatsEnabled = false;
+#endif
+
+/// @brief The parts of the library whose allocations are accounted
+enum class MemSubsystem: std::size_t {
+    MakePtr,        ///< Objects created by MakePtr/MakeBiasedPtr, with their control blocks
+    ControlBlock,   ///< Control blocks of SharedPtr adopting a pointer
+    SparseBuffer,   ///< SparseBuffer chunks
+    String,         ///< String stream buffers
+    LRUCache,       ///< LRUCache nodes
+    Coroutine,      ///< Coroutine frames of Task
+    Count
+};
+
+/// @brief Get the printable name of a subsystem
+constexpr const char* MemSubsystemName(MemSubsystem subsystem) noexcept {
+    switch (subsystem) {
+        case MemSubsystem::MakePtr: return "MakePtr";
+        case MemSubsystem::ControlBlock: return "ControlBlock";
+        case MemSubsystem::SparseBuffer: return "SparseBuffer";
+        case MemSubsystem::String: return "String";
+        case MemSubsystem::LRUCache: return "LRUCache";
+        case MemSubsystem::Coroutine: return "Coroutine";
+        default: return "Unknown";
+    }
+}
+
+/// @brief Counters of a subsystem
+struct MemStats {
+    std::size_t live_bytes = 0;     ///< Bytes currently allocated
+    std::size_t peak_bytes = 0;     ///< Highest live_bytes seen
+    std::size_t allocations = 0;    ///< Number of allocations since start
+    std::size_t deallocations = 0;  ///< Number of deallocations since start
+    std::size_t total_bytes = 0;    ///< Bytes allocated since start
+};
+
+namespace detail {
+
+struct MemCounter {
+    std::atomic<std::size_t> live_bytes = 0;
+    std::atomic<std::size_t> peak_bytes = 0;
+    std::atomic<std::size_t> allocations = 0;
+    std::atomic<std::size_t> deallocations = 0;
+    std::atomic<std::size_t> total_bytes = 0;
+};
+
+inline MemCounter memCounters[static_cast<std::size_t>(MemSubsystem::Count)];
+
+inline void MemStatsAllocate([[maybe_unused]] MemSubsystem subsystem, [[maybe_unused]] std::size_t bytes) noexcept {
+#ifdef LCORE_ENABLE_MEMSTATS
+    auto& counter = memCounters[static_cast<std::size_t>(subsystem)];
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    counter.total_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    auto live = counter.live_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    auto peak = counter.peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !counter.peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+#endif
+}
+
+inline void MemStatsDeallocate([[maybe_unused]] MemSubsystem subsystem, [[maybe_unused]] std::size_t bytes) noexcept {
+#ifdef LCORE_ENABLE_MEMSTATS
+    auto& counter = memCounters[static_cast<std::size_t>(subsystem)];
+    counter.deallocations.fetch_add(1, std::memory_order_relaxed);
+    counter.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+#endif
+}
+
+/// @brief Mixin accounting the heap allocations of a class to a subsystem
+template <MemSubsystem Subsystem>
+struct MemStatsTagged {
+#ifdef LCORE_ENABLE_MEMSTATS
+    static void* operator new(std::size_t size) {
+        void* p = ::operator new(size);
+        MemStatsAllocate(Subsystem, size);
+        return p;
+    }
+    static void operator delete(void* p, std::size_t size) noexcept {
+        MemStatsDeallocate(Subsystem, size);
+        ::operator delete(p, size);
+    }
+#endif
+};
+
+/// @brief std::allocator which accounts its allocations to a subsystem
+template <typename T, MemSubsystem Subsystem>
+class MemStatsAllocator: public std::allocator<T> {
+public:
+    using value_type = T;
+    template <typename U>
+    struct rebind { using other = MemStatsAllocator<U, Subsystem>; };
+
+    MemStatsAllocator() noexcept = default;
+    template <typename U>
+    MemStatsAllocator(const MemStatsAllocator<U, Subsystem>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        T* p = std::allocator<T>::allocate(n);
+        MemStatsAllocate(Subsystem, n * sizeof(T));
+        return p;
+    }
+    void deallocate(T* p, std::size_t n) noexcept {
+        MemStatsDeallocate(Subsystem, n * sizeof(T));
+        std::allocator<T>::deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const MemStatsAllocator<U, Subsystem>&) const noexcept { return true; }
+};
+
+}
+
+/// @brief The allocator the containers of a subsystem use, std::allocator unless LCORE_ENABLE_MEMSTATS is defined
+template <typename T, MemSubsystem Subsystem>
+using TaggedAllocator = Conditional<MemStatsEnabled, detail::MemStatsAllocator<T, Subsystem>, std::allocator<T>>;
+
+/// @brief Get the counters of a subsystem
+inline MemStats GetMemStats(MemSubsystem subsystem) noexcept {
+    auto& counter = detail::memCounters[static_cast<std::size_t>(subsystem)];
+    return MemStats{
+        .live_bytes = counter.live_bytes.load(std::memory_order_relaxed),
+        .peak_bytes = counter.peak_bytes.load(std::memory_order_relaxed),
+        .allocations = counter.allocations.load(std::memory_order_relaxed),
+        .deallocations = counter.deallocations.load(std::memory_order_relaxed),
+        .total_bytes = counter.total_bytes.load(std::memory_order_relaxed),
+    };
+}
+
+/// @brief Print the counters of every subsystem, with the allocation rate since the previous dump
+/// @param os The output stream
+void DumpMemStats(std::ostream& os);
+/// @brief Print the counters of every subsystem to std::cerr
+void DumpMemStats();
+
+LCORE_NAMESPACE_END
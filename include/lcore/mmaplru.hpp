@@ -0,0 +1,408 @@
+/**
+ * @file mmaplru.hpp
+ * @brief An LRU cache stored in a memory-mapped file, reopened warm after a restart
+ */
+#pragma once
+#include "base.hpp"
+#include "checksum.hpp"
+#include "exception.hpp"
+#include "mappedfile.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+LCORE_NAMESPACE_BEGIN
+
+/**
+ * @brief An LRU cache of trivially copyable keys and values whose slab, hash index and recency list live in a file
+ *
+ * Opening the file of a previous run finds the cache as it was left, so a restarted process starts warm.
+ * The data structures are the ones of LRUCache, addressed by 32-bit indices inside the mapping.
+ *
+ * Crash consistency: every entry carries a checksum of its key and value, written last. The header records whether
+ * the file was synced since its last write: a clean file is reopened as is, otherwise the cache is recovered by
+ * scanning the slab, keeping the entries whose checksum matches and rebuilding the index and the recency order
+ * (from a per-entry access stamp). An entry torn by a crash is dropped, never returned.
+ * The first write after a Sync() synchronously marks the file dirty, the later ones cost nothing more than memory writes.
+ * @tparam Hash Must give the same values in every process opening the file (std::hash of integers does),
+ * the index is stored in the file
+ * @note Not thread-safe, and a file must be opened by one cache at a time
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<>>
+class MmapLRUCache {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "MmapLRUCache stores the bytes of the keys and values, they must be trivially copyable");
+public:
+    using KeyType = K;
+    using ValueType = V;
+
+    /// @brief The largest supported number of entries
+    static constexpr std::size_t MaxEntries = std::size_t(1) << 31;
+
+    /// @brief How the file was found when the cache was opened
+    enum class OpenState {
+        Created,   // The file did not exist or was empty
+        Reopened,  // Closed or synced cleanly, reused as is
+        Recovered, // Written since its last sync (crash): the entries with a valid checksum were kept
+        Discarded, // Of another format, layout, schema or size, or with a corrupted header: reset to empty
+    };
+private:
+    using Index = std::uint32_t;
+    static constexpr Index NullIndex = ~Index(0);
+    static constexpr std::uint64_t Magic = 0x3150414D4D55524Cull; // "LRUMMAP1"
+    static constexpr std::uint32_t FormatVersion = 1;
+    static constexpr std::size_t BlockAlignment = 64;
+
+    struct Header {
+        // Fixed when the file is created, covered by the checksum
+        std::uint64_t magic;
+        std::uint64_t schema;
+        std::uint32_t version;
+        std::uint32_t capacity;
+        std::uint32_t table_size;
+        std::uint32_t reserved;
+        std::uint64_t checksum;
+        // Written along with the entries, only trusted if clean
+        std::uint32_t clean; // Synced and not written since
+        std::uint32_t count;
+        std::uint32_t used;      // Entries handed out from the slab
+        Index head;              // Most recently used
+        Index tail;
+        Index free_head;         // Erased entries, linked by next
+        std::uint64_t clock;     // Stamp of the last access
+    };
+    struct Entry {
+        K key;
+        V value;
+        std::uint64_t checksum; // Of tag, key and value: written last by Put
+        std::uint64_t stamp;    // Orders the entries when the recency list is rebuilt
+        Index prev;
+        Index next;
+        std::uint32_t tag;
+        std::uint32_t live;
+    };
+    /// @brief A slot of the index, entry is the index of the entry plus 1 so that a zero-filled table is empty
+    struct Slot {
+        std::uint32_t entry;
+        std::uint32_t tag;
+    };
+    static_assert(alignof(Entry) <= BlockAlignment);
+
+    static constexpr std::size_t EntriesOffset = (sizeof(Header) + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+
+    [[no_unique_address]] Hash hasher;
+    [[no_unique_address]] KeyEqual equal;
+    MappedFile file;
+    Header* header = nullptr;
+    Entry* entries = nullptr;
+    Slot* table = nullptr;
+    std::size_t table_shift = 32;
+    OpenState state = OpenState::Created;
+
+    static std::uint64_t Schema(std::uint32_t schema_version) noexcept {
+        std::uint64_t layout[] = {sizeof(K), alignof(K), sizeof(V), alignof(V), sizeof(Entry), schema_version};
+        return detail::Checksum64(layout, sizeof(layout));
+    }
+    static std::size_t TableSize(std::size_t capacity) noexcept {
+        return std::max<std::size_t>(16, std::bit_ceil(capacity + capacity / 3 + 1));
+    }
+    static std::size_t FileSize(std::size_t capacity) noexcept {
+        std::size_t table_offset = EntriesOffset + (capacity * sizeof(Entry) + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+        return table_offset + TableSize(capacity) * sizeof(Slot);
+    }
+    static std::uint64_t HeaderChecksum(const Header& h) noexcept {
+        return detail::Checksum64(&h, offsetof(Header, checksum));
+    }
+    static std::uint64_t EntryChecksum(const Entry& entry) noexcept {
+        std::uint64_t hash = detail::Checksum64(&entry.key, sizeof(K), entry.tag);
+        return detail::Checksum64(&entry.value, sizeof(V), hash);
+    }
+
+    void Attach() noexcept {
+        std::byte* data = file.Data();
+        header = reinterpret_cast<Header*>(data);
+        entries = reinterpret_cast<Entry*>(data + EntriesOffset);
+        std::size_t capacity = header->capacity;
+        table = reinterpret_cast<Slot*>(data + FileSize(capacity) - TableSize(capacity) * sizeof(Slot));
+        table_shift = 32 - std::countr_zero(header->table_size);
+    }
+    /// @brief Reset the file to an empty cache, the zero-filled table is empty
+    void Initialize(std::size_t capacity, std::uint64_t schema) {
+        file.Resize(0);
+        file.Resize(FileSize(capacity));
+        Header* h = reinterpret_cast<Header*>(file.Data());
+        h->magic = Magic;
+        h->schema = schema;
+        h->version = FormatVersion;
+        h->capacity = static_cast<std::uint32_t>(capacity);
+        h->table_size = static_cast<std::uint32_t>(TableSize(capacity));
+        h->reserved = 0;
+        h->checksum = HeaderChecksum(*h);
+        h->clean = 0;
+        h->count = 0;
+        h->used = 0;
+        h->head = h->tail = h->free_head = NullIndex;
+        h->clock = 0;
+        Attach();
+    }
+    bool Compatible(std::size_t capacity, std::uint64_t schema) const noexcept {
+        if (file.Size() < sizeof(Header)) return false;
+        const Header& h = *reinterpret_cast<const Header*>(file.Data());
+        return h.magic == Magic && h.version == FormatVersion && h.checksum == HeaderChecksum(h) && h.schema == schema
+            && h.capacity == capacity && h.table_size == TableSize(capacity) && file.Size() == FileSize(capacity);
+    }
+
+    /// @brief Set the dirty mark on disk before the first write after a sync, so a crash is detected at the next open
+    void MarkDirty() {
+        if (!header->clean) return;
+        header->clean = 0;
+        file.Sync(0, sizeof(Header));
+    }
+
+    template <typename Key>
+    std::uint32_t Tag(const Key& key) const {
+        std::size_t hash = hasher(key);
+        if constexpr (sizeof(std::size_t) == 8) {
+            return static_cast<std::uint32_t>((hash * 0x9E3779B97F4A7C15ull) >> 32);
+        } else {
+            return static_cast<std::uint32_t>(hash * 0x9E3779B9u);
+        }
+    }
+    std::size_t Home(std::uint32_t tag) const noexcept { return tag >> table_shift; }
+    std::size_t Mask() const noexcept { return header->table_size - 1; }
+
+    static constexpr std::size_t NotFound = ~std::size_t(0);
+    template <typename Key>
+    std::size_t FindSlot(const Key& key, std::uint32_t tag) const {
+        if (header->count == 0) return NotFound;
+        for (std::size_t pos = Home(tag);; pos = (pos + 1) & Mask()) {
+            const Slot& slot = table[pos];
+            if (slot.entry == 0) return NotFound;
+            if (slot.tag == tag && equal(entries[slot.entry - 1].key, key)) return pos;
+        }
+    }
+    std::size_t SlotOf(Index index) const noexcept {
+        std::size_t pos = Home(entries[index].tag);
+        while (table[pos].entry != index + 1) pos = (pos + 1) & Mask();
+        return pos;
+    }
+    void InsertSlot(Index index, std::uint32_t tag) noexcept {
+        std::size_t pos = Home(tag);
+        while (table[pos].entry != 0) pos = (pos + 1) & Mask();
+        table[pos] = Slot{index + 1, tag};
+    }
+    void RemoveSlot(std::size_t hole) noexcept {
+        std::size_t mask = Mask();
+        for (std::size_t pos = (hole + 1) & mask; table[pos].entry != 0; pos = (pos + 1) & mask) {
+            std::size_t home = Home(table[pos].tag);
+            if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+                table[hole] = table[pos];
+                hole = pos;
+            }
+        }
+        table[hole] = Slot{0, 0};
+    }
+
+    void Unlink(Index index) noexcept {
+        Entry& entry = entries[index];
+        if (entry.prev != NullIndex) entries[entry.prev].next = entry.next;
+        else header->head = entry.next;
+        if (entry.next != NullIndex) entries[entry.next].prev = entry.prev;
+        else header->tail = entry.prev;
+    }
+    void PushFront(Index index) noexcept {
+        Entry& entry = entries[index];
+        entry.prev = NullIndex;
+        entry.next = header->head;
+        if (header->head != NullIndex) entries[header->head].prev = index;
+        else header->tail = index;
+        header->head = index;
+        entry.stamp = ++header->clock;
+    }
+    /// @brief Unlink and free an entry whose slot is already removed
+    void Free(Index index) noexcept {
+        Unlink(index);
+        entries[index].live = 0;
+        entries[index].next = header->free_head;
+        header->free_head = index;
+        --header->count;
+    }
+    Index Allocate() noexcept {
+        if (header->free_head != NullIndex) {
+            Index index = header->free_head;
+            header->free_head = entries[index].next;
+            return index;
+        }
+        return header->used++;
+    }
+
+    /// @brief Rebuild the index, the recency list and the free list from the entries whose checksum matches
+    void Recover() {
+        Header& h = *header;
+        std::memset(static_cast<void*>(table), 0, h.table_size * sizeof(Slot));
+        h.used = std::min(h.used, h.capacity);
+        h.count = 0;
+        h.head = h.tail = h.free_head = NullIndex;
+        h.clock = 0;
+        std::vector<std::pair<std::uint64_t, Index>> valid;
+        for (Index index = 0; index < h.used; ++index) {
+            Entry& entry = entries[index];
+            if (entry.live == 1 && entry.checksum == EntryChecksum(entry) && entry.tag == Tag(entry.key)) {
+                valid.emplace_back(entry.stamp, index);
+            } else {
+                entry.live = 0;
+                entry.next = h.free_head;
+                h.free_head = index;
+            }
+        }
+        std::sort(valid.begin(), valid.end());
+        for (auto [stamp, index]: valid) {
+            Entry& entry = entries[index];
+            std::size_t pos = FindSlot(entry.key, entry.tag);
+            if (pos != NotFound) {
+                // A duplicate left by a crash, the most recent one wins
+                Index older = table[pos].entry - 1;
+                RemoveSlot(pos);
+                Free(older);
+            }
+            h.clock = stamp - 1;
+            PushFront(index);
+            InsertSlot(index, entry.tag);
+            ++h.count;
+        }
+    }
+public:
+    /**
+     * @brief Open the cache stored in a file, creating it if needed
+     * @param max_size The number of entries, a file created with another one is discarded
+     * @param schema_version Bump it when the meaning of the bytes of K or V changes without their size changing,
+     * the files of another version are discarded
+     * @throw SystemError If the file cannot be opened or mapped
+     */
+    MmapLRUCache(const char* path, std::size_t max_size, std::uint32_t schema_version = 0)
+        : file(path, MappedFile::Mode::ReadWrite) {
+        std::size_t capacity = std::clamp<std::size_t>(max_size, 1, MaxEntries);
+        std::uint64_t schema = Schema(schema_version);
+        if (file.Size() == 0) {
+            state = OpenState::Created;
+            Initialize(capacity, schema);
+        } else if (!Compatible(capacity, schema)) {
+            state = OpenState::Discarded;
+            Initialize(capacity, schema);
+        } else {
+            Attach();
+            if (header->clean) {
+                state = OpenState::Reopened;
+            } else {
+                state = OpenState::Recovered;
+                Recover();
+            }
+        }
+    }
+    MmapLRUCache(const std::string& path, std::size_t max_size, std::uint32_t schema_version = 0)
+        : MmapLRUCache(path.c_str(), max_size, schema_version) {}
+    MmapLRUCache(const MmapLRUCache&) = delete;
+    MmapLRUCache& operator=(const MmapLRUCache&) = delete;
+    /// @brief Sync and close the file
+    ~MmapLRUCache() {
+        try {
+            Sync();
+        } catch (...) {
+            // Left dirty, the next open recovers it
+        }
+    }
+
+    /// @brief Look up an entry, it becomes the most recently used
+    /// @return The value, nullptr if not found. It is valid until the entry is evicted or erased and must not be modified
+    const ValueType* Get(const K& key) {
+        std::uint32_t tag = Tag(key);
+        std::size_t pos = FindSlot(key, tag);
+        if (pos == NotFound) return nullptr;
+        Index index = table[pos].entry - 1;
+        if (index != header->head) {
+            MarkDirty();
+            Unlink(index);
+            PushFront(index);
+        }
+        return &entries[index].value;
+    }
+    /// @brief Look up an entry without changing the order
+    const ValueType* Peek(const K& key) const {
+        std::size_t pos = FindSlot(key, Tag(key));
+        return pos == NotFound ? nullptr : &entries[table[pos].entry - 1].value;
+    }
+    bool Exists(const K& key) const { return FindSlot(key, Tag(key)) != NotFound; }
+
+    /// @brief Insert or update an entry, evicting the least recently used one when full
+    void Put(const K& key, const V& value) {
+        MarkDirty();
+        std::uint32_t tag = Tag(key);
+        std::size_t pos = FindSlot(key, tag);
+        Index index;
+        if (pos != NotFound) {
+            index = table[pos].entry - 1;
+            Unlink(index);
+        } else {
+            if (header->count == header->capacity) {
+                Index victim = header->tail;
+                RemoveSlot(SlotOf(victim));
+                Free(victim);
+            }
+            index = Allocate();
+            entries[index].live = 1;
+            entries[index].tag = tag;
+            std::memcpy(static_cast<void*>(&entries[index].key), &key, sizeof(K));
+            InsertSlot(index, tag);
+            ++header->count;
+        }
+        Entry& entry = entries[index];
+        std::memcpy(static_cast<void*>(&entry.value), &value, sizeof(V));
+        entry.checksum = EntryChecksum(entry);
+        PushFront(index);
+    }
+
+    /// @brief Remove an entry
+    /// @return true if the entry existed
+    bool Erase(const K& key) {
+        std::size_t pos = FindSlot(key, Tag(key));
+        if (pos == NotFound) return false;
+        MarkDirty();
+        Index index = table[pos].entry - 1;
+        RemoveSlot(pos);
+        Free(index);
+        return true;
+    }
+
+    /// @brief Drop all the entries
+    void Clear() {
+        std::size_t capacity = header->capacity;
+        std::uint64_t schema = header->schema;
+        Initialize(capacity, schema); // Remaps the file, header is invalidated
+    }
+
+    /**
+     * @brief Write the cache to the disk and mark the file clean, the next open reuses it without a recovery
+     * @param wait Wait for the data to be written. Without, a system crash before the writes complete can leave a clean
+     * mark over torn entries, a process crash cannot
+     */
+    void Sync(bool wait = true) {
+        if (header->clean) return;
+        file.Sync(wait);
+        header->clean = 1;
+        file.Sync(0, sizeof(Header), wait);
+    }
+
+    std::size_t Size() const noexcept { return header->count; }
+    std::size_t MaxSize() const noexcept { return header->capacity; }
+    bool Empty() const noexcept { return header->count == 0; }
+    OpenState OpenedAs() const noexcept { return state; }
+};
+
+LCORE_NAMESPACE_END
@@ -0,0 +1,120 @@
+/**
+ * @file mmapstream.hpp
+ * @brief An input stream reading a memory-mapped file in place
+ */
+#pragma once
+#include "base.hpp"
+#include "iostream.hpp"
+#include "mappedfile.hpp"
+#include "string.hpp"
+#include <algorithm>
+#include <filesystem>
+
+LCORE_NAMESPACE_BEGIN
+
+/**
+ * @brief An input stream buffer whose buffer is a read-only mapping of a whole file
+ *
+ * Nothing is ever copied into the buffer: it points into the mapping, and seeking only moves the cursor.
+ * With a readahead window, the buffer ends a window ahead of the cursor, and each refill moves its end
+ * a window further and asks the system to read the next window ahead (MADV_WILLNEED), so the disk reads
+ * overlap the parsing. Without one, the buffer spans the whole file and the system reads ahead on its own.
+ * @note The file must not be truncated while it is mapped, reading the pages past its end raises SIGBUS
+ */
+template <typename CharT, typename Traits = std::char_traits<CharT>>
+class BasicMmapIStreamBuffer: public BasicIStreamBuffer<CharT, Traits> {
+public:
+    using CharType = typename BasicIStreamBuffer<CharT, Traits>::CharType;
+    using TraitsType = typename BasicIStreamBuffer<CharT, Traits>::TraitsType;
+    using IntType = typename BasicIStreamBuffer<CharT, Traits>::IntType;
+    using PosType = typename BasicIStreamBuffer<CharT, Traits>::PosType;
+    using OffType = typename BasicIStreamBuffer<CharT, Traits>::OffType;
+private:
+    MappedFile _file;
+    CharType* _fileEnd;
+    std::size_t _readahead; ///< Size of the readahead window in characters, 0 for none
+
+    /// @brief Move the end of the buffer a window past the cursor, and read the following window ahead
+    void Extend() noexcept {
+        if (_readahead == 0) return;
+        this->buffer.end = std::max(this->buffer.end, std::min(this->buffer.current + _readahead, _fileEnd));
+        _file.Advise((this->buffer.end - this->buffer.begin) * sizeof(CharType), _readahead * sizeof(CharType), MappedFile::Advice::WillNeed);
+    }
+public:
+    /**
+     * @brief Map the file at path
+     * @param advice The access pattern of the whole file, sequential by default
+     * @param readahead The size of the readahead window in bytes, 0 to leave the readahead to the system
+     * @throw SystemError When the file cannot be opened or mapped
+     */
+    BasicMmapIStreamBuffer(const char* path, MappedFile::Advice advice = MappedFile::Advice::Sequential, std::size_t readahead = 0)
+        : BasicIStreamBuffer<CharT, Traits>(), _file(path, MappedFile::Mode::ReadOnly),
+          _readahead((readahead + sizeof(CharType) - 1) / sizeof(CharType)) {
+        // We don't consider the case where the file size is not an integer multiple of CharT
+        CharType* data = reinterpret_cast<CharType*>(_file.Data());
+        _fileEnd = data + _file.Size() / sizeof(CharType);
+        this->buffer.begin = data;
+        this->buffer.current = data;
+        this->buffer.end = _readahead ? data : _fileEnd;
+        _file.Advise(0, _file.Size(), advice);
+        Extend();
+    }
+
+    PosType SeekPos(PosType pos) override {
+        OffType offset = std::clamp<OffType>(OffType(pos), 0, _fileEnd - this->buffer.begin);
+        this->buffer.current = this->buffer.begin + offset;
+        Extend();
+        return offset;
+    }
+
+    PosType SeekOff(OffType off, IOSBase::SeekDir dir) override {
+        OffType base = dir == IOSBase::SeekDir::Begin ? 0 : dir == IOSBase::SeekDir::Current ? OffType(Tell()) : OffType(Size());
+        return SeekPos(base + off);
+    }
+
+    PosType Tell() const { return this->buffer.current - this->buffer.begin; }
+    /// @brief Get the size of the file in characters
+    std::size_t Size() const noexcept { return _fileEnd - this->buffer.begin; }
+    /// @brief Get the whole file, without copying it
+    std::basic_string_view<CharType, Traits> View() const noexcept { return {this->buffer.begin, Size()}; }
+
+    IntType Showmanyc() const override { return static_cast<IntType>(_fileEnd - this->buffer.current); }
+protected:
+    IntType Underflow() override {
+        if (this->buffer.current == _fileEnd) return Traits::eof(); // No more data to read
+        Extend();
+        return Traits::to_int_type(*this->buffer.current);
+    }
+};
+
+/**
+ * @brief A file input stream on a memory-mapped file, to parse large read-only inputs without copying them
+ * @see BasicMmapIStreamBuffer
+ */
+template <typename CharT = char, typename Traits = std::char_traits<CharT>>
+class BasicMmapIFStream: public BasicIStream<CharT, Traits> {
+    BasicMmapIStreamBuffer<CharT, Traits> _buffer;
+public:
+    using CharType = typename BasicIStream<CharT, Traits>::CharType;
+    using TraitsType = typename BasicIStream<CharT, Traits>::TraitsType;
+    using IntType = typename BasicIStream<CharT, Traits>::IntType;
+    using PosType = typename BasicIStream<CharT, Traits>::PosType;
+    using OffType = typename BasicIStream<CharT, Traits>::OffType;
+
+    BasicMmapIFStream(const char* path, MappedFile::Advice advice = MappedFile::Advice::Sequential, std::size_t readahead = 0)
+        : BasicIStream<CharT, Traits>(), _buffer(path, advice, readahead) { this->InputBuffer(&_buffer); }
+
+    BasicMmapIFStream(const String& path, MappedFile::Advice advice = MappedFile::Advice::Sequential, std::size_t readahead = 0)
+        : BasicMmapIFStream(path.c_str(), advice, readahead) {}
+
+    BasicMmapIFStream(const std::filesystem::path& path, MappedFile::Advice advice = MappedFile::Advice::Sequential, std::size_t readahead = 0)
+        : BasicMmapIFStream(path.string().c_str(), advice, readahead) {}
+
+    /// @brief Get the whole file, without copying it
+    std::basic_string_view<CharType, Traits> View() const noexcept { return _buffer.View(); }
+};
+
+using MmapIStreamBuffer = BasicMmapIStreamBuffer<char>;
+using MmapIFStream = BasicMmapIFStream<char>;
+
+LCORE_NAMESPACE_END
@@ -5,8 +5,8 @@
 #include "../string.hpp"
 #include "../class.hpp"
 #include "../exception.hpp"
+#include "../function.hpp"
 #include <map>
-#include <functional>
 
 LCORE_OBJ_NAMESPACE_BEGIN
 
@@ -28,7 +28,7 @@ class TypeInfo {
 public:
     const StringView name;
     const TypeId parent;
-    std::function<Ptr<Object>()> constructor;
+    InplaceFunction<Ptr<Object>()> constructor;
 };
 
 inline Ptr<Object> TypeId::Constructe() const{
@@ -1,6 +1,7 @@
 #pragma once
 #include "base.hpp"
 #include "exception.hpp"
+#include "function.hpp"
 /**
  * Rust-style option type
  */
@@ -27,15 +28,15 @@ public:
     Option(Option&& o): is_some(o.is_some) {
         if (is_some) new(&value) T(std::move(o.value));
     }
-    Option(const None&): is_some(false) {}
-    Option(None&&): is_some(false) {}
+    Option(const LCORE_NAMESPACE_NAME::None&): is_some(false) {}
+    Option(LCORE_NAMESPACE_NAME::None&&): is_some(false) {}
     ~Option() {
         if (is_some) value.~T();
     }
 
     static Option Some(const T& v) { return Option(v); }
     static Option Some(T&& v) { return Option(std::move(v)); }
-    static Option None() { return Option(None()); }
+    static Option None() { return Option(LCORE_NAMESPACE_NAME::None()); }
     
     bool IsSome() const { return is_some; }
     bool IsNone() const { return !is_some; }
@@ -72,24 +73,24 @@ public:
         return f();
     }
     template <typename U>
-    Option<U> Map(std::function<U(const T&)> f) const & {
+    Option<U> Map(FunctionRef<U(const T&)> f) const & {
         if (is_some) return Option<U>(f(value));
-        return Option<U>();
+        return Option<U>::None();
     }
     template <typename U>
-    Option<U> Map(std::function<U(T&&)> f) && {
+    Option<U> Map(FunctionRef<U(T&&)> f) && {
         if (is_some) return Option<U>(f(std::move(value)));
-        return Option<U>();
+        return Option<U>::None();
     }
     template <typename U>
-    Option<U> AndThen(std::function<Option<U>(const T&)> f) const & {
+    Option<U> AndThen(FunctionRef<Option<U>(const T&)> f) const & {
         if (is_some) return f(value);
-        return Option<U>();
+        return Option<U>::None();
     }
     template <typename U>
-    Option<U> AndThen(std::function<Option<U>(T&&)> f) && {
+    Option<U> AndThen(FunctionRef<Option<U>(T&&)> f) && {
         if (is_some) return f(std::move(value));
-        return Option<U>();
+        return Option<U>::None();
     }
     template <typename F>
     Option<T> OrElse(F&& f) const & {
@@ -101,20 +102,20 @@ public:
         if (is_some) return std::move(*this);
         return f();
     }
-    template <typename F>
+    template <typename F, typename E>
     Result<T, E> Transpose(F&& f) const & {
         if (is_some) {
             return f(value);
         } else {
-            return Result<T, E>(None());
+            return Result<T, E>(LCORE_NAMESPACE_NAME::None());
         }
     }
-    template <typename F>
+    template <typename F, typename E>
     Result<T, E> Transpose(F&& f) && {
         if (is_some) {
             return f(std::move(value));
         } else {
-            return Result<T, E>(None());
+            return Result<T, E>(LCORE_NAMESPACE_NAME::None());
         }
     }
 };
@@ -137,13 +138,13 @@ public:
     NullStateOption(T&& v): value(std::move(v)) {}
     NullStateOption(const NullStateOption& o): value(o.value) {}
     NullStateOption(NullStateOption&& o): value(std::move(o.value)) {}
-    NullStateOption(const None&): value(null_value) {}
-    NullStateOption(None&&): value(null_value) {}
+    NullStateOption(const LCORE_NAMESPACE_NAME::None&): value(null_value) {}
+    NullStateOption(LCORE_NAMESPACE_NAME::None&&): value(null_value) {}
     ~NullStateOption() = default;
 
     static NullStateOption Some(const T& v) { return NullStateOption(v); }
     static NullStateOption Some(T&& v) { return NullStateOption(std::move(v)); }
-    static NullStateOption None() { return NullStateOption(None()); }
+    static NullStateOption None() { return NullStateOption(LCORE_NAMESPACE_NAME::None()); }
 
     bool IsSome() const { return value != null_value; }
     bool IsNone() const { return value == null_value; }
@@ -178,24 +179,24 @@ public:
         return f();
     }
     template <typename U>
-    NullStateOption<U, NullValue> Map(std::function<U(const T&)> f) const & {
+    NullStateOption<U, NullValue> Map(FunctionRef<U(const T&)> f) const & {
         if (IsSome()) return NullStateOption<U, NullValue>(f(value));
-        return NullStateOption<U, NullValue>();
+        return NullStateOption<U, NullValue>::None();
     }
     template <typename U>
-    NullStateOption<U, NullValue> Map(std::function<U(T&&)> f) && {
+    NullStateOption<U, NullValue> Map(FunctionRef<U(T&&)> f) && {
         if (IsSome()) return NullStateOption<U, NullValue>(f(std::move(value)));
-        return NullStateOption<U, NullValue>();
+        return NullStateOption<U, NullValue>::None();
     }
     template <typename U>
-    NullStateOption<U, NullValue> AndThen(std::function<NullStateOption<U, NullValue>(const T&)> f) const & {
+    NullStateOption<U, NullValue> AndThen(FunctionRef<NullStateOption<U, NullValue>(const T&)> f) const & {
         if (IsSome()) return f(value);
-        return NullStateOption<U, NullValue>();
+        return NullStateOption<U, NullValue>::None();
     }
     template <typename U>
-    NullStateOption<U, NullValue> AndThen(std::function<NullStateOption<U, NullValue>(T&&)> f) && {
+    NullStateOption<U, NullValue> AndThen(FunctionRef<NullStateOption<U, NullValue>(T&&)> f) && {
         if (IsSome()) return f(std::move(value));
-        return NullStateOption<U, NullValue>();
+        return NullStateOption<U, NullValue>::None();
     }
     template <typename F>
     NullStateOption<T, NullValue> OrElse(F&& f) const & {
@@ -212,7 +213,7 @@ public:
         if (IsSome()) {
             return f(value);
         } else {
-            return Result<T, E>(None());
+            return Result<T, E>(LCORE_NAMESPACE_NAME::None());
         }
     }
     template <typename F, typename E>
@@ -220,7 +221,7 @@ public:
         if (IsSome()) {
             return f(std::move(value));
         } else {
-            return Result<T, E>(None());
+            return Result<T, E>(LCORE_NAMESPACE_NAME::None());
         }
     }
 };
@@ -8,26 +8,29 @@
  * @copyright Copyright (c) 2024
  * 
  */
-
+#pragma once
 #include "base.hpp"
-#include "container/utils.hpp"
+#include "container/list.hpp"
 #include "traits.hpp"
+#include <tuple>
 
 LCORE_NAMESPACE_BEGIN
 
+/// @brief A chain of handlers called in order with the same parameters
+/// @tparam Handler The handler type, prefer InplaceFunction (function.hpp) over std::function, it never allocates
 template <typename Handler>
-requires OneOf<DeclReturnType<Handler>, void, bool>
+requires OneOf<typename FunctionTraits<Handler>::ReturnType, void, bool>
 class Pipe {
     List<Handler> m_handlers;
 public:
-    using HandlerReturnType = DeclReturnType<Handler>;
-    using PipeReturnType = ParameterTuple<Handler>;
+    using HandlerReturnType = typename FunctionTraits<Handler>::ReturnType;
+    using PipeReturnType = typename FunctionTraits<Handler>::ArgsDecayTuple;
 
     Pipe() {}
     Pipe(const List<Handler>& handlers): m_handlers(handlers) {}
     Pipe(List<Handler>&& handlers): m_handlers(std::move(handlers)) {}
 
-    inline void AddHandler(Handler&& handler){
+    inline void AddHandler(Handler handler){
         m_handlers.push_back(std::move(handler));
     }
     
@@ -0,0 +1,150 @@
+#pragma once
+#include "base.hpp"
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+LCORE_NAMESPACE_BEGIN
+
+/**
+ * @brief A set of disjoint half-open ranges [begin, end), merged as they touch
+ *
+ * Ranges are kept in a std::map from begin to end, never adjacent nor overlapping:
+ * inserting or erasing a range costs O(log n) plus the ranges it merges or cuts.
+ * @tparam T An unsigned offset type
+ */
+template <typename T = std::size_t>
+class RangeSet {
+public:
+    using value_type = T;
+    using map_type = std::map<T, T>;
+    using const_iterator = typename map_type::const_iterator;
+private:
+    map_type ranges; // begin -> end
+    T covered = 0;   // Total length of the ranges
+public:
+    /// @brief Add a range, merged with the ones it overlaps or touches
+    /// @return The length newly covered
+    inline T insert(T begin, T end) {
+        if (begin >= end) return 0;
+        auto it = ranges.upper_bound(begin);
+        auto first = it;
+        bool extend = false;
+        T absorbed = 0;
+        if (it != ranges.begin() && std::prev(it)->second >= begin) {
+            first = std::prev(it);
+            if (first->second >= end) return 0;
+            extend = true;
+            begin = first->first;
+            absorbed = first->second - first->first;
+        }
+        while (it != ranges.end() && it->first <= end) {
+            end = std::max(end, it->second);
+            absorbed += it->second - it->first;
+            it = ranges.erase(it);
+        }
+        if (extend) first->second = end;
+        else ranges.emplace_hint(it, begin, end);
+        T added = (end - begin) - absorbed;
+        covered += added;
+        return added;
+    }
+
+    /// @brief Remove a range, cutting the ones it overlaps
+    /// @return The length no longer covered
+    inline T erase(T begin, T end) {
+        if (begin >= end) return 0;
+        T removed = 0;
+        auto it = ranges.upper_bound(begin);
+        if (it != ranges.begin()) {
+            auto prev = std::prev(it);
+            if (prev->second > begin) {
+                T prev_end = prev->second;
+                removed += std::min(prev_end, end) - begin;
+                prev->second = begin;
+                if (prev_end > end) ranges.emplace_hint(it, end, prev_end);
+                if (prev->first == prev->second) ranges.erase(prev);
+            }
+        }
+        while (it != ranges.end() && it->first < end) {
+            if (it->second <= end) {
+                removed += it->second - it->first;
+                it = ranges.erase(it);
+            } else {
+                removed += end - it->first;
+                auto node = ranges.extract(it);
+                node.key() = end;
+                ranges.insert(std::move(node));
+                break;
+            }
+        }
+        covered -= removed;
+        return removed;
+    }
+
+    /// @brief Get the range containing pos, or end()
+    inline const_iterator find(T pos) const {
+        auto it = ranges.upper_bound(pos);
+        if (it == ranges.begin()) return ranges.end();
+        --it;
+        return it->second > pos ? it : ranges.end();
+    }
+    inline bool contains(T pos) const { return find(pos) != ranges.end(); }
+    /// @brief Check if [begin, end) is entirely covered, an empty range always is
+    inline bool contains(T begin, T end) const {
+        if (begin >= end) return true;
+        auto it = find(begin);
+        return it != ranges.end() && it->second >= end;
+    }
+
+    /// @brief Call fn(begin, end) on each gap of [begin, end) not covered by a range, in order. fn must not modify the set
+    template <typename F>
+    inline void for_each_gap(T begin, T end, F&& fn) const {
+        T pos = begin;
+        auto it = ranges.upper_bound(begin);
+        if (it != ranges.begin() && std::prev(it)->second > pos) pos = std::prev(it)->second;
+        while (pos < end) {
+            T next = it == ranges.end() ? end : std::min(it->first, end);
+            if (pos < next) fn(pos, next);
+            if (it == ranges.end()) break;
+            pos = std::max(pos, it->second);
+            ++it;
+        }
+    }
+
+    /// @brief Get the gaps of [begin, end) not covered by a range, in order, in O(log n + gaps)
+    inline std::vector<std::pair<T, T>> gaps(T begin, T end) const {
+        std::vector<std::pair<T, T>> result;
+        for_each_gap(begin, end, [&](T gap_begin, T gap_end) { result.emplace_back(gap_begin, gap_end); });
+        return result;
+    }
+    /// @brief Get the first gap of [begin, end) not covered by a range in O(log n), std::nullopt if it is covered
+    inline std::optional<std::pair<T, T>> first_gap(T begin, T end) const {
+        if (begin >= end) return std::nullopt;
+        auto it = ranges.upper_bound(begin);
+        if (it != ranges.begin() && std::prev(it)->second > begin) {
+            begin = std::prev(it)->second;
+            if (begin >= end) return std::nullopt;
+        }
+        return std::pair<T, T>(begin, it == ranges.end() ? end : std::min(it->first, end));
+    }
+
+    /// @brief Get the number of ranges
+    inline std::size_t size() const noexcept { return ranges.size(); }
+    inline bool empty() const noexcept { return ranges.empty(); }
+    /// @brief Get the total length of the ranges
+    inline T length() const noexcept { return covered; }
+    inline void clear() noexcept {
+        ranges.clear();
+        covered = 0;
+    }
+
+    /// @brief Iterate over the ranges as {begin, end} pairs, in order
+    inline const_iterator begin() const noexcept { return ranges.begin(); }
+    inline const_iterator end() const noexcept { return ranges.end(); }
+};
+
+LCORE_NAMESPACE_END
@@ -0,0 +1,72 @@
+/**
+ * @file scan.hpp
+ * @brief Finding a character in a range with SIMD, for the delimiter scans of the streams
+ */
+#pragma once
+#include "base.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LCORE_SCAN_AVX2 1
+#define LCORE_SCAN_WIDTH 32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LCORE_SCAN_SSE2 1
+#define LCORE_SCAN_WIDTH 16
+#endif
+
+LCORE_NAMESPACE_BEGIN
+
+namespace detail {
+
+/**
+ * @brief Find the first c in [begin, end), or end
+ *
+ * Bytes go to memchr, which the C library vectorizes for the running CPU. Wider characters compared with
+ * std::char_traits are compared 16 or 32 bytes at a time with SSE2 or AVX2 when the target has them,
+ * other traits use their own find.
+ */
+template <typename CharT, typename Traits = std::char_traits<CharT>>
+inline const CharT* FindChar(const CharT* begin, const CharT* end, CharT c) noexcept {
+    if (begin == end) return end;
+    if constexpr (!std::is_same_v<Traits, std::char_traits<CharT>>) {
+        const CharT* found = Traits::find(begin, end - begin, c);
+        return found ? found : end;
+    } else if constexpr (sizeof(CharT) == 1) {
+        const void* found = std::memchr(begin, static_cast<unsigned char>(c), end - begin);
+        return found ? static_cast<const CharT*>(found) : end;
+    } else {
+#ifdef LCORE_SCAN_WIDTH
+        if constexpr (sizeof(CharT) == 2 || sizeof(CharT) == 4) {
+            constexpr std::size_t lanes = LCORE_SCAN_WIDTH / sizeof(CharT);
+#if defined(LCORE_SCAN_AVX2)
+            __m256i needle = sizeof(CharT) == 2 ? _mm256_set1_epi16(static_cast<short>(c)) : _mm256_set1_epi32(static_cast<int>(c));
+            for (; static_cast<std::size_t>(end - begin) >= lanes; begin += lanes) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+                __m256i equal = sizeof(CharT) == 2 ? _mm256_cmpeq_epi16(block, needle) : _mm256_cmpeq_epi32(block, needle);
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(equal));
+                if (mask) return begin + std::countr_zero(mask) / sizeof(CharT);
+            }
+#else
+            __m128i needle = sizeof(CharT) == 2 ? _mm_set1_epi16(static_cast<short>(c)) : _mm_set1_epi32(static_cast<int>(c));
+            for (; static_cast<std::size_t>(end - begin) >= lanes; begin += lanes) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+                __m128i equal = sizeof(CharT) == 2 ? _mm_cmpeq_epi16(block, needle) : _mm_cmpeq_epi32(block, needle);
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(equal));
+                if (mask) return begin + std::countr_zero(mask) / sizeof(CharT);
+            }
+#endif
+        }
+#endif
+        return std::find(begin, end, c);
+    }
+}
+
+}
+
+LCORE_NAMESPACE_END
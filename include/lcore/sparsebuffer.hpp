@@ -1,14 +1,39 @@
 #pragma once
 #include "base.hpp"
+#include "exception.hpp"
+#include "memstats.hpp"
+#include "rangeset.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <vector>
 #include <functional>
 #include <span>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 LCORE_NAMESPACE_BEGIN
 
-/// @brief A sparse buffer that can hold data at arbitrary offsets, with efficient memory usage
-template <typename T = char>
+/**
+ * @brief A sparse buffer that can hold data at arbitrary offsets, with efficient memory usage
+ *
+ * Data lives in fixed-size pages, allocated on the first write to them and never moved,
+ * and a RangeSet records which ranges hold valid data. A write costs O(log n) plus the elements copied,
+ * whatever the order of the writes: reassembling out-of-order segments is linear in their size.
+ * @tparam PageBytes The size of a page, a read returns at most the rest of a page
+ */
+template <typename T = char, std::size_t PageBytes = 64 * 1024>
 class SparseBuffer {
 public:
     using value_type = T;
@@ -19,44 +44,113 @@ public:
     using pointer = T*;
     using const_pointer = const T*;
 
-    /// @brief A chunk of data in the sparse buffer
-    struct Chunk {
-        size_type offset; // Offset of the chunk
-        std::vector<T> data; // Data of the chunk
+    /// @brief The number of elements in a page
+    static constexpr size_type page_size = PageBytes >= sizeof(T) ? PageBytes / sizeof(T) : 1;
 
-        inline constexpr Chunk(size_type offset, size_type size) : offset(offset), data(size) {}
-        inline constexpr size_type size() const { return data.size(); }
-        inline constexpr bool contains(size_type pos) const { return pos >= offset && pos < offset + size(); }
-        inline constexpr size_type endat() const { return offset + size(); }
-        inline constexpr T& operator[](size_type pos) { return data[pos - offset]; }
-        inline constexpr const T& operator[](size_type pos) const { return data[pos - offset]; }
-    };
+    /// @brief A page of elements, default-initialized: a trivial T is not zeroed before being written
+    class Page {
+        using Allocator = TaggedAllocator<T, MemSubsystem::SparseBuffer>;
+        T* elements = nullptr;
+    public:
+        inline Page() = default;
+        inline Page(const Page& other) : Page() {
+            if (other.elements) std::copy_n(other.elements, page_size, allocate()); // allocate() already constructed the elements
+        }
+        inline Page(Page&& other) noexcept : elements(std::exchange(other.elements, nullptr)) {}
+        inline Page& operator=(Page other) noexcept {
+            std::swap(elements, other.elements);
+            return *this;
+        }
+        inline ~Page() {
+            if (!elements) return;
+            std::destroy_n(elements, page_size);
+            Allocator().deallocate(elements, page_size);
+        }
 
-    using ChunkMap = std::map<size_type, Chunk>;
+        /// @brief Allocate the elements of an empty page
+        inline T* allocate() {
+            T* allocated = Allocator().allocate(page_size);
+            try {
+                std::uninitialized_default_construct_n(allocated, page_size);
+            } catch (...) {
+                Allocator().deallocate(allocated, page_size);
+                throw;
+            }
+            return elements = allocated;
+        }
+        inline bool empty() const noexcept { return elements == nullptr; }
+        inline T* data() noexcept { return elements; }
+        inline const T* data() const noexcept { return elements; }
+    };
+    using PageMap = std::map<size_type, Page>;
 private:
-    ChunkMap chunks; // Map of chunks, key is the offset of the chunk
+    PageMap pages; // Map of pages, key is the index of the page
+    RangeSet<size_type> valid; // Ranges holding data
     size_type total_size = 0; // Total size of the sparse buffer
 
-    inline constexpr void merge_chunks() {
-        if (chunks.empty()) return;
-        auto it = chunks.begin();
-        auto next_it = std::next(it);
-        while (next_it != chunks.end()) {
-            if (it->second.endat() >= next_it->first) {
-                // Merge next_it into it
-                size_type overlap = it->second.endat() - next_it->first;
-                if (overlap < next_it->second.size()) {
-                    it->second.data.insert(it->second.data.end(),
-                                          next_it->second.data.begin() + overlap,
-                                          next_it->second.data.end());
+    /// @brief Copy data to [pos, pos + size), allocating the missing pages
+    inline constexpr void copy_in(size_type pos, const T* data, size_type size) {
+        auto hint = pages.lower_bound(pos / page_size);
+        while (size > 0) {
+            size_type offset = pos % page_size;
+            size_type count = std::min(size, page_size - offset);
+            hint = pages.try_emplace(hint, pos / page_size);
+            if (hint->second.empty()) hint->second.allocate();
+            std::copy_n(data, count, hint->second.data() + offset);
+            ++hint;
+            pos += count;
+            data += count;
+            size -= count;
+        }
+    }
+    inline constexpr const T* at(size_type pos) const {
+        return pages.find(pos / page_size)->second.data() + pos % page_size;
+    }
+    /// @brief Write spans to a file descriptor, at offset or at its position if offset is negative
+    static size_type write_spans(int fd, const std::vector<std::span<const T>>& spans, std::int64_t offset) {
+        std::uint64_t written = 0;
+#ifdef _WIN32
+        if (offset >= 0 && _lseeki64(fd, offset, SEEK_SET) < 0) throw SystemError(errno);
+        for (std::span<const T> span: spans) {
+            const char* bytes = reinterpret_cast<const char*>(span.data());
+            std::size_t left = span.size_bytes();
+            while (left > 0) {
+                int count = _write(fd, bytes, static_cast<unsigned>(std::min<std::size_t>(left, INT_MAX)));
+                if (count < 0) throw SystemError(errno);
+                bytes += count;
+                left -= count;
+                written += count;
+            }
+        }
+#else
+        std::vector<iovec> iov(spans.size());
+        for (std::size_t i = 0; i < spans.size(); ++i) {
+            iov[i].iov_base = const_cast<T*>(spans[i].data());
+            iov[i].iov_len = spans[i].size_bytes();
+        }
+        std::size_t index = 0;
+        while (index < iov.size()) {
+            int count = static_cast<int>(std::min<std::size_t>(iov.size() - index, IOV_MAX));
+            ssize_t result = offset < 0 ? ::writev(fd, &iov[index], count)
+                                        : ::pwritev(fd, &iov[index], count, static_cast<off_t>(offset + written));
+            if (result < 0) {
+                if (errno == EINTR) continue;
+                throw SystemError(errno);
+            }
+            written += result;
+            // Skip what was written, a short write may stop inside a span
+            for (std::size_t left = result; left > 0;) {
+                if (left >= iov[index].iov_len) {
+                    left -= iov[index++].iov_len;
+                } else {
+                    iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + left;
+                    iov[index].iov_len -= left;
+                    left = 0;
                 }
-                chunks.erase(next_it);
-                next_it = std::next(it);
-            } else {
-                ++it;
-                ++next_it;
             }
         }
+#endif
+        return written / sizeof(T);
     }
 public:
     inline constexpr SparseBuffer() = default;
@@ -68,123 +162,99 @@ public:
     inline constexpr ~SparseBuffer() = default;
 
     /// @brief Get the total size of the sparse buffer
-    inline constexpr size_type size() const { return total_size; } 
+    inline constexpr size_type size() const { return total_size; }
     /// @brief Check if the sparse buffer is empty
     inline constexpr bool empty() const { return total_size == 0; }
     /// @brief Clear the sparse buffer
-    inline constexpr void clear() { chunks.clear(); total_size = 0; }
-    /// @brief Get the number of chunks in the sparse buffer
-    inline constexpr size_type chunk_count() const { return chunks.size(); }
-    /// @brief Get the chunks in the sparse buffer
-    inline constexpr const ChunkMap& get_chunks() const { return chunks; }
-    /// @brief Get the chunk that contains the given position, or nullptr if not found
-    inline constexpr const Chunk* get_chunk(size_type pos) const {
-        auto it = chunks.upper_bound(pos);
-        if (it == chunks.begin()) return nullptr;
-        --it;
-        if (it->second.contains(pos)) return &it->second;
-        return nullptr;
-    }
-    inline constexpr Chunk* get_chunk(size_type pos) {
-        auto it = chunks.upper_bound(pos);
-        if (it == chunks.begin()) return nullptr;
-        --it;
-        if (it->second.contains(pos)) return &it->second;
-        return nullptr;
-    }
+    inline constexpr void clear() { pages.clear(); valid.clear(); total_size = 0; }
+    /// @brief Get the number of contiguous ranges of data in the sparse buffer
+    inline constexpr size_type chunk_count() const { return valid.size(); }
+    /// @brief Get the contiguous ranges of data, as {begin, end} pairs
+    inline constexpr const RangeSet<size_type>& get_ranges() const { return valid; }
+    /// @brief Get the number of pages allocated
+    inline constexpr size_type page_count() const { return pages.size(); }
     inline constexpr bool has_data(size_type pos) const {
-        return get_chunk(pos) != nullptr;
+        return valid.contains(pos);
     }
+    /// @brief Get the number of elements holding data, in O(1)
+    inline constexpr size_type covered_size() const { return valid.length(); }
+    /// @brief Check if [pos, pos + size) holds data, in O(log n)
+    inline constexpr bool is_complete(size_type pos, size_type size) const { return valid.contains(pos, pos + size); }
+    /// @brief Check if the whole buffer, [0, size()), holds data
+    inline constexpr bool is_complete() const { return valid.contains(0, total_size); }
+    /// @brief Get the ranges of [begin, end) holding no data, in O(log n + holes)
+    inline constexpr std::vector<std::pair<size_type, size_type>> holes(size_type begin, size_type end) const { return valid.gaps(begin, end); }
+    /// @brief Get the ranges of the buffer holding no data
+    inline constexpr std::vector<std::pair<size_type, size_type>> holes() const { return valid.gaps(0, total_size); }
+    /// @brief Get the first range holding no data at or after pos, in O(log n), std::nullopt if the rest of the buffer is complete
+    inline constexpr std::optional<std::pair<size_type, size_type>> first_hole_after(size_type pos) const { return valid.first_gap(pos, total_size); }
     /// @brief Read data from the sparse buffer, return a span of the data read
+    /// @note The span stops at the end of the data or of the page holding pos, read again from its end for the rest
     inline constexpr std::span<const T> read(size_type pos, size_type size) const {
-        auto chunk = get_chunk(pos);
-        if (!chunk) return {};
-        size_type read_size = std::min(size, chunk->endat() - pos);
-        return std::span<const T>(&(*chunk)[pos], read_size);
+        auto range = valid.find(pos);
+        if (range == valid.end()) return {};
+        size_type read_size = std::min({size, range->second - pos, page_size - pos % page_size});
+        return std::span<const T>(at(pos), read_size);
     }
     inline constexpr std::span<T> read(size_type pos, size_type size) {
-        auto chunk = get_chunk(pos);
-        if (!chunk) return {};
-        size_type read_size = std::min(size, chunk->endat() - pos);
-        return std::span<T>(&(*chunk)[pos], read_size);
+        std::span<const T> data = std::as_const(*this).read(pos, size);
+        return std::span<T>(const_cast<T*>(data.data()), data.size());
+    }
+    /**
+     * @brief Get the data at [pos, pos + size) without copying it, up to the first gap
+     * @return One span per page, in order, empty if pos holds no data
+     */
+    inline std::vector<std::span<const T>> readv(size_type pos, size_type size) const {
+        std::vector<std::span<const T>> spans;
+        auto range = valid.find(pos);
+        if (size == 0 || range == valid.end()) return spans;
+        size_type end = range->second - pos > size ? pos + size : range->second;
+        // The pages of a range of data all exist, and are consecutive in the map
+        auto page = pages.find(pos / page_size);
+        spans.reserve((end - 1) / page_size - pos / page_size + 1);
+        for (; pos < end; ++page) {
+            size_type count = std::min(end - pos, page_size - pos % page_size);
+            spans.emplace_back(page->second.data() + pos % page_size, count);
+            pos += count;
+        }
+        return spans;
+    }
+    /**
+     * @brief Write the data at [pos, pos + size), up to the first gap, to a file descriptor with writev, without copying
+     * @return The number of elements written
+     * @throw SystemError When a write fails
+     */
+    inline size_type write_to(int fd, size_type pos, size_type size) const requires std::is_trivially_copyable_v<T> {
+        return write_spans(fd, readv(pos, size), -1);
+    }
+    /// @brief Write the data at [pos, pos + size), up to the first gap, at offset in a file with pwritev
+    inline size_type write_to(int fd, size_type pos, size_type size, std::uint64_t offset) const requires std::is_trivially_copyable_v<T> {
+        return write_spans(fd, readv(pos, size), static_cast<std::int64_t>(offset));
     }
     /// @brief Write data to the sparse buffer, return the number of bytes written
     inline constexpr size_type write(size_type pos, std::span<const T> data) {
         if (data.empty()) return 0;
-        size_type written = 0;
-        size_type data_size = data.size();
-        while (written < data_size) {
-            size_type current_pos = pos + written;
-            auto it = chunks.upper_bound(current_pos);
-            if (it != chunks.begin()) {
-                auto prev_it = std::prev(it);
-                if (prev_it->second.contains(current_pos)) {
-                    // Write to existing chunk
-                    size_type chunk_written = std::min(data_size - written, prev_it->second.endat() - current_pos);
-                    std::copy_n(data.data() + written, chunk_written, &prev_it->second[current_pos]);
-                    written += chunk_written;
-                    continue;
-                }
-            }
-            // Create a new chunk
-            size_type chunk_size = 1;
-            if (it != chunks.end()) {
-                chunk_size = std::max(chunk_size, it->first - current_pos);
-            }
-            chunk_size = std::min(chunk_size, data_size - written);
-            Chunk new_chunk(current_pos, chunk_size);
-            std::copy_n(data.data() + written, chunk_size, new_chunk.data.data());
-            chunks.emplace(current_pos, std::move(new_chunk));
-            written += chunk_size;
-        }
-        total_size = std::max(total_size, pos + written);
-        merge_chunks();
-        return written;
+        copy_in(pos, data.data(), data.size());
+        valid.insert(pos, pos + data.size());
+        total_size = std::max(total_size, pos + data.size());
+        return data.size();
     }
     /// @brief Write data to the sparse buffer, without overwriting existing data, return the number of bytes written
     inline constexpr size_type write_sparse(size_type pos, std::span<const T> data) {
         if (data.empty()) return 0;
-        size_type written = 0;
-        size_type data_size = data.size();
-        while (written < data_size) {
-            size_type current_pos = pos + written;
-            auto it = chunks.upper_bound(current_pos);
-            if (it != chunks.begin()) {
-                auto prev_it = std::prev(it);
-                if (prev_it->second.contains(current_pos)) {
-                    // Skip existing chunk
-                    size_type chunk_skipped = std::min(data_size - written, prev_it->second.endat() - current_pos);
-                    written += chunk_skipped;
-                    continue;
-                }
-            }
-            // Create a new chunk
-            size_type chunk_size = 1;
-            if (it != chunks.end()) {
-                chunk_size = std::max(chunk_size, it->first - current_pos);
-            }
-            chunk_size = std::min(chunk_size, data_size - written);
-            Chunk new_chunk(current_pos, chunk_size);
-            std::copy_n(data.data() + written, chunk_size, new_chunk.data.data());
-            chunks.emplace(current_pos, std::move(new_chunk));
-            written += chunk_size;
-        }
-        total_size = std::max(total_size, pos + written);
-        merge_chunks();
-        return written;
+        valid.for_each_gap(pos, pos + data.size(), [&](size_type begin, size_type end) {
+            copy_in(begin, data.data() + (begin - pos), end - begin);
+        });
+        valid.insert(pos, pos + data.size());
+        total_size = std::max(total_size, pos + data.size());
+        return data.size();
     }
     /// @brief Resize the sparse buffer, if the new size is smaller, truncate the buffer
     inline constexpr void resize(size_type new_size) {
         if (new_size < total_size) {
-            // Truncate the buffer
-            auto it = chunks.lower_bound(new_size);
-            if (it != chunks.begin()) {
-                auto prev_it = std::prev(it);
-                if (prev_it->second.endat() > new_size) {
-                    prev_it->second.data.resize(new_size - prev_it->second.offset);
-                }
-            }
-            chunks.erase(it, chunks.end());
+            // Truncate the buffer, the pages past the end are released
+            valid.erase(new_size, total_size);
+            pages.erase(pages.lower_bound((new_size + page_size - 1) / page_size), pages.end());
         }
         total_size = new_size;
     }
@@ -1,6 +1,8 @@
 #pragma once
 #include "iostream.hpp"
 #include "string.hpp"
+#include "memstats.hpp"
+#include <array>
 
 LCORE_NAMESPACE_BEGIN
 
@@ -29,18 +31,28 @@ struct _BasicStringBufferData {
     std::array<BufferPointer<CharT>*, 2> _onChanged = {nullptr}; // Pointers to the input and output buffers, when the data changes, the buffers will be notified
     std::size_t _onChangedCount = 0;
 
+    CharT* Allocate(std::size_t size) {
+        CharT* data = _allocator.allocate(size);
+        detail::MemStatsAllocate(MemSubsystem::String, size * sizeof(CharT));
+        return data;
+    }
+    void Deallocate(CharT* data, std::size_t size) {
+        detail::MemStatsDeallocate(MemSubsystem::String, size * sizeof(CharT));
+        _allocator.deallocate(data, size);
+    }
+
     _BasicStringBufferData(std::size_t length = 0)
-        : _data(_allocator.allocate(length + 1)), _size(length + 1) {} 
+        : _data(Allocate(length + 1)), _size(length + 1) {} 
     
     _BasicStringBufferData(std::basic_string_view<CharT> str)
-        : _data(_allocator.allocate(str.length() + 1)), _size(str.length() + 1) {
+        : _data(Allocate(str.length() + 1)), _size(str.length() + 1) {
         std::copy(str.data(), str.data() + str.length(), _data);
         _data[str.size()] = '\0'; // Null-terminate the string
     }
 
     ~_BasicStringBufferData() {
         if (_data) {
-            _allocator.deallocate(_data, _size);
+            Deallocate(_data, _size);
         }
     }
     _BasicStringBufferData(const _BasicStringBufferData&) = delete;
@@ -59,11 +71,16 @@ struct _BasicStringBufferData {
         }
     }
 
+    /// @brief Make room for requiredSize characters (including the null terminator), growing geometrically
+    void Reserve(std::size_t requiredSize) {
+        if (requiredSize > _size) ReAlloc(requiredSize);
+    }
+
     void ReAlloc(std::size_t requiredSize = 0) {
         std::size_t newSize = std::max(_size * 2, requiredSize);
-        CharT* newData = _allocator.allocate(newSize);
+        CharT* newData = Allocate(newSize);
         std::copy(_data, _data + _size, newData);
-        _allocator.deallocate(_data, _size);
+        Deallocate(_data, _size);
         _data = newData;
         _size = newSize;
 
@@ -204,7 +221,7 @@ public:
     std::streamsize SPutN(const CharType* s, std::streamsize n) {
         if (this->buffer.current + n > this->buffer.end) {
             // Not enough space, reallocate
-            this->_buffer->ReAlloc(this->buffer.current - this->buffer.begin + n + 1);
+            this->_buffer->Reserve(this->buffer.current - this->buffer.begin + n + 1);
         }
         std::copy(s, s + n, this->buffer.current);
         this->buffer.current += n;
@@ -214,7 +231,7 @@ public:
     }
 protected:
     IntType Overflow(IntType c = Traits::eof()) override {
-        this->_buffer->ReAlloc();
+        this->_buffer->Reserve(this->buffer.current - this->buffer.begin + 2);
         if (c != Traits::eof()) {
             *this->buffer.current++ = Traits::to_char_type(c);
             this->_buffer->OnLengthChanged(this->buffer.current - this->buffer.begin);
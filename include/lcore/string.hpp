@@ -128,4 +128,22 @@ inline String String::Join(Container&& container, StringView sep){
     return ss.str();
 };
 
+/// @brief A transparent hash of every string type, equal strings hash the same whatever their type
+/// @note Together with std::equal_to<>, lets the hash containers and LRUCache look up String keys from views without a copy
+struct StringHash {
+    using is_transparent = void;
+    inline size_t operator()(std::string_view str) const noexcept {
+        return std::hash<std::string_view>()(str);
+    }
+};
+
 LCORE_NAMESPACE_END
+
+
+// Hash specialization for String and StringView, the same as std::string
+namespace std {
+template <>
+struct hash<LCORE_NAMESPACE_NAME::String>: LCORE_NAMESPACE_NAME::StringHash {};
+template <>
+struct hash<LCORE_NAMESPACE_NAME::StringView>: LCORE_NAMESPACE_NAME::StringHash {};
+}
@@ -0,0 +1,523 @@
+/**
+ * @file tieredcache.hpp
+ * @brief A memory cache spilling its evicted entries to a log on the local disk, for working sets larger than the memory
+ */
+#pragma once
+#include "base.hpp"
+#include "checksum.hpp"
+#include "exception.hpp"
+#include "lru.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+LCORE_NAMESPACE_BEGIN
+
+/**
+ * @brief Converts the keys and values of a TieredCache to bytes and back
+ *
+ * Specialize it for other types: Encode appends the bytes of a value to out,
+ * Decode returns std::nullopt for bytes it cannot read, e.g. written by an older version of the type.
+ */
+template <typename T>
+struct CacheCodec;
+
+/// @brief Trivially copyable types are stored as their object representation
+template <typename T> requires std::is_trivially_copyable_v<T>
+struct CacheCodec<T> {
+    static void Encode(const T& value, std::string& out) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    static std::optional<T> Decode(std::string_view bytes) {
+        if (bytes.size() != sizeof(T)) return std::nullopt;
+        T value;
+        std::memcpy(&value, bytes.data(), sizeof(T));
+        return value;
+    }
+};
+
+/// @brief Strings are stored as their characters
+template <typename T> requires std::is_base_of_v<std::string, T>
+struct CacheCodec<T> {
+    static void Encode(const T& value, std::string& out) { out.append(value); }
+    static std::optional<T> Decode(std::string_view bytes) { return T(std::string(bytes)); }
+};
+
+namespace detail {
+
+/**
+ * @brief The disk tier of TieredCache: records appended to segment files in a directory, indexed in memory
+ *
+ * A record is {checksum, key size, value size, key, value}, a value size of Tombstone erases the key.
+ * Segments are filled one at a time up to segment_bytes. When the total exceeds max_bytes the oldest segment is deleted
+ * along with the keys whose latest record it held: the space is reclaimed in whole files, never by compaction.
+ * Opening the directory again replays the segments in order to rebuild the index,
+ * a torn record at the end of a segment is cut off.
+ *
+ * Append is called by a single writer, Read and Contains by any thread.
+ */
+template <typename K, typename Hash, typename KeyEqual, typename KeyCodec>
+class SegmentLog {
+public:
+    static constexpr std::uint32_t Tombstone = 0xFFFFFFFFu;
+
+    /// @brief A record to append, key_bytes and value are encoded by the caller
+    struct Record {
+        const K* key;
+        std::string_view key_bytes;
+        std::optional<std::string_view> value; // std::nullopt erases the key
+    };
+private:
+    struct RecordHeader {
+        std::uint64_t checksum;
+        std::uint32_t key_size;
+        std::uint32_t value_size;
+    };
+    struct Segment {
+        std::uint32_t id;
+        std::filesystem::path path;
+        std::FILE* file = nullptr;
+        std::uint64_t size = 0;
+        std::vector<K> keys;  // Of the records in this segment, to unindex them when it is dropped
+        std::mutex mutex;     // Of the FILE position, shared by the writer and the readers
+        bool dropped = false; // Remove the file once the last reader is done with it
+
+        ~Segment() {
+            if (file) std::fclose(file);
+            if (dropped) {
+                std::error_code error;
+                std::filesystem::remove(path, error);
+            }
+        }
+    };
+    struct Location {
+        std::uint32_t segment;
+        std::uint32_t value_size;
+        std::uint64_t offset; // Of the value
+    };
+
+    std::filesystem::path directory;
+    std::uint64_t max_bytes;
+    std::uint64_t segment_bytes;
+    std::uint64_t total_bytes = 0;
+    std::map<std::uint32_t, std::shared_ptr<Segment>> segments; // In the order they were written
+    std::unordered_map<K, Location, Hash, KeyEqual> index;
+    mutable std::mutex mutex; // Of segments, index and total_bytes
+
+    static std::uint64_t ChecksumOf(const RecordHeader& header, std::string_view key, std::string_view value) noexcept {
+        std::uint64_t sizes[] = {header.key_size, header.value_size};
+        std::uint64_t checksum = Checksum64(sizes, sizeof(sizes));
+        checksum = Checksum64(key.data(), key.size(), checksum);
+        return Checksum64(value.data(), value.size(), checksum);
+    }
+
+    std::filesystem::path PathOf(std::uint32_t id) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "segment-%08x.log", static_cast<unsigned>(id));
+        return directory / name;
+    }
+
+    static std::FILE* OpenFile(const std::filesystem::path& path, const char* mode) {
+        std::FILE* file = std::fopen(path.string().c_str(), mode);
+        if (!file) throw SystemError(errno);
+        return file;
+    }
+
+    /// @brief Index the valid records of an existing segment and cut off the torn tail
+    void Replay(Segment& segment) {
+        std::uint64_t file_size = std::filesystem::file_size(segment.path);
+        std::string key, value;
+        for (;;) {
+            RecordHeader header;
+            if (std::fread(&header, sizeof(header), 1, segment.file) != 1) break;
+            std::uint32_t value_size = header.value_size == Tombstone ? 0 : header.value_size;
+            if (segment.size + sizeof(header) + header.key_size + value_size > file_size) break;
+            key.resize(header.key_size);
+            value.resize(value_size);
+            if (std::fread(key.data(), 1, key.size(), segment.file) != key.size()) break;
+            if (std::fread(value.data(), 1, value.size(), segment.file) != value.size()) break;
+            if (ChecksumOf(header, key, value) != header.checksum) break;
+
+            std::uint64_t offset = segment.size + sizeof(header) + header.key_size;
+            segment.size = offset + value_size;
+            std::optional<K> decoded = KeyCodec::Decode(key);
+            if (!decoded) continue;
+            if (header.value_size == Tombstone) {
+                index.erase(*decoded);
+            } else {
+                index.insert_or_assign(*decoded, Location{segment.id, value_size, offset});
+                segment.keys.push_back(std::move(*decoded));
+            }
+        }
+        std::fclose(segment.file);
+        segment.file = nullptr;
+        std::filesystem::resize_file(segment.path, segment.size);
+        segment.file = OpenFile(segment.path, "r+b");
+    }
+
+    Segment& Active() {
+        if (segments.empty() || segments.rbegin()->second->size >= segment_bytes) {
+            std::uint32_t id = segments.empty() ? 0 : segments.rbegin()->first + 1;
+            auto segment = std::make_shared<Segment>();
+            segment->id = id;
+            segment->path = PathOf(id);
+            segment->file = OpenFile(segment->path, "w+b");
+            std::lock_guard lock(mutex);
+            segments.emplace(id, std::move(segment));
+        }
+        return *segments.rbegin()->second;
+    }
+
+    /// @brief Delete the oldest segments until the log fits, never the one being written
+    void Trim() {
+        std::lock_guard lock(mutex);
+        while (total_bytes > max_bytes && segments.size() > 1) {
+            auto oldest = segments.begin();
+            Segment& segment = *oldest->second;
+            for (const K& key: segment.keys) {
+                auto it = index.find(key);
+                if (it != index.end() && it->second.segment == segment.id) index.erase(it);
+            }
+            total_bytes -= segment.size;
+            segment.dropped = true;
+            segments.erase(oldest);
+        }
+    }
+public:
+    /**
+     * @brief Open the log in a directory, created if needed, and index the segments already there
+     * @param max_bytes The disk space the segments may take, exceeded by at most one batch of records
+     * @throw SystemError When the directory or a segment cannot be opened
+     */
+    SegmentLog(std::filesystem::path directory, std::uint64_t max_bytes)
+        : directory(std::move(directory)), max_bytes(max_bytes),
+          segment_bytes(std::clamp<std::uint64_t>(max_bytes / 16, 1 << 16, 1 << 30)) {
+        std::filesystem::create_directories(this->directory);
+        for (const auto& file: std::filesystem::directory_iterator(this->directory)) {
+            unsigned id;
+            char tail;
+            std::string name = file.path().filename().string();
+            if (std::sscanf(name.c_str(), "segment-%08x.lo%c", &id, &tail) != 2 || tail != 'g' || PathOf(id) != file.path()) continue;
+            auto segment = std::make_shared<Segment>();
+            segment->id = id;
+            segment->path = file.path();
+            segment->file = OpenFile(segment->path, "r+b");
+            segments.emplace(id, std::move(segment));
+        }
+        for (auto& [id, segment]: segments) {
+            Replay(*segment);
+            total_bytes += segment->size;
+        }
+        Trim();
+    }
+    SegmentLog(const SegmentLog&) = delete;
+    SegmentLog& operator=(const SegmentLog&) = delete;
+
+    /// @brief Append records and flush them to the system, then publish them to the readers
+    /// @throw SystemError When a write fails, the records written so far are kept
+    void Append(const Record* records, std::size_t count) {
+        std::string buffer;
+        std::size_t done = 0;
+        while (done < count) {
+            Segment& segment = Active();
+            std::vector<std::pair<const Record*, Location>> written;
+            buffer.clear();
+            for (; done < count && segment.size + buffer.size() < segment_bytes; ++done) {
+                const Record& record = records[done];
+                std::string_view value = record.value.value_or(std::string_view());
+                RecordHeader header{0, static_cast<std::uint32_t>(record.key_bytes.size()),
+                                    record.value ? static_cast<std::uint32_t>(value.size()) : Tombstone};
+                header.checksum = ChecksumOf(header, record.key_bytes, value);
+                buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+                buffer.append(record.key_bytes);
+                written.emplace_back(&record, Location{segment.id, static_cast<std::uint32_t>(value.size()), segment.size + buffer.size()});
+                buffer.append(value);
+            }
+            {
+                std::lock_guard lock(segment.mutex);
+                if (std::fseek(segment.file, static_cast<long>(segment.size), SEEK_SET) != 0 ||
+                    std::fwrite(buffer.data(), 1, buffer.size(), segment.file) != buffer.size() || std::fflush(segment.file) != 0) {
+                    int error = errno;
+                    std::clearerr(segment.file);
+                    throw SystemError(error);
+                }
+            }
+            std::lock_guard lock(mutex);
+            segment.size += buffer.size();
+            total_bytes += buffer.size();
+            for (auto& [record, location]: written) {
+                if (record->value) {
+                    index.insert_or_assign(*record->key, location);
+                    segment.keys.push_back(*record->key);
+                } else {
+                    index.erase(*record->key);
+                }
+            }
+        }
+        Trim();
+    }
+
+    /// @brief Read the latest value of a key into value
+    /// @return false if the key is not in the log, or its segment could not be read
+    bool Read(const K& key, std::string& value) const {
+        std::shared_ptr<Segment> segment;
+        Location location;
+        {
+            std::lock_guard lock(mutex);
+            auto it = index.find(key);
+            if (it == index.end()) return false;
+            location = it->second;
+            segment = segments.at(location.segment);
+        }
+        value.resize(location.value_size);
+        std::lock_guard lock(segment->mutex);
+        return std::fseek(segment->file, static_cast<long>(location.offset), SEEK_SET) == 0 &&
+               std::fread(value.data(), 1, value.size(), segment->file) == value.size();
+    }
+
+    bool Contains(const K& key) const {
+        std::lock_guard lock(mutex);
+        return index.contains(key);
+    }
+    /// @brief Get the number of keys in the log
+    std::size_t Size() const {
+        std::lock_guard lock(mutex);
+        return index.size();
+    }
+    /// @brief Get the size of the segments, including the records overwritten since
+    std::uint64_t Bytes() const {
+        std::lock_guard lock(mutex);
+        return total_bytes;
+    }
+};
+
+}
+
+/**
+ * @brief A cache of two tiers: an LRUCache in memory, and a log of the entries it evicted on the local disk
+ *
+ * Entries evicted from the memory tier are handed to a background thread, which appends them to the disk tier
+ * (see detail::SegmentLog) in batches. Get looks in memory, then in the entries waiting to be written, then on the disk,
+ * and moves the entry found back to memory. An entry read from the disk and left unchanged is not written again when evicted.
+ * The disk tier survives the cache: opening the same directory again finds the entries it held, though not those in memory.
+ *
+ * Sized to the working set, e.g. a memory tier of a tenth of it and a disk tier of all of it,
+ * the cache serves the hot entries at memory speed and the rest at the cost of a read from the page cache or the disk.
+ * Losing entries is allowed: a failed write drops them, as the disk tier drops its oldest segment when full.
+ * @tparam KeyCodec, ValueCodec Convert the keys and values to bytes, see CacheCodec
+ * @note Not thread-safe, like LRUCache, apart from its own writer thread
+ */
+template <
+    typename K,
+    typename V,
+    typename Hash = std::hash<K>,
+    typename KeyEqual = std::equal_to<>,
+    typename KeyCodec = CacheCodec<K>,
+    typename ValueCodec = CacheCodec<V>
+>
+class TieredCache {
+public:
+    using KeyType = K;
+    using ValueType = V;
+private:
+    struct Slot {
+        V value;
+        bool persisted; // The disk tier holds this value, or will once the writer is done
+    };
+    /// @brief An entry waiting for the writer, std::nullopt erases the key from the disk tier
+    struct Spill {
+        K key;
+        std::optional<V> value;
+    };
+    using SpillPtr = std::shared_ptr<const Spill>;
+    using Log = detail::SegmentLog<K, Hash, KeyEqual, KeyCodec>;
+    using Memory = LRUCache<K, Slot, InplaceFunction<void(const K&, const Slot&)>, K, Hash, KeyEqual>;
+
+    Log log;
+    Memory memory;
+    std::size_t max_pending;
+    std::mutex mutex; // Of the fields below, shared with the writer
+    std::condition_variable wake;    // The writer has work, or must stop
+    std::condition_variable drained; // The writer took or finished a batch
+    std::deque<SpillPtr> queue;
+    std::unordered_map<K, SpillPtr, Hash, KeyEqual> pending; // The latest spill of each key not yet written
+    bool writing = false;
+    bool stopping = false;
+    std::atomic<std::uint64_t> write_errors = 0;
+    std::thread writer;
+
+    void Enqueue(SpillPtr spill) {
+        std::unique_lock lock(mutex);
+        drained.wait(lock, [&] { return queue.size() < max_pending; });
+        pending.insert_or_assign(spill->key, spill);
+        queue.push_back(std::move(spill));
+        wake.notify_one();
+    }
+
+    void OnEvicted(const K& key, const Slot& slot) {
+        if (!slot.persisted) Enqueue(std::make_shared<const Spill>(Spill{key, slot.value}));
+    }
+
+    void Write(const std::vector<SpillPtr>& batch) {
+        std::string bytes;
+        std::vector<std::size_t> ends; // Of the key and the value of each spill in bytes
+        for (const SpillPtr& spill: batch) {
+            KeyCodec::Encode(spill->key, bytes);
+            ends.push_back(bytes.size());
+            if (spill->value) ValueCodec::Encode(*spill->value, bytes);
+            ends.push_back(bytes.size());
+        }
+        std::vector<typename Log::Record> records;
+        records.reserve(batch.size());
+        std::string_view view(bytes);
+        std::size_t begin = 0;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            std::size_t key_end = ends[2 * i], value_end = ends[2 * i + 1];
+            std::optional<std::string_view> value;
+            if (batch[i]->value) value = view.substr(key_end, value_end - key_end);
+            records.push_back({&batch[i]->key, view.substr(begin, key_end - begin), value});
+            begin = value_end;
+        }
+        log.Append(records.data(), records.size());
+    }
+
+    void RunWriter() {
+        std::vector<SpillPtr> batch;
+        std::unique_lock lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.end()));
+            queue.clear();
+            writing = true;
+            drained.notify_all();
+            lock.unlock();
+            try {
+                Write(batch);
+            } catch (...) {
+                write_errors.fetch_add(1, std::memory_order_relaxed);
+            }
+            lock.lock();
+            // Published to the log now, unless a newer spill replaced it
+            for (const SpillPtr& spill: batch) {
+                auto it = pending.find(spill->key);
+                if (it != pending.end() && it->second == spill) pending.erase(it);
+            }
+            batch.clear();
+            writing = false;
+            drained.notify_all();
+        }
+    }
+
+    SpillPtr FindPending(const K& key) {
+        std::lock_guard lock(mutex);
+        auto it = pending.find(key);
+        return it == pending.end() ? nullptr : it->second;
+    }
+public:
+    /**
+     * @brief Open the disk tier in a directory and start the writer
+     * @param memory_entries The number of entries kept in memory
+     * @param directory Where the disk tier keeps its segments, an existing disk tier is reused
+     * @param disk_bytes The disk space of the disk tier
+     * @param max_pending The number of evicted entries waiting for the writer beyond which Put blocks
+     * @throw SystemError When the directory cannot be opened
+     */
+    TieredCache(std::size_t memory_entries, std::filesystem::path directory, std::uint64_t disk_bytes, std::size_t max_pending = 1 << 16)
+        : log(std::move(directory), disk_bytes),
+          memory(memory_entries, [this](const K& key, const Slot& slot) { OnEvicted(key, slot); }),
+          max_pending(std::max<std::size_t>(max_pending, 1)), writer([this] { RunWriter(); }) {}
+    TieredCache(const TieredCache&) = delete;
+    TieredCache& operator=(const TieredCache&) = delete;
+    /// @brief Write the pending entries and stop the writer, the memory tier is not written
+    ~TieredCache() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+    }
+
+    /**
+     * @brief Look up an entry in memory, then on the disk, and keep it in memory
+     * @return The value, nullptr if not found. The pointer is valid until the entry is evicted or erased
+     */
+    const ValueType* Get(const K& key) {
+        if (Slot* slot = memory.Get(key)) return &slot->value;
+        std::optional<V> value;
+        if (SpillPtr spill = FindPending(key)) {
+            if (!spill->value) return nullptr;
+            value = spill->value;
+        } else {
+            std::string bytes;
+            if (!log.Read(key, bytes)) return nullptr;
+            value = ValueCodec::Decode(bytes);
+            if (!value) return nullptr;
+        }
+        Slot* slot = memory.Emplace(key, Slot{std::move(*value), true});
+        return slot ? &slot->value : nullptr;
+    }
+
+    /// @brief Insert or update an entry in memory, the least recently used one moves to the disk
+    void Put(K key, V value) {
+        memory.Put(std::move(key), Slot{std::move(value), false});
+    }
+
+    /// @brief Remove an entry from both tiers
+    /// @return true if it was in memory, or waiting for the writer or on the disk
+    bool Erase(const K& key) {
+        bool erased = memory.Erase(key);
+        SpillPtr spill = FindPending(key);
+        if (spill ? spill->value.has_value() : log.Contains(key)) {
+            Enqueue(std::make_shared<const Spill>(Spill{key, std::nullopt}));
+            return true;
+        }
+        return erased;
+    }
+
+    bool Exists(const K& key) {
+        if (memory.Exists(key)) return true;
+        SpillPtr spill = FindPending(key);
+        return spill ? spill->value.has_value() : log.Contains(key);
+    }
+
+    /// @brief Wait until the evicted entries are written to the disk tier
+    void Flush() {
+        std::unique_lock lock(mutex);
+        drained.wait(lock, [&] { return queue.empty() && !writing; });
+    }
+    /// @brief Move every entry to the disk tier and wait until they are written, e.g. before a shutdown
+    void FlushAll() {
+        memory.Clear();
+        Flush();
+    }
+
+    /// @brief Get the number of entries in the memory tier
+    std::size_t MemorySize() const noexcept { return memory.Size(); }
+    /// @brief Get the number of keys in the disk tier, written so far
+    std::size_t DiskSize() const { return log.Size(); }
+    /// @brief Get the disk space taken by the disk tier
+    std::uint64_t DiskBytes() const { return log.Bytes(); }
+    /// @brief Get the number of batches the writer failed to write, their entries were dropped
+    std::uint64_t WriteErrors() const noexcept { return write_errors.load(std::memory_order_relaxed); }
+};
+
+LCORE_NAMESPACE_END
@@ -0,0 +1,128 @@
+/**
+ * @file timerwheel.hpp
+ * @brief A hierarchical timer wheel over the entries of a slab
+ */
+#pragma once
+#include "base.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+LCORE_NAMESPACE_BEGIN
+
+namespace detail {
+
+/// @brief The per-entry state of TimerWheel, times are in nanoseconds
+struct TimerNode {
+    static constexpr std::int64_t Never = std::numeric_limits<std::int64_t>::max();
+
+    std::uint32_t prev;
+    std::uint32_t next;
+    std::int64_t deadline = Never;      // Expiry time, the entry is scheduled unless it is Never
+    std::int64_t write_deadline = Never; // Deadline set by the last write, bounds the one extended by the reads
+    std::uint16_t bucket;
+    bool refreshing = false;            // A refresh was requested since the last write
+};
+
+/**
+ * @brief Buckets entries by deadline in levels of growing granularity, as Caffeine's TimerWheel
+ *
+ * The levels span about 1 s, 1 min, 1 h, 1 day and 6 days per bucket (powers of 2 of nanoseconds).
+ * Scheduling and descheduling are O(1). Advance() visits only the buckets the time went past, an entry of a coarse bucket
+ * is moved down to a finer one until its deadline passes: it is visited once per level at most.
+ * An entry is reported up to one bucket span of its level after its deadline, lookups check the deadline themselves.
+ * The nodes are reached through an accessor: nodes[index] gives the TimerNode.
+ */
+class TimerWheel {
+    static constexpr std::size_t Levels = 5;
+    static constexpr unsigned Shifts[Levels] = {30, 36, 42, 47, 49};
+    static constexpr std::size_t Buckets[Levels] = {64, 64, 32, 4, 1};
+    static constexpr std::size_t Offsets[Levels] = {0, 64, 128, 160, 164};
+    static constexpr std::size_t BucketCount = 165;
+    static constexpr std::uint32_t Null = ~std::uint32_t(0);
+
+    std::uint32_t heads[BucketCount];
+    std::int64_t time = 0; // Time of the last Advance
+
+    std::size_t BucketOf(std::int64_t deadline) const noexcept {
+        std::uint64_t duration = static_cast<std::uint64_t>(std::max<std::int64_t>(deadline - time, 0));
+        for (std::size_t level = 0; level + 1 < Levels; ++level) {
+            if (duration < (std::uint64_t(1) << Shifts[level + 1])) {
+                return Offsets[level] + ((static_cast<std::uint64_t>(deadline) >> Shifts[level]) & (Buckets[level] - 1));
+            }
+        }
+        return Offsets[Levels - 1];
+    }
+public:
+    TimerWheel() noexcept { Clear(); }
+
+    void Clear() noexcept {
+        std::fill(std::begin(heads), std::end(heads), Null);
+    }
+
+    /// @brief Add an entry whose deadline is set, it must not be scheduled
+    template <typename Nodes>
+    void Schedule(std::uint32_t index, const Nodes& nodes) noexcept {
+        TimerNode& node = nodes[index];
+        if (node.deadline == TimerNode::Never) return;
+        node.bucket = static_cast<std::uint16_t>(BucketOf(node.deadline));
+        node.prev = Null;
+        node.next = heads[node.bucket];
+        if (node.next != Null) nodes[node.next].prev = index;
+        heads[node.bucket] = index;
+    }
+    /// @brief Remove an entry if it is scheduled, its deadline is left unchanged
+    template <typename Nodes>
+    void Deschedule(std::uint32_t index, const Nodes& nodes) noexcept {
+        TimerNode& node = nodes[index];
+        if (node.deadline == TimerNode::Never) return;
+        if (node.prev != Null) nodes[node.prev].next = node.next;
+        else heads[node.bucket] = node.next;
+        if (node.next != Null) nodes[node.next].prev = node.prev;
+    }
+    /// @brief Change the deadline of an entry, scheduled or not
+    template <typename Nodes>
+    void Reschedule(std::uint32_t index, std::int64_t deadline, const Nodes& nodes) noexcept {
+        Deschedule(index, nodes);
+        nodes[index].deadline = deadline;
+        Schedule(index, nodes);
+    }
+
+    /**
+     * @brief Move the time to now and call expire(index) for the entries whose deadline passed
+     * @param expire Removes the entry from the cache, it must not touch the wheel: the entry is already descheduled
+     * and its deadline is set to Never
+     */
+    template <typename Nodes, typename Expire>
+    void Advance(std::int64_t now, const Nodes& nodes, Expire&& expire) {
+        std::int64_t previous = time;
+        if (now <= previous) return;
+        time = now;
+        for (std::size_t level = 0; level < Levels; ++level) {
+            std::uint64_t previous_ticks = static_cast<std::uint64_t>(previous) >> Shifts[level];
+            std::uint64_t ticks = static_cast<std::uint64_t>(now) >> Shifts[level];
+            if (ticks == previous_ticks) break;
+            std::size_t steps = static_cast<std::size_t>(std::min<std::uint64_t>(ticks - previous_ticks + 1, Buckets[level]));
+            for (std::size_t step = 0; step < steps; ++step) {
+                std::size_t bucket = Offsets[level] + ((previous_ticks + step) & (Buckets[level] - 1));
+                std::uint32_t index = heads[bucket];
+                heads[bucket] = Null;
+                while (index != Null) {
+                    TimerNode& node = nodes[index];
+                    std::uint32_t next = node.next;
+                    if (node.deadline <= now) {
+                        node.deadline = TimerNode::Never;
+                        expire(index);
+                    } else {
+                        Schedule(index, nodes); // To a finer bucket
+                    }
+                    index = next;
+                }
+            }
+        }
+    }
+};
+
+}
+
+LCORE_NAMESPACE_END
@@ -0,0 +1,59 @@
+#include "lcore/memstats.hpp"
+#include "lcore/config.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+namespace {
+
+constexpr size_t SubsystemCount = static_cast<size_t>(MemSubsystem::Count);
+
+struct DumpState {
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    size_t allocations[SubsystemCount] = {};
+};
+
+DumpState& GetDumpState() {
+    static DumpState state;
+    return state;
+}
+
+// Start measuring the first interval at startup rather than at the first dump
+[[maybe_unused]] const DumpState& startup = GetDumpState();
+
+}
+
+void LCORE_NAMESPACE_NAME::DumpMemStats(std::ostream& os) {
+    auto& state = GetDumpState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - state.last).count();
+    state.last = now;
+
+    if (!MemStatsEnabled) {
+        os << "lcore memory statistics are disabled, build with LCORE_ENABLE_MEMSTATS\n";
+    }
+    os << std::left << std::setw(14) << "subsystem" << std::right
+       << std::setw(14) << "live" << std::setw(14) << "peak"
+       << std::setw(12) << "allocs" << std::setw(12) << "frees"
+       << std::setw(14) << "allocs/s" << '\n';
+    for (size_t i = 0; i < SubsystemCount; ++i) {
+        auto subsystem = static_cast<MemSubsystem>(i);
+        auto stats = GetMemStats(subsystem);
+        double rate = seconds > 0 ? (stats.allocations - state.allocations[i]) / seconds : 0;
+        state.allocations[i] = stats.allocations;
+        os << std::left << std::setw(14) << MemSubsystemName(subsystem) << std::right
+           << std::setw(14) << stats.live_bytes << std::setw(14) << stats.peak_bytes
+           << std::setw(12) << stats.allocations << std::setw(12) << stats.deallocations
+           << std::setw(14) << std::fixed << std::setprecision(1) << rate << '\n';
+    }
+    os.flush();
+}
+
+void LCORE_NAMESPACE_NAME::DumpMemStats() {
+    DumpMemStats(std::cerr);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include "lcore/allocator.hpp"
+#include <list>
+#include <map>
+#include <thread>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+TEST(AllocatorTest, SizeClass) {
+    using detail::SizeClass;
+    for (std::size_t bytes = 1; bytes <= SizeClass::MaxSize; ++bytes) {
+        auto index = SizeClass::Index(bytes);
+        ASSERT_LT(index, SizeClass::Count);
+        EXPECT_GE(SizeClass::Size(index), bytes);
+        if (index > 0) {
+            EXPECT_LT(SizeClass::Size(index - 1), bytes);
+        }
+    }
+}
+
+TEST(AllocatorTest, MonotonicArena) {
+    MonotonicArena arena(256);
+    std::pmr::vector<int> vec(&arena);
+    for (int i = 0; i < 1000; ++i) vec.push_back(i);
+    EXPECT_EQ(vec[999], 999);
+
+    auto p = arena.allocate(24, 64);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % 64, 0);
+
+    auto stats = arena.Stats();
+    EXPECT_GT(stats.allocations, 1);
+    EXPECT_GE(stats.bytes_reserved, stats.bytes_in_use);
+    EXPECT_GE(stats.peak_bytes_in_use, 1000 * sizeof(int));
+
+    vec = std::pmr::vector<int>(&arena);
+    arena.Release();
+    EXPECT_EQ(arena.Stats().bytes_reserved, 0);
+    EXPECT_EQ(arena.Stats().bytes_in_use, 0);
+}
+
+TEST(AllocatorTest, MonotonicArenaInitialBuffer) {
+    alignas(std::max_align_t) char buffer[128];
+    MonotonicArena arena(buffer, sizeof(buffer));
+    auto p = arena.allocate(64);
+    EXPECT_GE(static_cast<char*>(p), buffer);
+    EXPECT_LT(static_cast<char*>(p), buffer + sizeof(buffer));
+    EXPECT_EQ(arena.Stats().bytes_reserved, 0);
+
+    auto q = arena.allocate(256); // Does not fit, goes to the upstream
+    EXPECT_TRUE(static_cast<char*>(q) < buffer || static_cast<char*>(q) >= buffer + sizeof(buffer));
+    EXPECT_GT(arena.Stats().bytes_reserved, 0);
+}
+
+TEST(AllocatorTest, SizeClassAllocator) {
+    SizeClassAllocator resource;
+    {
+        std::pmr::map<int, std::pmr::string> map(&resource);
+        for (int i = 0; i < 1000; ++i) map.emplace(i, std::pmr::string(64, 'a' + i % 26));
+        EXPECT_EQ(map[10], std::pmr::string(64, 'k'));
+        EXPECT_GT(resource.Stats().bytes_in_use, 1000 * 64);
+    }
+    auto stats = resource.Stats();
+    EXPECT_EQ(stats.bytes_in_use, 0);
+    EXPECT_EQ(stats.allocations, stats.deallocations);
+
+    // Freed blocks are reused by the thread cache
+    void* p = resource.allocate(40);
+    resource.deallocate(p, 40);
+    void* q = resource.allocate(48); // Same size class
+    EXPECT_EQ(p, q);
+    resource.deallocate(q, 48);
+
+    // Large and over-aligned blocks go to the global operator new
+    void* aligned = resource.allocate(64, 128);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 128, 0);
+    resource.deallocate(aligned, 64, 128);
+    void* large = resource.allocate(1 << 20);
+    EXPECT_NE(large, nullptr);
+    resource.deallocate(large, 1 << 20);
+}
+
+TEST(AllocatorTest, PoolAllocator) {
+    auto before = PoolAllocator<int>::Stats();
+    {
+        std::list<int, PoolAllocator<int>> list;
+        for (int i = 0; i < 10000; ++i) list.push_back(i);
+        int sum = 0;
+        for (auto v: list) sum += v;
+        EXPECT_EQ(sum, 10000 * 9999 / 2);
+        EXPECT_GE(PoolAllocator<int>::Stats().allocations - before.allocations, 10000);
+    }
+    EXPECT_EQ(PoolAllocator<int>::Stats().bytes_in_use, before.bytes_in_use);
+    EXPECT_TRUE(PoolAllocator<int>() == PoolAllocator<double>());
+}
+
+TEST(AllocatorTest, CrossThread) {
+    // Blocks allocated on one thread and freed on another end up in the shared pool
+    std::vector<void*> blocks;
+    SizeClassAllocator& resource = SizeClassAllocator::Default();
+    auto before = resource.Stats();
+    std::thread producer([&] {
+        for (int i = 0; i < 5000; ++i) blocks.push_back(resource.allocate(32));
+    });
+    producer.join();
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < 4; ++t) {
+        consumers.emplace_back([&, t] {
+            for (std::size_t i = t; i < blocks.size(); i += 4) resource.deallocate(blocks[i], 32);
+            for (int i = 0; i < 1000; ++i) resource.deallocate(resource.allocate(32), 32);
+        });
+    }
+    for (auto& t: consumers) t.join();
+    EXPECT_EQ(resource.Stats().bytes_in_use, before.bytes_in_use);
+}
+
+TEST(AllocatorTest, ThreadExit) {
+    // A thread_local destroyed after the thread cache still allocates and frees, through the shared lists
+    struct Holder {
+        void* block = nullptr;
+        ~Holder() {
+            auto& resource = SizeClassAllocator::Default();
+            resource.deallocate(block, 3000);
+            resource.deallocate(resource.allocate(3000), 3000);
+        }
+    };
+    void* freed = nullptr;
+    std::thread([&] {
+        thread_local Holder holder; // Constructed before the thread cache, so destroyed after it
+        holder.block = freed = SizeClassAllocator::Default().allocate(3000);
+    }).join();
+    void* reused = nullptr;
+    std::thread([&] {
+        reused = SizeClassAllocator::Default().allocate(3000);
+        SizeClassAllocator::Default().deallocate(reused, 3000);
+    }).join();
+    EXPECT_EQ(reused, freed);
+}
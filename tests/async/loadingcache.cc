@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <lcore/async/loadingcache.hpp>
+#include <lcore/async/executor.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME::async;
+using LCORE_NAMESPACE_NAME::LRUCache;
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace {
+
+using Cache = AsyncLoadingCache<int, std::string>;
+
+/// @brief Suspend until the gate opens
+Task<void> WaitFor(const bool& gate) {
+    while (!gate) co_await std::suspend_always();
+}
+
+/// @brief A loader suspended, through a nested task, until its gate opens
+struct SlowLoader {
+    int* calls;
+    const bool* gate;
+
+    Task<std::string> operator()(int key) const {
+        ++*calls;
+        co_await WaitFor(*gate);
+        co_return std::to_string(key);
+    }
+};
+
+struct FailingLoader {
+    int* calls;
+    const bool* gate;
+
+    Task<std::string> operator()(int) const {
+        ++*calls;
+        co_await WaitFor(*gate);
+        throw std::runtime_error("load failed");
+    }
+};
+
+Task<void> Fetch(auto& cache, int key, SlowLoader loader, std::vector<std::string>& results) {
+    results.push_back(co_await cache.GetOrLoad(key, loader));
+}
+
+template <typename BatchLoader>
+Task<void> FetchAll(Cache& cache, std::vector<int> keys, BatchLoader& loader, std::vector<std::string>& results) {
+    results = co_await cache.GetAll(std::move(keys), loader);
+}
+
+Task<void> FetchAllFailing(Cache& cache, std::vector<int> keys, auto& loader, bool& failed) {
+    try {
+        co_await cache.GetAll(std::move(keys), loader);
+    } catch (const LCORE_NAMESPACE_NAME::RuntimeError&) {
+        failed = true;
+    }
+}
+
+Task<void> FetchFailing(auto& cache, int key, FailingLoader loader, int& failures) {
+    try {
+        co_await cache.GetOrLoad(key, loader);
+    } catch (const std::runtime_error&) {
+        ++failures;
+    }
+}
+
+}
+
+TEST(AsyncLoadingCacheTest, SingleFlight) {
+    Cache cache(16);
+    int calls = 0;
+    bool gate = false;
+    std::vector<std::string> results;
+    DefaultExecutor<> executor;
+    for (int i = 0; i < 500; ++i) executor.Schedule(Fetch(cache, i % 2, SlowLoader{&calls, &gate}, results));
+    EXPECT_EQ(cache.Loading(), 2u);
+    gate = true;
+    executor.Run();
+
+    EXPECT_EQ(calls, 2);
+    ASSERT_EQ(results.size(), 500u);
+    for (const std::string& result: results) EXPECT_TRUE(result == "0" || result == "1");
+    EXPECT_EQ(cache.Loading(), 0u);
+    ASSERT_NE(cache.Underlying().Get(1), nullptr);
+
+    // Cached now, no further load
+    executor.Schedule(Fetch(cache, 1, SlowLoader{&calls, &gate}, results));
+    executor.Run();
+    EXPECT_EQ(calls, 2);
+}
+
+TEST(AsyncLoadingCacheTest, FailuresNotCached) {
+    Cache cache(16);
+    int calls = 0, failures = 0;
+    bool gate = false;
+    DefaultExecutor<> executor;
+    for (int i = 0; i < 10; ++i) executor.Schedule(FetchFailing(cache, 7, FailingLoader{&calls, &gate}, failures));
+    gate = true;
+    executor.Run();
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(failures, 10);
+    EXPECT_EQ(cache.Underlying().Get(7), nullptr);
+
+    // The failure is forgotten, the next lookup loads again
+    executor.Schedule(FetchFailing(cache, 7, FailingLoader{&calls, &gate}, failures));
+    executor.Run();
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(failures, 11);
+}
+
+TEST(AsyncLoadingCacheTest, FailuresCached) {
+    Cache cache(16);
+    cache.SetCacheFailures(4);
+    int calls = 0, failures = 0;
+    bool gate = true;
+    DefaultExecutor<> executor;
+    executor.Schedule(FetchFailing(cache, 7, FailingLoader{&calls, &gate}, failures));
+    executor.Run();
+    executor.Schedule(FetchFailing(cache, 7, FailingLoader{&calls, &gate}, failures));
+    executor.Run();
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(failures, 2);
+
+    // Invalidate forgets the failure
+    cache.Invalidate(7);
+    std::vector<std::string> results;
+    executor.Schedule(Fetch(cache, 7, SlowLoader{&calls, &gate}, results));
+    executor.Run();
+    EXPECT_EQ(calls, 2);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0], "7");
+}
+
+TEST(AsyncLoadingCacheTest, GetAllBatches) {
+    Cache cache(64);
+    cache.Put(1, "one");
+    int batch_calls = 0, single_calls = 0;
+    bool gate = false;
+    std::vector<int> requested;
+    auto batch = [&](const std::vector<int>& keys) -> Task<std::vector<std::string>> {
+        ++batch_calls;
+        requested = keys;
+        co_await WaitFor(gate);
+        std::vector<std::string> values;
+        for (int key: keys) values.push_back("v" + std::to_string(key));
+        co_return values;
+    };
+
+    std::vector<std::string> all, single;
+    DefaultExecutor<> executor;
+    // Key 5 is already being loaded when GetAll starts, it is waited for instead of loaded again
+    executor.Schedule(Fetch(cache, 5, SlowLoader{&single_calls, &gate}, single));
+    executor.Schedule(FetchAll(cache, {1, 2, 3, 2, 5, 4}, batch, all));
+    gate = true;
+    executor.Run();
+
+    EXPECT_EQ(batch_calls, 1);
+    EXPECT_EQ(single_calls, 1);
+    EXPECT_EQ(requested, (std::vector<int>{2, 3, 4}));
+    EXPECT_EQ(all, (std::vector<std::string>{"one", "v2", "v3", "v2", "5", "v4"}));
+    EXPECT_NE(cache.Underlying().Get(4), nullptr);
+
+    // Everything is cached
+    executor.Schedule(FetchAll(cache, {2, 3, 4, 5}, batch, all));
+    executor.Run();
+    EXPECT_EQ(batch_calls, 1);
+    EXPECT_EQ(all, (std::vector<std::string>{"v2", "v3", "v4", "5"}));
+}
+
+TEST(AsyncLoadingCacheTest, GetAllWrongCount) {
+    Cache cache(16);
+    auto batch = [](const std::vector<int>&) -> Task<std::vector<std::string>> {
+        co_return std::vector<std::string>{"only one"};
+    };
+    bool failed = false;
+    DefaultExecutor<> executor;
+    executor.Schedule(FetchAllFailing(cache, {1, 2}, batch, failed));
+    executor.Run();
+    EXPECT_TRUE(failed);
+    EXPECT_EQ(cache.Loading(), 0u);
+    EXPECT_EQ(cache.Underlying().Size(), 0u);
+}
+
+TEST(AsyncLoadingCacheTest, LoadStats) {
+    using Counted = LRUCache<int, std::string, LCORE_NAMESPACE_NAME::InplaceFunction<void(const int&, const std::string&)>, int,
+                             std::hash<int>, std::equal_to<>, LCORE_NAMESPACE_NAME::LRUPolicy, LCORE_NAMESPACE_NAME::UnitWeigher,
+                             void, LCORE_NAMESPACE_NAME::CacheStatsCounter>;
+    AsyncLoadingCache<int, std::string, Counted> cache(16);
+    int calls = 0, failures = 0;
+    bool gate = true;
+    std::vector<std::string> results;
+    DefaultExecutor<> executor;
+    executor.Schedule(Fetch(cache, 1, SlowLoader{&calls, &gate}, results));
+    executor.Run();
+    executor.Schedule(Fetch(cache, 1, SlowLoader{&calls, &gate}, results));
+    executor.Schedule(FetchFailing(cache, 2, FailingLoader{&calls, &gate}, failures));
+    executor.Run();
+
+    LCORE_NAMESPACE_NAME::CacheStats stats = cache.Underlying().Stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.load_successes, 1u);
+    EXPECT_EQ(stats.load_failures, 1u);
+}
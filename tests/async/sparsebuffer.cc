@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include <lcore/async/sparsebuffer.hpp>
+#include <lcore/async/executor.hpp>
+#include <span>
+#include <thread>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME::async;
+using LCORE_NAMESPACE_NAME::ConcurrentSparseBuffer;
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace {
+
+using Buffer = ConcurrentSparseBuffer<int>;
+
+/// @brief Sum the blocks of a buffer in order, each once it is written
+Task<void> SumBlocks(const Buffer& buffer, std::size_t block, std::size_t blocks, long long& sum) {
+    for (std::size_t i = 0; i < blocks; ++i) {
+        co_await WaitForRange(buffer, i * block, block);
+        for (auto span: buffer.readv(i * block, block)) {
+            for (int value: span) sum += value;
+        }
+    }
+}
+
+}
+
+TEST(AsyncSparseBufferTest, WaitForRange) {
+    constexpr std::size_t Block = 1000, Blocks = 50;
+    Buffer buffer;
+    long long sum = 0;
+    DefaultExecutor<> executor;
+    executor.Schedule(SumBlocks(buffer, Block, Blocks, sum));
+
+    // Written from another thread, last block first
+    std::thread writer([&] {
+        std::vector<int> values(Block);
+        for (std::size_t i = Blocks; i-- > 0;) {
+            for (std::size_t j = 0; j < Block; ++j) values[j] = static_cast<int>(i * Block + j);
+            buffer.write(i * Block, values);
+        }
+    });
+    executor.Run();
+    writer.join();
+
+    long long n = Block * Blocks;
+    EXPECT_EQ(sum, n * (n - 1) / 2);
+}
+
+TEST(AsyncSparseBufferTest, AlreadyWritten) {
+    Buffer buffer;
+    int data[3] = {1, 2, 3};
+    buffer.write(10, data);
+    long long sum = 0;
+    DefaultExecutor<> executor;
+    executor.Schedule(SumBlocks(buffer, 13, 1, sum)); // [0, 13) is not written
+    bool done = false;
+    auto waiter = [](const Buffer& buffer, bool& done) -> Task<void> {
+        co_await WaitForRange(buffer, 10, 3);
+        done = true;
+    };
+    executor.Schedule(waiter(buffer, done));
+    std::thread writer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        int rest[10] = {};
+        buffer.write(0, rest);
+    });
+    executor.Run();
+    writer.join();
+    EXPECT_TRUE(done);
+    EXPECT_EQ(sum, 6);
+}
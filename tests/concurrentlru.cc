@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include "lcore/concurrentlru.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+TEST(ConcurrentLRUCacheTest, Basic) {
+    ConcurrentLRUCache<int, std::string> cache(100, 4);
+    EXPECT_EQ(cache.ShardCount(), 4);
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+    EXPECT_EQ(cache.Get(1), "one");
+    EXPECT_FALSE(cache.Get(3).has_value());
+    EXPECT_TRUE(cache.Exists(2));
+    std::size_t length = 0;
+    EXPECT_TRUE(cache.Visit(2, [&](const std::string& v) { length = v.size(); }));
+    EXPECT_EQ(length, 3);
+    EXPECT_TRUE(cache.Erase(2));
+    EXPECT_FALSE(cache.Exists(2));
+    EXPECT_EQ(cache.Size(), 1);
+    cache.Clear();
+    EXPECT_EQ(cache.Size(), 0);
+}
+
+TEST(ConcurrentLRUCacheTest, MaxSize) {
+    for (std::size_t max_size: {1, 3, 100, 1000}) {
+        ConcurrentLRUCache<int, int> cache(max_size, 16);
+        EXPECT_EQ(cache.MaxSize(), max_size);
+        for (int i = 0; i < 10000; ++i) cache.Put(i, i);
+        EXPECT_LE(cache.Size(), cache.MaxSize());
+        EXPECT_GT(cache.Size(), 0);
+    }
+}
+
+TEST(ConcurrentLRUCacheTest, BufferedRecency) {
+    // A single shard, so the order is a plain LRU order once the buffered hits are applied
+    std::vector<int> evicted;
+    ConcurrentLRUCache<int, int> cache(3, 1, [&evicted](const int& k, const int&) { evicted.push_back(k); });
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Put(3, 3);
+    EXPECT_TRUE(cache.Get(1).has_value()); // Buffered, applied by the next write
+    cache.Put(4, 4);
+    ASSERT_EQ(evicted.size(), 1);
+    EXPECT_EQ(evicted[0], 2);
+
+    // Stale buffered hits of erased entries are ignored
+    EXPECT_TRUE(cache.Get(3).has_value());
+    EXPECT_TRUE(cache.Erase(3));
+    cache.Put(5, 5);
+    cache.Put(6, 6);
+    EXPECT_EQ(evicted.size(), 2);
+    EXPECT_EQ(evicted[1], 1);
+}
+
+TEST(ConcurrentLRUCacheTest, HotKeySurvivesWriteBurst) {
+    // Readers keep hitting one key while a writer streams fresh keys through the shard, half the shard per round
+    ConcurrentLRUCache<int, int> cache(64, 1);
+    cache.Put(-1, -1);
+    std::atomic<bool> stop = false;
+    std::atomic<std::size_t> reads = 0;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (cache.Get(-1)) reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    int key = 0;
+    bool survived = true;
+    for (int round = 0; round < 20 && survived; ++round) {
+        for (int i = 0; i < 32; ++i) cache.Put(key++, 0);
+        survived = cache.Exists(-1);
+        std::size_t target = reads.load(std::memory_order_relaxed) + 32;
+        while (survived && reads.load(std::memory_order_relaxed) < target) std::this_thread::yield();
+    }
+    stop = true;
+    for (auto& t: readers) t.join();
+    EXPECT_TRUE(survived);
+}
+
+TEST(ConcurrentLRUCacheTest, Stats) {
+    using Cache = ConcurrentLRUCache<int, int, InplaceFunction<void(const int&, const int&)>, int, std::hash<int>, std::equal_to<>,
+                                     LRUPolicy, UnitWeigher, CacheStatsCounter>;
+    Cache cache(1000, 4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < 1000; ++i) {
+                if (t == 0) cache.Put(i, i);
+                else cache.Get(i);
+            }
+        });
+    }
+    for (auto& t: threads) t.join();
+    CacheStats stats = cache.Stats();
+    EXPECT_EQ(stats.hits + stats.misses, 3000u);
+    EXPECT_EQ(stats.puts, 1000u);
+    EXPECT_EQ(stats.size + stats.Evictions(), 1000u);
+}
+
+TEST(ConcurrentLRUCacheTest, MultiThread) {
+    constexpr int Keys = 4000;
+    ConcurrentLRUCache<int, int> cache(1000, 8);
+    std::atomic<int> wrong = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 20000; ++i) {
+                int key = (i * 7 + t * 13) % Keys;
+                if (i % 4 == 0) cache.Put(key, key * 2);
+                else if (auto value = cache.Get(key); value && *value != key * 2) ++wrong;
+                if (i % 97 == 0) cache.Erase(key);
+            }
+        });
+    }
+    for (auto& t: threads) t.join();
+    EXPECT_EQ(wrong, 0);
+    EXPECT_LE(cache.Size(), 1000);
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "lcore/concurrentsparsebuffer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+TEST(ConcurrentSparseBufferTest, ParallelWriters) {
+    using Buffer = ConcurrentSparseBuffer<char, 4096>;
+    constexpr std::size_t Segment = 1000, Segments = 4000, Writers = 4;
+    std::vector<char> stream(Segment * Segments);
+    for (std::size_t i = 0; i < stream.size(); ++i) stream[i] = static_cast<char>(i * 13 + i / 509);
+
+    Buffer buffer(stream.size());
+    std::vector<std::size_t> order(Segments);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+
+    // A consumer streams the data in order as it arrives
+    std::vector<char> consumed;
+    std::thread consumer([&] {
+        for (std::size_t pos = 0; pos < stream.size(); pos += Segment * 10) {
+            buffer.wait_for_range(pos, Segment * 10);
+            for (auto span: buffer.readv(pos, Segment * 10)) consumed.insert(consumed.end(), span.begin(), span.end());
+        }
+    });
+    std::vector<std::thread> writers;
+    for (std::size_t w = 0; w < Writers; ++w) {
+        writers.emplace_back([&, w] {
+            for (std::size_t i = w; i < Segments; i += Writers) {
+                std::size_t pos = order[i] * Segment;
+                buffer.write(pos, std::span<const char>(stream.data() + pos, Segment));
+            }
+        });
+    }
+    for (std::thread& writer: writers) writer.join();
+    consumer.join();
+
+    EXPECT_EQ(consumed, stream);
+    EXPECT_EQ(buffer.chunk_count(), 1u);
+    EXPECT_TRUE(buffer.has_data(0, stream.size()));
+    EXPECT_EQ(buffer.version(), Segments);
+}
+
+TEST(ConcurrentSparseBufferTest, WaitTimeout) {
+    ConcurrentSparseBuffer<int> buffer;
+    int data[4] = {1, 2, 3, 4};
+    buffer.write(0, data);
+    EXPECT_TRUE(buffer.wait_for_range(0, 4, std::chrono::milliseconds(1)));
+    EXPECT_FALSE(buffer.wait_for_range(2, 4, std::chrono::milliseconds(1)));
+    buffer.write_sparse(2, data); // Only fills [4, 6)
+    EXPECT_TRUE(buffer.has_data(2, 4));
+    EXPECT_EQ(buffer.read(3, 2)[0], 4);
+    EXPECT_EQ(buffer.read(4, 2)[1], 4);
+    buffer.clear();
+    EXPECT_EQ(buffer.size(), 0u);
+    EXPECT_FALSE(buffer.has_data(0));
+}
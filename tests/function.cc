@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include "lcore/function.hpp"
+#include "lcore/lru.hpp"
+#include "lcore/option.hpp"
+#include "lcore/pipe.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+static int Twice(int x) { return x * 2; }
+
+TEST(FunctionTest, InplaceFunction) {
+    InplaceFunction<int(int)> empty;
+    EXPECT_FALSE(empty);
+    EXPECT_TRUE(empty == nullptr);
+    EXPECT_THROW(empty(1), RuntimeError);
+
+    int base = 10;
+    InplaceFunction<int(int)> add = [base](int x) { return base + x; };
+    EXPECT_TRUE(add);
+    EXPECT_EQ(add(5), 15);
+
+    auto copy = add;
+    EXPECT_EQ(copy(1), 11);
+    auto moved = std::move(copy);
+    EXPECT_FALSE(copy);
+    EXPECT_EQ(moved(2), 12);
+
+    add = &Twice;
+    EXPECT_EQ(add(4), 8);
+    int (*null_function)(int) = nullptr;
+    add = null_function;
+    EXPECT_FALSE(add);
+
+    // A larger function accepts a smaller one
+    InplaceFunction<int(int), 64> larger = moved;
+    EXPECT_EQ(larger(3), 13);
+}
+
+TEST(FunctionTest, InplaceFunctionLifetime) {
+    auto counter = std::make_shared<int>(0);
+    {
+        InplaceFunction<void()> f = [counter] { ++*counter; };
+        EXPECT_EQ(counter.use_count(), 2);
+        auto g = f;
+        EXPECT_EQ(counter.use_count(), 3);
+        g();
+        f();
+        f = nullptr;
+        EXPECT_EQ(counter.use_count(), 2);
+        InplaceFunction<void()> h = std::move(g);
+        EXPECT_EQ(counter.use_count(), 2);
+        h();
+    }
+    EXPECT_EQ(counter.use_count(), 1);
+    EXPECT_EQ(*counter, 3);
+
+    // Stateful callables keep their state between calls
+    InplaceFunction<int()> next = [i = 0]() mutable { return ++i; };
+    next();
+    EXPECT_EQ(next(), 2);
+}
+
+TEST(FunctionTest, FunctionRef) {
+    auto call = [](FunctionRef<int(int)> f, int x) { return f(x); };
+    int base = 3;
+    auto add = [&base](int x) { return base + x; };
+    EXPECT_EQ(call(add, 1), 4);
+    base = 10;
+    EXPECT_EQ(call(add, 1), 11); // Refers to the lambda, not a copy
+    EXPECT_EQ(call(Twice, 21), 42);
+    EXPECT_EQ(call(&Twice, 5), 10);
+
+    InplaceFunction<int(int)> owned = add;
+    EXPECT_EQ(call(owned, 2), 12);
+
+    // Return value conversion
+    FunctionRef<long(int)> widened = add;
+    EXPECT_EQ(widened(1), 11L);
+    EXPECT_EQ(sizeof(FunctionRef<void()>), 2 * sizeof(void*));
+}
+
+TEST(FunctionTest, Users) {
+    auto some = Option<int>::Some(20);
+    auto mapped = some.Map<std::string>([](const int& v) { return std::to_string(v); });
+    EXPECT_EQ(mapped.Unwrap(), "20");
+    auto none = Option<int>::None();
+    EXPECT_TRUE(none.Map<int>([](const int& v) { return v + 1; }).IsNone());
+    auto chained = some.AndThen<int>([](const int& v) { return v > 10 ? Option<int>::Some(v - 10) : Option<int>::None(); });
+    EXPECT_EQ(chained.Unwrap(), 10);
+
+    std::vector<std::pair<int, int>> evicted;
+    LRUCache<int, int> cache(2, [&evicted](const int& k, const int& v) { evicted.emplace_back(k, v); });
+    cache.Put(1, 10);
+    cache.Put(2, 20);
+    cache.Put(3, 30);
+    ASSERT_EQ(evicted.size(), 1);
+    EXPECT_EQ(evicted[0], std::make_pair(1, 10));
+
+    int calls = 0;
+    Pipe<InplaceFunction<bool(int)>> pipe;
+    pipe.AddHandler([&calls](int) { ++calls; return false; });
+    pipe.AddHandler([&calls](int v) { ++calls; return v > 0; });
+    pipe.AddHandler([&calls](int) { ++calls; return false; });
+    auto [stopped, params] = pipe(1);
+    EXPECT_TRUE(stopped);
+    EXPECT_EQ(std::get<0>(params), 1);
+    EXPECT_EQ(calls, 2);
+}
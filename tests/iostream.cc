@@ -2,6 +2,8 @@
 #include <lcore/iostream.hpp>
 #include <lcore/sstream.hpp>
 #include <lcore/fstream.hpp>
+#include <lcore/backgroundfstream.hpp>
+#include <lcore/mmapstream.hpp>
 #include <sstream>
 
 using namespace LCORE_NAMESPACE_NAME;
@@ -111,6 +113,236 @@ TEST_F(FStreamTest, OFStream) {
     EXPECT_EQ(line, "Appending to the file.");
 }
 
+TEST_F(FStreamTest, BlockIO) {
+    // Blocks smaller than, equal to and larger than the stream buffers, straddling their boundaries
+    std::string data(100000, '\0');
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>('a' + i % 26);
+    const std::size_t blocks[] = {1, 7, 1000, 1024, 1500, 5000, 40000};
+    {
+        OFStream outFile(testfolder / "test_block.txt");
+        std::size_t pos = 0;
+        for (std::size_t i = 0; pos < data.size(); ++i) {
+            std::size_t size = std::min(blocks[i % std::size(blocks)], data.size() - pos);
+            EXPECT_EQ(outFile.PutN(data.data() + pos, size), static_cast<std::streamsize>(size));
+            pos += size;
+        }
+        outFile.Flush();
+    }
+    std::ifstream check(testfolder / "test_block.txt", std::ios::binary);
+    std::string written((std::istreambuf_iterator<char>(check)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(written, data);
+
+    IFStream inFile(testfolder / "test_block.txt");
+    std::string read(data.size(), '\0');
+    std::size_t pos = 0;
+    for (std::size_t i = 3; pos < data.size(); ++i) {
+        std::size_t size = std::min(blocks[i % std::size(blocks)], data.size() - pos);
+        ASSERT_EQ(inFile.GetN(read.data() + pos, size), static_cast<std::streamsize>(size));
+        pos += size;
+    }
+    EXPECT_EQ(read, data);
+    char extra;
+    EXPECT_EQ(inFile.GetN(&extra, 1), 0);
+}
+
+template <typename Handler>
+void RoundTrip(const std::filesystem::path& path, std::size_t bufferSize) {
+    std::string data = "The quick brown fox jumps over the lazy dog.\nPack my box with five dozen liquor jugs.\n";
+    {
+        BasicOFStream<char, std::char_traits<char>, Handler> outFile(path, IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate, bufferSize);
+        outFile << "The quick brown fox";
+        outFile.PutN(data.data() + 19, data.size() - 19);
+        // Written by the destructor
+    }
+    BasicIFStream<char, std::char_traits<char>, Handler> inFile(path, IOSBase::OpenMode::Read, bufferSize);
+    std::string word;
+    inFile >> word;
+    EXPECT_EQ(word, "The");
+    std::string rest(data.size() - 4, '\0');
+    EXPECT_EQ(inFile.GetN(rest.data(), rest.size()), static_cast<std::streamsize>(rest.size()));
+    EXPECT_EQ(rest, data.substr(4)); // >> consumes the space after the word
+
+    inFile.Advise(FileAccess::Random);
+    inFile.SeekPos(4);
+    inFile >> word;
+    EXPECT_EQ(word, "quick");
+    inFile.SeekOff(1, IOSBase::SeekDir::Current);
+    inFile >> word;
+    EXPECT_EQ(word, "rown");
+}
+
+TEST_F(FStreamTest, BufferSize) {
+    for (std::size_t bufferSize: {std::size_t(1), std::size_t(5), std::size_t(16), std::size_t(64 * 1024)}) {
+        RoundTrip<DefaultFileHandler>(testfolder / "test_buffer.txt", bufferSize);
+        RoundTrip<FileStreamHandler>(testfolder / "test_buffer.txt", bufferSize);
+    }
+}
+
+TEST_F(FStreamTest, MmapIFStream) {
+    MmapIFStream inFile(testfolder / "test_read.txt");
+    EXPECT_EQ(inFile.View(), "Hello, World!\nThis is a test file.\n");
+    std::string line;
+    inFile >> line;
+    EXPECT_EQ(line, "Hello,");
+    inFile >> line;
+    EXPECT_EQ(line, "World!");
+    line = inFile.GetLine();
+    EXPECT_EQ(line, "This is a test file.");
+    EXPECT_EQ(inFile.PeekCh(), std::char_traits<char>::eof());
+
+    inFile.SeekPos(7);
+    inFile >> line;
+    EXPECT_EQ(line, "World!");
+    inFile.SeekOff(-6, IOSBase::SeekDir::End);
+    inFile >> line;
+    EXPECT_EQ(line, "file.");
+}
+
+TEST_F(FStreamTest, MmapReadahead) {
+    std::string data(100000, '\0');
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>('a' + i % 26);
+    std::ofstream(testfolder / "test_mmap.txt", std::ios::binary) << data;
+
+    // The buffer ends a window past the cursor, refills only move its end
+    MmapIFStream inFile(testfolder / "test_mmap.txt", MappedFile::Advice::Sequential, 4096);
+    std::string read(data.size() + 1, '\0');
+    EXPECT_EQ(inFile.GetN(read.data(), 3), 3);
+    EXPECT_EQ(inFile.GetN(read.data() + 3, 10000), 10000);
+    EXPECT_EQ(inFile.GetN(read.data() + 10003, read.size() - 10003), static_cast<std::streamsize>(data.size() - 10003));
+    read.pop_back();
+    EXPECT_EQ(read, data);
+
+    inFile.SeekPos(50000);
+    EXPECT_EQ(inFile.GetCh(), data[50000]);
+    EXPECT_THROW(MmapIFStream(testfolder / "missing.txt"), SystemError);
+}
+
+TEST_F(FStreamTest, BackgroundOFStream) {
+    std::string expected;
+    {
+        // Small buffers, so that most lines hand a buffer to the writer
+        BackgroundOFStream outFile(testfolder / "test_background.txt", IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate, 64, 2);
+        for (int i = 0; i < 10000; ++i) {
+            std::string line = "line " + std::to_string(i) + "\n";
+            outFile << std::string_view(line);
+            expected += line;
+        }
+        EXPECT_EQ(outFile.Flush(), 0);
+        std::ifstream inFile(testfolder / "test_background.txt", std::ios::binary);
+        std::string written((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+        EXPECT_EQ(written, expected);
+
+        // Seeking waits for the writer, then overwrites
+        outFile.SeekPos(0);
+        outFile << "LINE";
+        outFile.SeekOff(0, IOSBase::SeekDir::End);
+        outFile << "end\n";
+        expected.replace(0, 4, "LINE");
+        expected += "end\n";
+        EXPECT_EQ(outFile.Error(), 0);
+        // Written by the destructor
+    }
+    std::ifstream inFile(testfolder / "test_background.txt", std::ios::binary);
+    std::string written((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(written, expected);
+}
+
+TEST_F(FStreamTest, BackgroundOFStreamFsync) {
+    std::string data(100000, 'x');
+    BackgroundOFStream outFile(testfolder / "test_fsync.txt", IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate, 4096, 3, FsyncPolicy::EveryBuffer);
+    EXPECT_EQ(outFile.PutN(data.data(), data.size()), static_cast<std::streamsize>(data.size()));
+    EXPECT_EQ(outFile.Flush(), 0);
+    EXPECT_EQ(std::filesystem::file_size(testfolder / "test_fsync.txt"), data.size());
+}
+
+TEST(ScanTest, FindChar) {
+    // Every position of the match, around the SIMD block sizes
+    auto check = [](auto c) {
+        using CharT = decltype(c);
+        for (std::size_t size = 0; size < 80; ++size) {
+            std::basic_string<CharT> text(size, CharT('a'));
+            EXPECT_EQ(detail::FindChar(text.data(), text.data() + size, CharT('\n')), text.data() + size);
+            for (std::size_t pos = 0; pos < size; ++pos) {
+                text[pos] = CharT('\n');
+                EXPECT_EQ(detail::FindChar(text.data(), text.data() + size, CharT('\n')), text.data() + pos);
+                text[pos] = CharT('a');
+            }
+        }
+    };
+    check(char());
+    check(char16_t());
+    check(char32_t());
+    check(wchar_t());
+}
+
+TEST_F(FStreamTest, GetLine) {
+    std::string data;
+    std::vector<std::string> lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines.push_back(std::string(i % 37, static_cast<char>('a' + i % 26)));
+        data += lines.back() + "\n";
+    }
+    data += "last";
+    lines.push_back("last");
+    std::ofstream(testfolder / "test_lines.txt", std::ios::binary) << data;
+
+    // Lines straddle the refills of a small buffer
+    IFStream inFile(testfolder / "test_lines.txt", IOSBase::OpenMode::Read, 16);
+    MmapIFStream mappedFile(testfolder / "test_lines.txt", MappedFile::Advice::Sequential, 4096);
+    IStringStream stringStream(data);
+    for (const std::string& line: lines) {
+        EXPECT_EQ(inFile.GetLine(), line);
+        EXPECT_EQ(mappedFile.GetLine(), line);
+        EXPECT_EQ(stringStream.GetLine(), line);
+    }
+    EXPECT_EQ(inFile.GetLine(), "");
+    EXPECT_EQ(inFile.PeekCh(), std::char_traits<char>::eof());
+
+    IStringStream fields("key=value;other=;end");
+    EXPECT_EQ(fields.GetLine('='), "key");
+    EXPECT_EQ(fields.GetLine(';'), "value");
+    EXPECT_EQ(fields.GetLine('='), "other");
+    EXPECT_EQ(fields.GetLine(';'), "");
+    EXPECT_EQ(fields.GetLine(';'), "end");
+}
+
+TEST_F(FStreamTest, TwoAppenders) {
+    std::ofstream(testfolder / "test_append.txt") << "first\n";
+    {
+        OFStream a(testfolder / "test_append.txt", IOSBase::OpenMode::Append);
+        OFStream b(testfolder / "test_append.txt", IOSBase::OpenMode::Append);
+        a << "from-a" << EndLine;
+        b << "from-b" << EndLine;
+        a << "again-a" << EndLine;
+    }
+    std::ifstream inFile(testfolder / "test_append.txt");
+    std::string written((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(written, "first\nfrom-a\nfrom-b\nagain-a\n");
+}
+
+TEST_F(FStreamTest, ReadPastEnd) {
+    std::ofstream(testfolder / "test_short.txt") << "ab";
+    IFStream inFile(testfolder / "test_short.txt");
+    EXPECT_EQ(inFile.GetCh(), 'a');
+    EXPECT_EQ(inFile.GetCh(), 'b');
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(inFile.GetCh(), std::char_traits<char>::eof());
+}
+
+TEST_F(FStreamTest, SeekWithBufferedOutput) {
+    {
+        OFStream outFile(testfolder / "test_seek.txt", IOSBase::OpenMode::Write | IOSBase::OpenMode::Truncate);
+        outFile.PutN("abc", 3);
+        outFile.SeekPos(10);
+        outFile.PutN("x", 1);
+        outFile.SeekOff(2, IOSBase::SeekDir::Current);
+        outFile.PutN("y", 1);
+    }
+    std::ifstream inFile(testfolder / "test_seek.txt", std::ios::binary);
+    std::string written((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(written, std::string("abc") + std::string(7, '\0') + "x" + std::string(2, '\0') + "y");
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,528 @@
+#include <gtest/gtest.h>
+#include "lcore/lru.hpp"
+#include "lcore/string.hpp"
+#include <chrono>
+#include <list>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+TEST(LRUCacheTest, Basic) {
+    std::vector<std::pair<int, std::string>> evicted;
+    LRUCache<int, std::string> cache(3, [&evicted](const int& k, const std::string& v) { evicted.emplace_back(k, v); });
+    cache.Put(1, "one");
+    cache.Put(2, "two");
+    cache.Put(3, "three");
+    EXPECT_EQ(cache.Size(), 3);
+    ASSERT_NE(cache.Get(1), nullptr); // 1 becomes the most recently used
+    EXPECT_EQ(*cache.Get(1), "one");
+
+    cache.Put(4, "four"); // Evicts 2
+    ASSERT_EQ(evicted.size(), 1);
+    EXPECT_EQ(evicted[0].first, 2);
+    EXPECT_FALSE(cache.Exists(2));
+    EXPECT_TRUE(cache.Exists(1));
+
+    cache.Put(3, "THREE"); // Update, no eviction
+    EXPECT_EQ(evicted.size(), 1);
+    EXPECT_EQ(*cache.Get(3), "THREE");
+
+    EXPECT_TRUE(cache.Erase(1));
+    EXPECT_FALSE(cache.Erase(1));
+    EXPECT_EQ(cache.Size(), 2);
+    cache.Put(5, "five"); // Reuses the erased entry, no eviction
+    EXPECT_EQ(evicted.size(), 1);
+
+    cache.Clear();
+    EXPECT_EQ(cache.Size(), 0);
+    EXPECT_EQ(evicted.size(), 4);
+    EXPECT_EQ(cache.Get(3), nullptr);
+    cache.Put(6, "six");
+    EXPECT_EQ(*cache.Get(6), "six");
+}
+
+TEST(LRUCacheTest, StringView) {
+    LRUCache<std::string, int, InplaceFunction<void(const std::string&, const int&)>, std::string_view> cache(2);
+    cache.Put("alpha", 1);
+    cache.Put(std::string(100, 'x'), 2);
+    std::string_view key = "alpha";
+    ASSERT_NE(cache.Get(key), nullptr);
+    EXPECT_EQ(*cache.Get(key), 1);
+    EXPECT_TRUE(cache.Exists(std::string(100, 'x')));
+    EXPECT_FALSE(cache.Exists("beta"));
+}
+
+/// @brief A string key counting its constructions, looked up transparently from string views
+struct CountedKey {
+    static inline int constructed = 0;
+    std::string text;
+    explicit CountedKey(std::string_view text): text(text) { ++constructed; }
+    CountedKey(const CountedKey& other): text(other.text) { ++constructed; }
+    CountedKey(CountedKey&&) noexcept = default;
+    bool operator==(std::string_view other) const noexcept { return text == other; }
+};
+struct CountedKeyHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view text) const noexcept { return std::hash<std::string_view>()(text); }
+    std::size_t operator()(const CountedKey& key) const noexcept { return (*this)(key.text); }
+};
+
+TEST(LRUCacheTest, TransparentLookup) {
+    LRUCache<CountedKey, int, InplaceFunction<void(const CountedKey&, const int&)>, CountedKey, CountedKeyHash> cache(4);
+    cache.Emplace(std::string_view("alpha"), 1);
+    cache.Emplace("beta", 2);
+    EXPECT_EQ(CountedKey::constructed, 2);
+    ASSERT_NE(cache.Get("alpha"), nullptr);
+    EXPECT_EQ(*cache.Get(std::string_view("alpha")), 1);
+    EXPECT_NE(cache.Peek("beta"), nullptr);
+    EXPECT_TRUE(cache.Exists(std::string("beta")));
+    EXPECT_FALSE(cache.Exists("gamma"));
+    EXPECT_EQ(*cache.Emplace("beta", 20), 20); // An update does not build a key
+    EXPECT_TRUE(cache.Erase("alpha"));
+    EXPECT_FALSE(cache.Exists("alpha"));
+    EXPECT_EQ(CountedKey::constructed, 2);
+
+    // String keys from views, with StringHash
+    LRUCache<String, int, InplaceFunction<void(const String&, const int&)>, StringView, StringHash> strings(4);
+    strings.Put(String("key"), 1);
+    EXPECT_EQ(*strings.Get("key"), 1);
+    EXPECT_EQ(*strings.Get(StringView("key")), 1);
+    EXPECT_EQ(*strings.Get(std::string_view("key")), 1);
+}
+
+TEST(LRUCacheTest, Emplace) {
+    LRUCache<int, std::string> cache(2);
+    std::string* value = cache.Emplace(1, 3, 'x');
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, "xxx");
+    EXPECT_EQ(*cache.Emplace(1, "one"), "one");
+    cache.Emplace(2, "two");
+    cache.Emplace(3, "three");
+    EXPECT_FALSE(cache.Exists(1));
+    EXPECT_EQ(cache.Size(), 2);
+
+    // Weighted: the item is built before it is weighed
+    auto weigher = [](const int&, const std::string& value) { return value.size(); };
+    LRUCache<int, std::string, InplaceFunction<void(const int&, const std::string&)>, int, std::hash<int>, std::equal_to<>,
+             LRUPolicy, decltype(weigher)> weighted(10, nullptr, weigher);
+    EXPECT_NE(weighted.Emplace(1, 6, 'a'), nullptr);
+    EXPECT_NE(weighted.Emplace(2, 4, 'b'), nullptr);
+    EXPECT_EQ(weighted.Weight(), 10);
+    EXPECT_NE(weighted.Emplace(3, 5, 'c'), nullptr); // Evicts 1
+    EXPECT_FALSE(weighted.Exists(1));
+    EXPECT_EQ(weighted.Emplace(4, 11, 'd'), nullptr); // Too heavy
+    EXPECT_EQ(weighted.Emplace(2, 11, 'd'), nullptr); // Too heavy, the old value is evicted
+    EXPECT_FALSE(weighted.Exists(2));
+    EXPECT_EQ(weighted.Weight(), 5);
+}
+
+TEST(LRUCacheTest, CopyAndMove) {
+    LRUCache<int, int> cache(4);
+    for (int i = 0; i < 4; ++i) cache.Put(i, i * 10);
+    cache.Get(0);
+    auto copy = cache;
+    copy.Put(100, 0); // The copy keeps the recency order, 1 is the least recently used
+    EXPECT_FALSE(copy.Exists(1));
+    EXPECT_TRUE(copy.Exists(0));
+    EXPECT_TRUE(cache.Exists(1));
+
+    auto moved = std::move(cache);
+    EXPECT_EQ(moved.Size(), 4);
+    EXPECT_EQ(*moved.Get(2), 20);
+    cache = moved;
+    EXPECT_EQ(*cache.Get(3), 30);
+}
+
+TEST(LRUCacheTest, MatchesReference) {
+    // Compare with a straightforward std::list + std::map model
+    constexpr std::size_t capacity = 500;
+    LRUCache<int, int> cache(capacity);
+    std::list<std::pair<int, int>> order;
+    std::map<int, std::list<std::pair<int, int>>::iterator> index;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> keys(0, 2000);
+    for (int step = 0; step < 200000; ++step) {
+        int key = keys(rng);
+        switch (rng() % 3) {
+            case 0: {
+                auto value = cache.Get(key);
+                auto it = index.find(key);
+                ASSERT_EQ(value != nullptr, it != index.end());
+                if (value) {
+                    ASSERT_EQ(*value, it->second->second);
+                    order.splice(order.begin(), order, it->second);
+                }
+                break;
+            }
+            case 1: {
+                cache.Put(key, step);
+                auto it = index.find(key);
+                if (it != index.end()) {
+                    it->second->second = step;
+                    order.splice(order.begin(), order, it->second);
+                } else {
+                    if (order.size() >= capacity) {
+                        index.erase(order.back().first);
+                        order.pop_back();
+                    }
+                    order.emplace_front(key, step);
+                    index[key] = order.begin();
+                }
+                break;
+            }
+            default: {
+                auto it = index.find(key);
+                ASSERT_EQ(cache.Erase(key), it != index.end());
+                if (it != index.end()) {
+                    order.erase(it->second);
+                    index.erase(it);
+                }
+                break;
+            }
+        }
+        ASSERT_EQ(cache.Size(), order.size());
+    }
+}
+
+template <typename Policy>
+class LRUCachePolicyTest: public ::testing::Test {};
+using Policies = ::testing::Types<LRUPolicy, ClockPolicy, SLRUPolicy, TinyLFUPolicy>;
+TYPED_TEST_SUITE(LRUCachePolicyTest, Policies);
+
+TYPED_TEST(LRUCachePolicyTest, Consistent) {
+    // Whatever the policy evicts, the cache must hold the last value of the keys it keeps
+    constexpr std::size_t capacity = 300;
+    std::map<int, int> evicted;
+    using Cache = LRUCache<int, int, InplaceFunction<void(const int&, const int&)>, int, std::hash<int>, std::equal_to<>, TypeParam>;
+    Cache cache(capacity, [&evicted](const int& k, const int& v) { evicted[k] = v; });
+    std::map<int, int> model;
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> keys(0, 1000);
+    for (int step = 0; step < 100000; ++step) {
+        int key = keys(rng);
+        switch (rng() % 4) {
+            case 0:
+            case 1: {
+                auto value = cache.Get(key);
+                if (value) {
+                    ASSERT_EQ(model.count(key), 1);
+                    ASSERT_EQ(*value, model[key]);
+                }
+                break;
+            }
+            case 2: {
+                bool full = cache.Size() == capacity && !cache.Exists(key);
+                evicted.clear();
+                cache.Put(key, step);
+                ASSERT_EQ(evicted.size(), full ? 1 : 0);
+                for (auto& [k, v]: evicted) {
+                    ASSERT_EQ(model[k], v);
+                    ASSERT_FALSE(cache.Exists(k));
+                    model.erase(k);
+                }
+                model[key] = step;
+                break;
+            }
+            default:
+                ASSERT_EQ(cache.Erase(key), model.erase(key) == 1);
+                break;
+        }
+        ASSERT_EQ(cache.Size(), model.size());
+    }
+
+    // The copy holds the same entries and evicts the same victims
+    Cache copy = cache;
+    for (auto& [k, v]: model) ASSERT_EQ(*copy.Peek(k), v);
+    for (int key = 2000; key < 2100; ++key) {
+        cache.Put(key, key);
+        copy.Put(key, key);
+    }
+    for (int key = 0; key <= 1000; ++key) ASSERT_EQ(cache.Exists(key), copy.Exists(key));
+}
+
+TEST(LRUCacheTest, ClockSecondChance) {
+    LRUCache<int, int, InplaceFunction<void(const int&, const int&)>, int, std::hash<int>, std::equal_to<>, ClockPolicy> cache(3);
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Put(3, 3);
+    cache.Get(1);
+    cache.Put(4, 4); // 1 was referenced, 2 is evicted
+    EXPECT_TRUE(cache.Exists(1));
+    EXPECT_FALSE(cache.Exists(2));
+    cache.Put(5, 5); // 4 is inserted behind the hand, 3 is next
+    EXPECT_FALSE(cache.Exists(3));
+    cache.Put(6, 6); // The hand cleared the flag of 1
+    EXPECT_FALSE(cache.Exists(1));
+    EXPECT_TRUE(cache.Exists(4));
+}
+
+template <typename Policy>
+std::size_t HotHitsAfterScan() {
+    LRUCache<int, int, InplaceFunction<void(const int&, const int&)>, int, std::hash<int>, std::equal_to<>, Policy> cache(1000);
+    for (int round = 0; round < 5; ++round) {
+        for (int key = 0; key < 500; ++key) {
+            if (!cache.Get(key)) cache.Put(key, key);
+        }
+    }
+    for (int key = 100000; key < 103000; ++key) {
+        if (!cache.Get(key)) cache.Put(key, key);
+    }
+    std::size_t hits = 0;
+    for (int key = 0; key < 500; ++key) hits += cache.Exists(key);
+    return hits;
+}
+
+TEST(LRUCacheTest, ScanResistance) {
+    // A scan of 3x the cache size flushes LRU, the hot set is protected by SLRU and W-TinyLFU
+    EXPECT_EQ(HotHitsAfterScan<LRUPolicy>(), 0);
+    EXPECT_EQ(HotHitsAfterScan<SLRUPolicy>(), 500);
+    // The hot entries still in the window (1%) only survive if the sketch rates them above the scanned keys
+    EXPECT_GE(HotHitsAfterScan<TinyLFUPolicy>(), 490);
+}
+
+TEST(LRUCacheTest, Weighted) {
+    struct SizeWeigher {
+        std::size_t operator()(const int&, const std::string& value) const { return value.size(); }
+    };
+    std::vector<std::pair<int, std::size_t>> evicted;
+    LRUCache<int, std::string, InplaceFunction<void(const int&, const std::string&, std::size_t)>, int, std::hash<int>, std::equal_to<>,
+        LRUPolicy, SizeWeigher> cache(100, [&evicted](const int& k, const std::string&, std::size_t weight) { evicted.emplace_back(k, weight); });
+    cache.Put(1, std::string(30, 'a'));
+    cache.Put(2, std::string(30, 'b'));
+    cache.Put(3, std::string(30, 'c'));
+    EXPECT_EQ(cache.Weight(), 90);
+    EXPECT_TRUE(evicted.empty());
+
+    cache.Put(4, std::string(70, 'd')); // Evicts 1 and 2 to fit
+    ASSERT_EQ(evicted.size(), 2);
+    EXPECT_EQ(evicted[0], std::make_pair(1, std::size_t(30)));
+    EXPECT_EQ(evicted[1], std::make_pair(2, std::size_t(30)));
+    EXPECT_EQ(cache.Size(), 2);
+    EXPECT_EQ(cache.Weight(), 100);
+
+    cache.Put(5, std::string(101, 'e')); // Heavier than the cache, not cached
+    EXPECT_FALSE(cache.Exists(5));
+    EXPECT_EQ(evicted.size(), 2);
+
+    cache.Put(3, std::string(50, 'C')); // Growing an entry evicts the least recently used other one
+    ASSERT_EQ(evicted.size(), 3);
+    EXPECT_EQ(evicted[2].first, 4);
+    EXPECT_EQ(cache.Weight(), 50);
+    cache.Put(3, std::string(10, 'c'));
+    EXPECT_EQ(cache.Weight(), 10);
+
+    EXPECT_TRUE(cache.Erase(3));
+    EXPECT_EQ(cache.Weight(), 0);
+}
+
+TYPED_TEST(LRUCachePolicyTest, WeightedConsistent) {
+    struct ValueWeigher {
+        std::size_t operator()(const int&, const int& value) const { return value % 50 + 1; }
+    };
+    LRUCache<int, int, InplaceFunction<void(const int&, const int&)>, int, std::hash<int>, std::equal_to<>, TypeParam, ValueWeigher> cache(1000);
+    std::map<int, int> model;
+    std::mt19937 rng(11);
+    for (int step = 0; step < 50000; ++step) {
+        int key = rng() % 500;
+        if (rng() % 2) {
+            cache.Put(key, step);
+            model[key] = step;
+        } else if (auto value = cache.Get(key)) {
+            ASSERT_EQ(*value, model[key]);
+        }
+        ASSERT_LE(cache.Weight(), 1000);
+    }
+    std::size_t weight = 0;
+    for (auto& [k, v]: model) {
+        if (cache.Exists(k)) weight += v % 50 + 1;
+    }
+    EXPECT_EQ(cache.Weight(), weight);
+}
+
+TYPED_TEST(LRUCachePolicyTest, WeightedUpdate) {
+    struct SizeWeigher {
+        std::size_t operator()(const int&, const std::string& value) const { return value.size(); }
+    };
+    LRUCache<int, std::string, InplaceFunction<void(const int&, const std::string&)>, int, std::hash<int>, std::equal_to<>,
+        TypeParam, SizeWeigher> cache(100);
+    for (int k = 0; k < 10; ++k) cache.Put(k, std::string(10, 'a'));
+    for (int k = 1; k < 8; ++k) cache.Get(k);
+    // Growing an entry evicts others, never the entry itself, whatever the policy thinks of it
+    std::string* value = cache.Emplace(0, std::string(40, 'b'));
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, std::string(40, 'b'));
+    ASSERT_NE(cache.Get(0), nullptr);
+    EXPECT_EQ(*cache.Get(0), std::string(40, 'b'));
+    EXPECT_EQ(cache.Size(), 7);
+    EXPECT_EQ(cache.Weight(), 100);
+    std::size_t weight = 0;
+    for (int k = 0; k < 10; ++k) {
+        if (auto found = cache.Get(k)) weight += found->size();
+    }
+    EXPECT_EQ(weight, 100);
+
+    EXPECT_EQ(cache.Emplace(0, std::string(100, 'c'))->size(), 100); // Alone in the cache
+    EXPECT_EQ(cache.Size(), 1);
+    EXPECT_EQ(cache.Emplace(0, std::string(101, 'd')), nullptr); // Heavier than the cache
+    EXPECT_EQ(cache.Size(), 0);
+    EXPECT_EQ(cache.Weight(), 0);
+}
+
+/// @brief A clock the tests move by hand
+struct ManualClock {
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<ManualClock>;
+    static constexpr bool is_steady = true;
+    static inline time_point current{std::chrono::hours(1)};
+    static time_point now() noexcept { return current; }
+};
+
+template <typename Evictor = InplaceFunction<void(const int&, const int&)>>
+using ExpiringCache = LRUCache<int, int, Evictor, int, std::hash<int>, std::equal_to<>, LRUPolicy, UnitWeigher, ManualClock>;
+
+TEST(LRUCacheTest, ExpireAfterWrite) {
+    using namespace std::chrono_literals;
+    std::vector<int> evicted;
+    ExpiringCache<> cache(100, [&evicted](const int& k, const int&) { evicted.push_back(k); });
+    cache.SetExpireAfterWrite(10s);
+    cache.Put(1, 1);
+    ManualClock::current += 5s;
+    cache.Put(2, 2);
+    ASSERT_NE(cache.Get(1), nullptr); // Reads do not extend the write deadline
+    ManualClock::current += 5s;
+    EXPECT_EQ(cache.Get(1), nullptr);
+    EXPECT_EQ(evicted, std::vector<int>{1});
+    EXPECT_TRUE(cache.Exists(2));
+    cache.Put(2, 20); // A write restarts the deadline
+    ManualClock::current += 9s;
+    EXPECT_EQ(*cache.Get(2), 20);
+    ManualClock::current += 2s;
+    EXPECT_FALSE(cache.Exists(2));
+    EXPECT_EQ(cache.Peek(2), nullptr);
+    EXPECT_EQ(cache.Size(), 1); // Not removed until a Get, a Put or CleanUp
+    cache.CleanUp();
+    EXPECT_EQ(cache.Size(), 0);
+    EXPECT_EQ(evicted, (std::vector<int>{1, 2}));
+}
+
+TEST(LRUCacheTest, ExpireAfterAccess) {
+    using namespace std::chrono_literals;
+    ExpiringCache<> cache(100);
+    cache.SetExpireAfterAccess(10s);
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    for (int i = 0; i < 5; ++i) {
+        ManualClock::current += 6s;
+        ASSERT_NE(cache.Get(1), nullptr); // Kept alive by the reads
+    }
+    EXPECT_FALSE(cache.Exists(2));
+
+    cache.SetExpireAfterWrite(40s); // The write deadline bounds the access one
+    cache.Put(1, 10);
+    for (int i = 0; i < 6; ++i) {
+        ManualClock::current += 6s;
+        ASSERT_NE(cache.Get(1), nullptr);
+    }
+    ManualClock::current += 6s;
+    EXPECT_EQ(cache.Get(1), nullptr);
+}
+
+TEST(LRUCacheTest, ExpiringMove) {
+    using namespace std::chrono_literals;
+    ExpiringCache<> source(100);
+    source.SetExpireAfterWrite(10s);
+    for (int k = 0; k < 3; ++k) source.Put(k, k);
+    ExpiringCache<> moved(std::move(source));
+    // The moved-from cache is empty and keeps no timer of the moved entries
+    source.Put(10, 10);
+    ManualClock::current += 11s;
+    source.CleanUp();
+    EXPECT_EQ(source.Size(), 0);
+    EXPECT_EQ(moved.Size(), 3);
+    moved.CleanUp();
+    EXPECT_EQ(moved.Size(), 0);
+}
+
+TEST(LRUCacheTest, ExpirySweep) {
+    // The timer wheel removes every expired entry, without reads, over deadlines spread from seconds to days
+    using namespace std::chrono_literals;
+    std::size_t evicted = 0;
+    ExpiringCache<> cache(100000, [&evicted](const int&, const int&) { ++evicted; });
+    std::mt19937 rng(3);
+    for (int key = 0; key < 20000; ++key) {
+        auto ttl = std::chrono::seconds(1 + rng() % (3 * 24 * 3600));
+        cache.SetExpireAfterWrite(ttl);
+        cache.Put(key, key);
+    }
+    for (int hours = 1; hours <= 80; ++hours) {
+        ManualClock::current += 1h;
+        cache.CleanUp();
+        ASSERT_EQ(cache.Size() + evicted, 20000u);
+    }
+    EXPECT_EQ(cache.Size(), 0);
+}
+
+TEST(LRUCacheTest, RefreshAhead) {
+    using namespace std::chrono_literals;
+    std::vector<int> refreshed;
+    ExpiringCache<> cache(100);
+    cache.SetExpireAfterWrite(60s);
+    cache.SetRefreshAhead(10s, [&refreshed](const int& key) { refreshed.push_back(key); });
+    cache.Put(1, 1);
+    ManualClock::current += 45s;
+    cache.Get(1);
+    EXPECT_TRUE(refreshed.empty());
+    ManualClock::current += 10s;
+    ASSERT_NE(cache.Get(1), nullptr); // Serves the current value and asks for a reload once
+    cache.Get(1);
+    EXPECT_EQ(refreshed, std::vector<int>{1});
+    cache.Put(1, 2); // The reload completes
+    ManualClock::current += 45s;
+    EXPECT_EQ(*cache.Get(1), 2);
+    EXPECT_EQ(refreshed.size(), 1);
+}
+
+TEST(LRUCacheTest, Stats) {
+    using namespace std::chrono_literals;
+    static_assert(std::is_empty_v<NoCacheStats>);
+    using Cache = LRUCache<int, int, InplaceFunction<void(const int&, const int&)>, int, std::hash<int>, std::equal_to<>,
+                           LRUPolicy, UnitWeigher, ManualClock, CacheStatsCounter>;
+    Cache cache(2);
+    cache.SetExpireAfterWrite(10s);
+    cache.Put(1, 1);
+    cache.Put(2, 2);
+    cache.Get(1);
+    cache.Get(3);
+    cache.Put(3, 3); // Evicts 2
+    cache.Peek(1);   // Not recorded
+    ManualClock::current += 11s;
+    cache.Get(1);    // Expired
+    cache.Put(4, 4); // Sweeps 3
+    CacheStats stats = cache.Stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.puts, 4u);
+    EXPECT_EQ(stats.Evictions(EvictionCause::Size), 1u);
+    EXPECT_EQ(stats.Evictions(EvictionCause::Expired), 2u);
+    EXPECT_EQ(stats.size, 1u);
+    EXPECT_DOUBLE_EQ(stats.HitRate(), 1.0 / 3);
+
+    Cache copy = cache;
+    copy.Clear();
+    EXPECT_EQ(copy.Stats().Evictions(EvictionCause::Cleared), 1u);
+    EXPECT_EQ(copy.Stats().Evictions(), 4u);
+    EXPECT_EQ(cache.Stats().Evictions(), 3u);
+}
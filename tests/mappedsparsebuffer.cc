@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "lcore/mappedsparsebuffer.hpp"
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <utility>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace {
+
+/// @brief A data file and its sidecar, removed at the end of the test
+struct TempBuffer {
+    std::filesystem::path path;
+    explicit TempBuffer(const char* name): path(std::filesystem::temp_directory_path() / name) { Remove(); }
+    ~TempBuffer() { Remove(); }
+    std::filesystem::path Sidecar() const { return std::filesystem::path(path) += ".ranges"; }
+    void Remove() const {
+        std::filesystem::remove(path);
+        std::filesystem::remove(Sidecar());
+    }
+};
+
+using Ranges = std::vector<std::pair<std::size_t, std::size_t>>;
+
+Ranges RangesOf(const MappedSparseBuffer<int>& buf) {
+    return Ranges(buf.get_ranges().begin(), buf.get_ranges().end());
+}
+
+std::vector<int> Sequence(int first, std::size_t count) {
+    std::vector<int> values(count);
+    for (std::size_t i = 0; i < count; ++i) values[i] = first + static_cast<int>(i);
+    return values;
+}
+
+}
+
+TEST(MappedSparseBufferTest, Basic) {
+    TempBuffer file("lcore_mappedsparse_basic.bin");
+    MappedSparseBuffer<int> buf(file.path, 1 << 20);
+    EXPECT_EQ(buf.size(), 1u << 20);
+    EXPECT_EQ(buf.chunk_count(), 0u);
+    EXPECT_EQ(std::filesystem::file_size(file.path), (1u << 20) * sizeof(int));
+
+    std::vector<int> data = Sequence(0, 1000);
+    buf.write(5000, data);
+    buf.write(2000, data);
+    EXPECT_EQ(RangesOf(buf), (Ranges{{2000, 3000}, {5000, 6000}}));
+    EXPECT_EQ(buf.read(2500, 1000).size(), 500u);
+    EXPECT_EQ(buf.read(2500, 1)[0], 500);
+    EXPECT_TRUE(buf.read(4000, 10).empty());
+
+    buf.write_sparse(2900, Sequence(-100, 200)); // Only fills [3000, 3100)
+    EXPECT_EQ(buf.read(2999, 2)[0], 999);
+    EXPECT_EQ(buf.read(3000, 1)[0], 0);
+
+    // Written past the end, the file grows
+    buf.write((1 << 20) + 10, data);
+    EXPECT_EQ(buf.size(), (1u << 20) + 1010);
+    EXPECT_GE(buf.capacity(), buf.size());
+    EXPECT_EQ(buf.read((1 << 20) + 10, 1000).back(), 999);
+
+    buf.resize(5500);
+    EXPECT_EQ(RangesOf(buf), (Ranges{{2000, 3100}, {5000, 5500}}));
+}
+
+TEST(MappedSparseBufferTest, Resume) {
+    TempBuffer file("lcore_mappedsparse_resume.bin");
+    TempBuffer crashed("lcore_mappedsparse_crashed.bin");
+    {
+        MappedSparseBuffer<int> buf(file.path, 100000);
+        buf.write(0, Sequence(0, 30000));
+        buf.write(60000, Sequence(60000, 10000));
+        buf.sync();
+        buf.write(30000, Sequence(30000, 5000));
+        // The files as a crash would leave them: the last write is not in the sidecar
+        std::filesystem::copy_file(file.path, crashed.path);
+        std::filesystem::copy_file(file.Sidecar(), crashed.Sidecar());
+    }
+    {
+        MappedSparseBuffer<int> buf(file.path);
+        EXPECT_EQ(buf.size(), 100000u);
+        EXPECT_EQ(RangesOf(buf), (Ranges{{0, 35000}, {60000, 70000}}));
+        auto data = buf.read(0, 35000);
+        ASSERT_EQ(data.size(), 35000u);
+        EXPECT_EQ(data[34999], 34999);
+        EXPECT_EQ(buf.read(60000, 10000).back(), 69999);
+    }
+    {
+        MappedSparseBuffer<int> buf(crashed.path);
+        EXPECT_EQ(RangesOf(buf), (Ranges{{0, 30000}, {60000, 70000}}));
+        // Resume the download where it stopped
+        Ranges gaps;
+        buf.get_ranges().for_each_gap(0, buf.size(), [&](std::size_t begin, std::size_t end) { gaps.emplace_back(begin, end); });
+        EXPECT_EQ(gaps, (Ranges{{30000, 60000}, {70000, 100000}}));
+        for (auto [begin, end]: gaps) buf.write(begin, Sequence(static_cast<int>(begin), end - begin));
+        EXPECT_EQ(buf.chunk_count(), 1u);
+    }
+
+    // A damaged sidecar starts over
+    {
+        std::fstream sidecar(crashed.Sidecar(), std::ios::in | std::ios::out | std::ios::binary);
+        sidecar.seekp(40);
+        sidecar.put('\x7f');
+    }
+    MappedSparseBuffer<int> buf(crashed.path, 10);
+    EXPECT_EQ(buf.chunk_count(), 0u);
+    EXPECT_EQ(buf.size(), 10u);
+}
+
+TEST(MappedSparseBufferTest, ShrinkThenGrow) {
+    TempBuffer file("lcore_mappedsparse_shrink.bin");
+    TempBuffer crashed("lcore_mappedsparse_shrink_crashed.bin");
+    {
+        MappedSparseBuffer<int> buf(file.path, 1000);
+        buf.write(0, Sequence(0, 1000));
+        buf.sync();
+        buf.resize(500); // Truncates the file, [500, 1000) holds zeros once it grows again
+        buf.write(2000, Sequence(2000, 10));
+        std::filesystem::copy_file(file.path, crashed.path);
+        std::filesystem::copy_file(file.Sidecar(), crashed.Sidecar());
+    }
+    MappedSparseBuffer<int> buf(crashed.path);
+    EXPECT_EQ(buf.size(), 500u);
+    EXPECT_EQ(RangesOf(buf), (Ranges{{0, 500}}));
+}
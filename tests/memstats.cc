@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "lcore/memstats.hpp"
+#include "lcore/pointer.hpp"
+#include "lcore/lru.hpp"
+#include "lcore/sparsebuffer.hpp"
+#include "lcore/sstream.hpp"
+#include "lcore/async/task.hpp"
+#include <sstream>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+TEST(MemStatsTest, Pointers) {
+    if (!MemStatsEnabled) GTEST_SKIP() << "Built without LCORE_ENABLE_MEMSTATS";
+    auto before = GetMemStats(MemSubsystem::MakePtr);
+    {
+        auto ptr = MakePtr<std::array<char, 100>>();
+        auto stats = GetMemStats(MemSubsystem::MakePtr);
+        EXPECT_EQ(stats.allocations - before.allocations, 1);
+        EXPECT_GE(stats.live_bytes - before.live_bytes, 100);
+        EXPECT_GE(stats.peak_bytes, stats.live_bytes);
+    }
+    EXPECT_EQ(GetMemStats(MemSubsystem::MakePtr).live_bytes, before.live_bytes);
+
+    auto cbBefore = GetMemStats(MemSubsystem::ControlBlock);
+    {
+        SharedPtr<int> ptr(new int(1));
+        EXPECT_EQ(GetMemStats(MemSubsystem::ControlBlock).allocations - cbBefore.allocations, 1);
+    }
+    EXPECT_EQ(GetMemStats(MemSubsystem::ControlBlock).live_bytes, cbBefore.live_bytes);
+}
+
+TEST(MemStatsTest, Containers) {
+    if (!MemStatsEnabled) GTEST_SKIP() << "Built without LCORE_ENABLE_MEMSTATS";
+    auto lruBefore = GetMemStats(MemSubsystem::LRUCache);
+    {
+        LRUCache<int, int> cache(16);
+        for (int i = 0; i < 100; ++i) cache.Put(i, i);
+        EXPECT_GT(GetMemStats(MemSubsystem::LRUCache).live_bytes, lruBefore.live_bytes);
+    }
+    EXPECT_EQ(GetMemStats(MemSubsystem::LRUCache).live_bytes, lruBefore.live_bytes);
+
+    auto sparseBefore = GetMemStats(MemSubsystem::SparseBuffer);
+    {
+        SparseBuffer<char> buffer;
+        char data[64] = {};
+        buffer.write(1000, std::span<const char>(data, sizeof(data)));
+        EXPECT_GE(GetMemStats(MemSubsystem::SparseBuffer).live_bytes - sparseBefore.live_bytes, 64);
+    }
+    EXPECT_EQ(GetMemStats(MemSubsystem::SparseBuffer).live_bytes, sparseBefore.live_bytes);
+
+    auto stringBefore = GetMemStats(MemSubsystem::String);
+    {
+        OStringStream os;
+        for (int i = 0; i < 100; ++i) os << "0123456789";
+        EXPECT_GE(GetMemStats(MemSubsystem::String).live_bytes - stringBefore.live_bytes, 1000);
+    }
+    EXPECT_EQ(GetMemStats(MemSubsystem::String).live_bytes, stringBefore.live_bytes);
+}
+
+static async::Task<int> Answer() {
+    co_return 42;
+}
+
+TEST(MemStatsTest, Coroutine) {
+    if (!MemStatsEnabled) GTEST_SKIP() << "Built without LCORE_ENABLE_MEMSTATS";
+    auto before = GetMemStats(MemSubsystem::Coroutine);
+    {
+        auto task = Answer();
+        EXPECT_EQ(GetMemStats(MemSubsystem::Coroutine).allocations - before.allocations, 1);
+        EXPECT_GT(GetMemStats(MemSubsystem::Coroutine).live_bytes, before.live_bytes);
+    }
+    EXPECT_EQ(GetMemStats(MemSubsystem::Coroutine).live_bytes, before.live_bytes);
+}
+
+TEST(MemStatsTest, Dump) {
+    std::ostringstream os;
+    DumpMemStats(os);
+    auto output = os.str();
+    for (size_t i = 0; i < static_cast<size_t>(MemSubsystem::Count); ++i) {
+        EXPECT_NE(output.find(MemSubsystemName(static_cast<MemSubsystem>(i))), std::string::npos);
+    }
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "lcore/mmaplru.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace {
+
+struct Record {
+    std::uint64_t id;
+    double score;
+    char name[16];
+};
+using Cache = MmapLRUCache<std::uint64_t, Record>;
+
+/// @brief A file path removed at the end of the test
+struct TempPath {
+    std::filesystem::path path;
+    explicit TempPath(const char* name): path(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove(path);
+    }
+    ~TempPath() { std::filesystem::remove(path); }
+    std::string str() const { return path.string(); }
+};
+
+Record MakeRecord(std::uint64_t id) {
+    Record record{id, id * 0.5, {}};
+    std::snprintf(record.name, sizeof(record.name), "record-%llu", static_cast<unsigned long long>(id));
+    return record;
+}
+
+std::vector<char> ReadAll(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), {});
+}
+void WriteAll(const std::filesystem::path& path, const std::vector<char>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+}
+
+TEST(MmapLRUCacheTest, Basic) {
+    TempPath file("lcore_mmaplru_basic.cache");
+    Cache cache(file.str(), 3);
+    EXPECT_EQ(cache.OpenedAs(), Cache::OpenState::Created);
+    for (std::uint64_t i = 1; i <= 3; ++i) cache.Put(i, MakeRecord(i));
+    ASSERT_NE(cache.Get(1), nullptr); // 2 is now the least recently used
+    cache.Put(4, MakeRecord(4));
+    EXPECT_FALSE(cache.Exists(2));
+    EXPECT_EQ(cache.Size(), 3);
+    EXPECT_STREQ(cache.Get(4)->name, "record-4");
+    cache.Put(4, MakeRecord(40));
+    EXPECT_EQ(cache.Get(4)->id, 40);
+    EXPECT_TRUE(cache.Erase(3));
+    EXPECT_FALSE(cache.Erase(3));
+    EXPECT_EQ(cache.Size(), 2);
+    cache.Clear();
+    EXPECT_TRUE(cache.Empty());
+    cache.Put(5, MakeRecord(5));
+    EXPECT_EQ(cache.Peek(5)->id, 5);
+}
+
+TEST(MmapLRUCacheTest, Reopen) {
+    TempPath file("lcore_mmaplru_reopen.cache");
+    {
+        Cache cache(file.str(), 100);
+        for (std::uint64_t i = 0; i < 150; ++i) cache.Put(i, MakeRecord(i));
+        cache.Get(60); // Most recently used
+    }
+    {
+        Cache cache(file.str(), 100);
+        EXPECT_EQ(cache.OpenedAs(), Cache::OpenState::Reopened);
+        EXPECT_EQ(cache.Size(), 100);
+        EXPECT_FALSE(cache.Exists(49));
+        ASSERT_NE(cache.Peek(149), nullptr);
+        EXPECT_STREQ(cache.Peek(149)->name, "record-149");
+        cache.Put(1000, MakeRecord(1000)); // Evicts 50, the recency order was kept
+        EXPECT_FALSE(cache.Exists(50));
+        EXPECT_TRUE(cache.Exists(60));
+    }
+    {
+        // Another size or schema discards the file
+        Cache cache(file.str(), 100, 2);
+        EXPECT_EQ(cache.OpenedAs(), Cache::OpenState::Discarded);
+        EXPECT_TRUE(cache.Empty());
+    }
+    {
+        using Other = MmapLRUCache<std::uint64_t, std::uint64_t>;
+        Other cache(file.str(), 100, 2);
+        EXPECT_EQ(cache.OpenedAs(), Other::OpenState::Discarded);
+    }
+}
+
+TEST(MmapLRUCacheTest, CrashRecovery) {
+    TempPath file("lcore_mmaplru_crash.cache");
+    TempPath image("lcore_mmaplru_crash_image.cache");
+    {
+        Cache cache(file.str(), 64);
+        for (std::uint64_t i = 0; i < 80; ++i) cache.Put(i, MakeRecord(i));
+        cache.Get(20);
+        cache.Sync();
+        cache.Put(100, MakeRecord(100));
+        cache.Erase(30);
+        // The file as a crash would leave it: written since the sync
+        std::filesystem::copy_file(file.path, image.path);
+    }
+
+    // Tear the entry of key 40
+    std::vector<char> bytes = ReadAll(image.path);
+    Record torn = MakeRecord(40);
+    auto it = std::search(bytes.begin(), bytes.end(), torn.name, torn.name + sizeof(torn.name));
+    ASSERT_NE(it, bytes.end());
+    *it = 'X';
+    WriteAll(image.path, bytes);
+
+    Cache cache(image.str(), 64);
+    EXPECT_EQ(cache.OpenedAs(), Cache::OpenState::Recovered);
+    EXPECT_FALSE(cache.Exists(40));
+    EXPECT_FALSE(cache.Exists(30));
+    EXPECT_TRUE(cache.Exists(100));
+    EXPECT_EQ(cache.Size(), 62);
+    for (std::uint64_t i = 17; i < 80; ++i) {
+        if (i == 30 || i == 40) continue;
+        ASSERT_NE(cache.Peek(i), nullptr) << i;
+        EXPECT_EQ(cache.Peek(i)->id, i);
+    }
+    // The recency order was rebuilt: 17 is the least recently used, then 18, 19 and 21
+    for (std::uint64_t i = 200; i < 204; ++i) cache.Put(i, MakeRecord(i));
+    EXPECT_FALSE(cache.Exists(17));
+    EXPECT_FALSE(cache.Exists(18));
+    EXPECT_TRUE(cache.Exists(19));
+    EXPECT_TRUE(cache.Exists(20));
+}
@@ -2,6 +2,8 @@
 #include "lcore/pointer.hpp"
 #include <iostream>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace LCORE_NAMESPACE_NAME;
 
@@ -293,3 +295,174 @@ TEST(PointerTest, SharedFromThis) {
     EXPECT_TRUE(output.find("EnableSharedFromThisTest destroyed with value: 200") != std::string::npos);
     EXPECT_TRUE(output.find("EnableSharedFromThisTest destroyed with value: 300") != std::string::npos);
 };
+
+TEST(PointerTest, PooledControlBlock) {
+    struct Counted {
+        int value;
+        Counted(int v) : value(v) {}
+    };
+
+    // Warm up the pool of this thread
+    for (int i = 0; i < 16; ++i) SharedPtr<Counted> warm(new Counted(i));
+
+    auto before = GetControlBlockPoolStats();
+    for (int i = 0; i < 1000; ++i) {
+        SharedPtr<Counted> ptr(new Counted(i));
+        SharedPtr<Counted> deleted(new Counted(i), [](Counted* p) { delete p; });
+        EXPECT_EQ(ptr->value, i);
+    }
+    auto after = GetControlBlockPoolStats();
+    EXPECT_EQ(after.allocations - before.allocations, 2000);
+    EXPECT_EQ(after.deallocations - before.deallocations, 2000);
+    EXPECT_EQ(after.system_allocations, before.system_allocations); // Every block came from the free lists
+    EXPECT_EQ(after.pool_hits - before.pool_hits, 2000);
+}
+
+TEST(PointerTest, PooledControlBlockCrossThread) {
+    struct Counted {
+        int value;
+        Counted(int v) : value(v) {}
+    };
+
+    auto before = GetControlBlockPoolStats();
+    std::vector<SharedPtr<Counted>> ptrs;
+    for (int i = 0; i < 1000; ++i) ptrs.emplace_back(new Counted(i));
+
+    // Drop the last references on other threads, their caches give the blocks back to the shared lists on exit
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < ptrs.size(); i += 4) ptrs[i].Reset();
+        });
+    }
+    for (auto& t: threads) t.join();
+    auto middle = GetControlBlockPoolStats();
+    EXPECT_EQ(middle.deallocations - before.deallocations, 1000);
+
+    // Reuse the returned blocks
+    for (int i = 0; i < 1000; ++i) ptrs[i] = SharedPtr<Counted>(new Counted(i));
+    ptrs.clear();
+    auto after = GetControlBlockPoolStats();
+    EXPECT_EQ(after.system_allocations, middle.system_allocations);
+    EXPECT_EQ(after.allocations - after.deallocations, before.allocations - before.deallocations);
+}
+
+TEST(PointerTest, OverAligned) {
+    struct alignas(128) Aligned {
+        int value;
+        Aligned(int v) : value(v) {}
+    };
+    for (int i = 0; i < 16; ++i) {
+        auto ptr = MakePtr<Aligned>(i);
+        auto biased = MakeBiasedPtr<Aligned>(i);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr.Get().Get()) % alignof(Aligned), 0);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(biased.Get().Get()) % alignof(Aligned), 0);
+        EXPECT_EQ(ptr->value, i);
+        EXPECT_EQ(biased->value, i);
+    }
+}
+
+TEST(PointerTest, BiasedPtr) {
+    struct Tracked {
+        int value;
+        bool* destroyed;
+        Tracked(int v, bool* d) : value(v), destroyed(d) {}
+        ~Tracked() { *destroyed = true; }
+    };
+
+    bool destroyed = false;
+    WeakPtr<Tracked> weak;
+    {
+        auto ptr = MakeBiasedPtr<Tracked>(42, &destroyed);
+        weak = ptr;
+        EXPECT_EQ(ptr->value, 42);
+        EXPECT_EQ(ptr.UseCount(), 1);
+        {
+            auto copy = ptr;
+            auto copy2 = copy;
+            EXPECT_EQ(ptr.UseCount(), 3);
+        }
+        EXPECT_EQ(ptr.UseCount(), 1);
+        EXPECT_FALSE(weak.Expired());
+    }
+    EXPECT_TRUE(destroyed);
+    EXPECT_TRUE(weak.Expired());
+    EXPECT_EQ(weak.UseCount(), 0);
+}
+
+TEST(PointerTest, BiasedPtrCrossThread) {
+    std::atomic<int> destroyed = 0;
+    struct Tracked {
+        std::atomic<int>* destroyed;
+        Tracked(std::atomic<int>* d) : destroyed(d) {}
+        ~Tracked() { ++*destroyed; }
+    };
+
+    // The owner keeps a reference, other threads drop copies taken on the owner thread
+    auto ptr = MakeBiasedPtr<Tracked>(&destroyed);
+    std::vector<SharedPtr<Tracked>> copies(1000, ptr);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < copies.size(); i += 4) {
+                auto local = copies[i]; // Non-owner reference
+                copies[i].Reset();
+            }
+        });
+    }
+    for (auto& t: threads) t.join();
+    DrainBiasedRefQueue();
+    EXPECT_EQ(ptr.UseCount(), 1);
+    EXPECT_EQ(destroyed, 0);
+    ptr.Reset();
+    EXPECT_EQ(destroyed, 1);
+
+    // The last references live on another thread, the owner only has to merge the queued block
+    auto shared = MakeBiasedPtr<Tracked>(&destroyed);
+    std::thread([moved = std::move(shared)]() mutable { moved.Reset(); }).join();
+    EXPECT_EQ(destroyed, 1);
+    DrainBiasedRefQueue();
+    EXPECT_EQ(destroyed, 2);
+
+    // The owner thread exits before the other references are dropped
+    SharedPtr<Tracked> orphan;
+    std::thread([&] { orphan = MakeBiasedPtr<Tracked>(&destroyed); }).join();
+    EXPECT_EQ(orphan.UseCount(), 1);
+    orphan.Reset();
+    EXPECT_EQ(destroyed, 3);
+}
+
+TEST(PointerTest, BiasedPtrConcurrentDrops) {
+    // Several threads drop references taken on the owner thread while the owner drops its own and merges
+    std::atomic<int> destroyed = 0;
+    struct Tracked {
+        std::atomic<int>* destroyed;
+        Tracked(std::atomic<int>* d) : destroyed(d) {}
+        ~Tracked() { ++*destroyed; }
+    };
+    constexpr int Rounds = 50, Objects = 64, Droppers = 4;
+    for (int round = 0; round < Rounds; ++round) {
+        std::vector<SharedPtr<Tracked>> owned;
+        std::vector<WeakPtr<Tracked>> watchers;
+        std::vector<std::vector<SharedPtr<Tracked>>> given(Droppers);
+        for (int i = 0; i < Objects; ++i) {
+            owned.push_back(MakeBiasedPtr<Tracked>(&destroyed));
+            watchers.emplace_back(owned.back());
+            for (auto& copies: given) copies.push_back(owned.back());
+        }
+        std::vector<std::thread> threads;
+        for (auto& copies: given) {
+            threads.emplace_back([&copies] {
+                for (auto& copy: copies) copy.Reset();
+            });
+        }
+        for (auto& ptr: owned) {
+            ptr.Reset();
+            DrainBiasedRefQueue();
+        }
+        for (auto& t: threads) t.join();
+        DrainBiasedRefQueue();
+        for (auto& watcher: watchers) EXPECT_TRUE(watcher.Expired());
+        ASSERT_EQ(destroyed, (round + 1) * Objects);
+    }
+}
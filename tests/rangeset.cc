@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "lcore/rangeset.hpp"
+#include <utility>
+#include <vector>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace {
+
+using Ranges = std::vector<std::pair<std::size_t, std::size_t>>;
+
+Ranges ToVector(const RangeSet<>& set) {
+    return Ranges(set.begin(), set.end());
+}
+
+}
+
+TEST(RangeSetTest, Insert) {
+    RangeSet<> set;
+    EXPECT_EQ(set.insert(10, 20), 10u);
+    EXPECT_EQ(set.insert(30, 40), 10u);
+    EXPECT_EQ(set.insert(12, 18), 0u);
+    EXPECT_EQ(set.insert(5, 5), 0u);
+    EXPECT_EQ(ToVector(set), (Ranges{{10, 20}, {30, 40}}));
+
+    EXPECT_EQ(set.insert(20, 25), 5u); // Touching, merged
+    EXPECT_EQ(set.insert(0, 5), 5u);
+    EXPECT_EQ(ToVector(set), (Ranges{{0, 5}, {10, 25}, {30, 40}}));
+
+    EXPECT_EQ(set.insert(3, 35), 10u); // Spans the gaps
+    EXPECT_EQ(ToVector(set), (Ranges{{0, 40}}));
+    EXPECT_EQ(set.length(), 40u);
+}
+
+TEST(RangeSetTest, Erase) {
+    RangeSet<> set;
+    set.insert(0, 100);
+    EXPECT_EQ(set.erase(10, 20), 10u);
+    EXPECT_EQ(set.erase(10, 20), 0u);
+    EXPECT_EQ(ToVector(set), (Ranges{{0, 10}, {20, 100}}));
+    EXPECT_EQ(set.erase(5, 30), 15u);
+    EXPECT_EQ(set.erase(90, 200), 10u);
+    EXPECT_EQ(set.erase(0, 1), 1u);
+    EXPECT_EQ(ToVector(set), (Ranges{{1, 5}, {30, 90}}));
+    EXPECT_EQ(set.length(), 64u);
+    EXPECT_EQ(set.erase(0, 1000), 64u);
+    EXPECT_TRUE(set.empty());
+}
+
+TEST(RangeSetTest, Lookup) {
+    RangeSet<> set;
+    set.insert(10, 20);
+    set.insert(30, 40);
+    EXPECT_FALSE(set.contains(9));
+    EXPECT_TRUE(set.contains(10));
+    EXPECT_FALSE(set.contains(20));
+    EXPECT_TRUE(set.contains(12, 20));
+    EXPECT_FALSE(set.contains(15, 35));
+    EXPECT_EQ(set.find(35)->first, 30u);
+
+    Ranges gaps;
+    set.for_each_gap(0, 50, [&](std::size_t begin, std::size_t end) { gaps.emplace_back(begin, end); });
+    EXPECT_EQ(gaps, (Ranges{{0, 10}, {20, 30}, {40, 50}}));
+    gaps.clear();
+    set.for_each_gap(15, 35, [&](std::size_t begin, std::size_t end) { gaps.emplace_back(begin, end); });
+    EXPECT_EQ(gaps, (Ranges{{20, 30}}));
+    gaps.clear();
+    set.for_each_gap(12, 18, [&](std::size_t begin, std::size_t end) { gaps.emplace_back(begin, end); });
+    EXPECT_TRUE(gaps.empty());
+}
+
+TEST(RangeSetTest, Gaps) {
+    RangeSet<> set;
+    set.insert(10, 20);
+    set.insert(30, 40);
+    EXPECT_EQ(set.gaps(0, 35), (Ranges{{0, 10}, {20, 30}}));
+    EXPECT_TRUE(set.gaps(10, 20).empty());
+
+    EXPECT_EQ(set.first_gap(0, 100), (std::pair<std::size_t, std::size_t>(0, 10)));
+    EXPECT_EQ(set.first_gap(15, 100), (std::pair<std::size_t, std::size_t>(20, 30)));
+    EXPECT_EQ(set.first_gap(35, 100), (std::pair<std::size_t, std::size_t>(40, 100)));
+    EXPECT_EQ(set.first_gap(25, 28), (std::pair<std::size_t, std::size_t>(25, 28)));
+    EXPECT_FALSE(set.first_gap(12, 20).has_value());
+    EXPECT_FALSE(set.first_gap(50, 50).has_value());
+}
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 
 #include "lcore/sparsebuffer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
 
 using namespace lcore;
 
@@ -59,3 +62,134 @@ TEST(SparseBuffer, Basic)
     EXPECT_EQ(buf.chunk_count(), 0); // All chunks cleared
     EXPECT_EQ(buf.size(), 0);
 }
+
+TEST(SparseBuffer, OutOfOrder)
+{
+    // Segments crossing page boundaries, written in a scrambled order
+    constexpr std::size_t Segment = 1000, Count = 300;
+    std::vector<char> stream(Segment * Count);
+    for (std::size_t i = 0; i < stream.size(); ++i)
+        stream[i] = static_cast<char>(i * 7 + i / 251);
+
+    SparseBuffer<char> buf;
+    std::vector<bool> written(Count);
+    for (std::size_t i = 0; i < Count; ++i) {
+        std::size_t segment = i * 149 % Count;
+        buf.write(segment * Segment, std::span<const char>(stream.data() + segment * Segment, Segment));
+        // Adjacent segments merge into one range
+        written[segment] = true;
+        std::size_t ranges = 0;
+        for (std::size_t k = 0; k < Count; ++k) {
+            if (written[k] && (k == 0 || !written[k - 1])) {
+                ++ranges;
+            }
+        }
+        EXPECT_EQ(buf.chunk_count(), ranges);
+    }
+    EXPECT_EQ(buf.chunk_count(), 1);
+    EXPECT_EQ(buf.size(), stream.size());
+    EXPECT_EQ(buf.page_count(), (stream.size() + buf.page_size - 1) / buf.page_size);
+
+    // Reads stop at page ends
+    std::vector<char> out;
+    while (out.size() < stream.size()) {
+        auto ref = buf.read(out.size(), stream.size());
+        ASSERT_FALSE(ref.empty());
+        EXPECT_LE(ref.size(), buf.page_size);
+        out.insert(out.end(), ref.begin(), ref.end());
+    }
+    EXPECT_EQ(out, stream);
+
+    // Overlapping writes
+    char patch[3] = {'a', 'b', 'c'};
+    buf.write_sparse(stream.size() - 1, patch);
+    EXPECT_EQ(buf.read(stream.size() - 1, 3)[0], stream.back());
+    EXPECT_EQ(buf.read(stream.size(), 2)[1], 'c');
+    buf.write(10, patch);
+    EXPECT_EQ(buf.read(10, 3)[2], 'c');
+
+    buf.resize(100);
+    EXPECT_EQ(buf.page_count(), 1);
+    EXPECT_EQ(buf.read(50, 100).size(), 50);
+    EXPECT_FALSE(buf.has_data(100));
+}
+
+TEST(SparseBuffer, ScatterGather)
+{
+    using Buffer = SparseBuffer<char, 4096>;
+    std::vector<char> stream(3 * Buffer::page_size + 100);
+    for (std::size_t i = 0; i < stream.size(); ++i)
+        stream[i] = static_cast<char>('a' + i % 26);
+    Buffer buf;
+    buf.write(0, std::span<const char>(stream.data(), 5000));
+    buf.write(6000, std::span<const char>(stream.data() + 6000, stream.size() - 6000));
+
+    // Stops at the gap at 5000, one span per page
+    auto spans = buf.readv(100, stream.size());
+    ASSERT_EQ(spans.size(), 2);
+    EXPECT_EQ(spans[0].size(), Buffer::page_size - 100);
+    EXPECT_EQ(spans[1].size(), 5000 - Buffer::page_size);
+    EXPECT_EQ(spans[1].data()[0], stream[Buffer::page_size]);
+    EXPECT_TRUE(buf.readv(5500, 10).empty());
+    spans = buf.readv(6000, 3000);
+    ASSERT_EQ(spans.size(), 2);
+    EXPECT_EQ(spans[0].size() + spans[1].size(), 3000);
+
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    int fd = fileno(file);
+    EXPECT_EQ(buf.write_to(fd, 0, 4500), 4500);
+    EXPECT_EQ(buf.write_to(fd, 4500, 1000), 500); // Up to the gap
+    EXPECT_EQ(buf.write_to(fd, 6000, stream.size(), 6000), stream.size() - 6000);
+    std::vector<char> out(stream.size());
+    std::fseek(file, 0, SEEK_SET);
+    ASSERT_EQ(std::fread(out.data(), 1, out.size(), file), out.size());
+    std::fclose(file);
+    EXPECT_TRUE(std::equal(out.begin(), out.begin() + 5000, stream.begin()));
+    EXPECT_TRUE(std::equal(out.begin() + 6000, out.end(), stream.begin() + 6000));
+}
+
+TEST(SparseBuffer, ZeroLengthScatter)
+{
+    SparseBuffer<char, 4096> buf;
+    std::vector<char> data(100, 'x');
+    buf.write(0, std::span<const char>(data.data(), data.size()));
+    EXPECT_TRUE(buf.readv(0, 0).empty());
+    EXPECT_TRUE(buf.readv(50, 0).empty());
+
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    int fd = fileno(file);
+    EXPECT_EQ(buf.write_to(fd, 0, 0), 0);
+    EXPECT_EQ(buf.write_to(fd, 0, 0, 10), 0);
+    std::fseek(file, 0, SEEK_END);
+    EXPECT_EQ(std::ftell(file), 0);
+    std::fclose(file);
+}
+
+TEST(SparseBuffer, Holes)
+{
+    SparseBuffer<char> buf(100);
+    char data[10] = {};
+    buf.write(0, data);
+    buf.write(30, data);
+    buf.write(50, std::span<const char>(data, 5));
+    using Holes = std::vector<std::pair<std::size_t, std::size_t>>;
+    EXPECT_EQ(buf.holes(), (Holes{{10, 30}, {40, 50}, {55, 100}}));
+    EXPECT_EQ(buf.holes(35, 52), (Holes{{40, 50}}));
+    EXPECT_EQ(buf.covered_size(), 25);
+    EXPECT_TRUE(buf.is_complete(30, 10));
+    EXPECT_FALSE(buf.is_complete(30, 11));
+    EXPECT_FALSE(buf.is_complete());
+
+    // Scheduling the retries: request the first hole until none is left
+    std::vector<char> fill(100);
+    std::size_t requests = 0;
+    while (auto hole = buf.first_hole_after(0)) {
+        buf.write(hole->first, std::span<const char>(fill.data(), hole->second - hole->first));
+        ++requests;
+    }
+    EXPECT_EQ(requests, 3);
+    EXPECT_TRUE(buf.is_complete());
+    EXPECT_EQ(buf.covered_size(), 100);
+}
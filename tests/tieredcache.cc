@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include "lcore/tieredcache.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace LCORE_NAMESPACE_NAME;
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace {
+
+using Cache = TieredCache<std::uint64_t, std::string>;
+
+/// @brief A directory removed at the end of the test
+struct TempDirectory {
+    std::filesystem::path path;
+    explicit TempDirectory(const char* name): path(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(path);
+    }
+    ~TempDirectory() { std::filesystem::remove_all(path); }
+};
+
+std::string MakeValue(std::uint64_t key) {
+    return "value-" + std::to_string(key) + std::string(key % 7, '+');
+}
+
+}
+
+TEST(TieredCacheTest, SpillsToDisk) {
+    TempDirectory directory("lcore_tieredcache_spill");
+    Cache cache(10, directory.path, 1 << 24);
+    for (std::uint64_t key = 0; key < 100; ++key) cache.Put(key, MakeValue(key));
+    EXPECT_EQ(cache.MemorySize(), 10u);
+
+    // Every entry is found, the first ones from the disk or from the writer queue
+    for (std::uint64_t key = 0; key < 100; ++key) {
+        const std::string* value = cache.Get(key);
+        ASSERT_NE(value, nullptr) << key;
+        EXPECT_EQ(*value, MakeValue(key));
+    }
+    EXPECT_EQ(cache.Get(1000), nullptr);
+
+    cache.Flush();
+    EXPECT_GE(cache.DiskSize(), 90u);
+    EXPECT_EQ(cache.WriteErrors(), 0u);
+
+    // Updates replace the value on the disk once evicted
+    cache.Put(3, "updated");
+    for (std::uint64_t key = 100; key < 120; ++key) cache.Put(key, MakeValue(key));
+    EXPECT_EQ(*cache.Get(3), "updated");
+}
+
+TEST(TieredCacheTest, Erase) {
+    TempDirectory directory("lcore_tieredcache_erase");
+    Cache cache(4, directory.path, 1 << 24);
+    for (std::uint64_t key = 0; key < 20; ++key) cache.Put(key, MakeValue(key));
+    cache.Flush();
+    EXPECT_TRUE(cache.Exists(0));
+    EXPECT_TRUE(cache.Erase(0));  // On the disk
+    EXPECT_TRUE(cache.Erase(19)); // In memory
+    EXPECT_FALSE(cache.Erase(0));
+    EXPECT_FALSE(cache.Exists(0));
+    EXPECT_EQ(cache.Get(0), nullptr);
+    EXPECT_EQ(cache.Get(19), nullptr);
+    cache.Flush();
+    EXPECT_EQ(cache.Get(0), nullptr);
+    EXPECT_NE(cache.Get(1), nullptr);
+}
+
+TEST(TieredCacheTest, Reopen) {
+    TempDirectory directory("lcore_tieredcache_reopen");
+    {
+        Cache cache(8, directory.path, 1 << 24);
+        for (std::uint64_t key = 0; key < 50; ++key) cache.Put(key, MakeValue(key));
+        cache.Erase(5);
+        cache.FlushAll();
+    }
+    {
+        Cache cache(8, directory.path, 1 << 24);
+        EXPECT_EQ(cache.MemorySize(), 0u);
+        EXPECT_EQ(cache.DiskSize(), 49u);
+        EXPECT_EQ(cache.Get(5), nullptr);
+        for (std::uint64_t key = 0; key < 50; ++key) {
+            if (key == 5) continue;
+            ASSERT_NE(cache.Get(key), nullptr) << key;
+            EXPECT_EQ(*cache.Get(key), MakeValue(key));
+        }
+    }
+
+    // A torn record at the end of the last segment is cut off, the others are kept
+    std::filesystem::path last;
+    for (const auto& file: std::filesystem::directory_iterator(directory.path)) last = std::max(last, file.path());
+    std::uintmax_t size = std::filesystem::file_size(last);
+    {
+        std::ofstream out(last, std::ios::binary | std::ios::app);
+        out.write("\x10\x00\x00\x00garbage", 11);
+    }
+    Cache cache(8, directory.path, 1 << 24);
+    EXPECT_EQ(cache.DiskSize(), 49u);
+    EXPECT_EQ(std::filesystem::file_size(last), size);
+}
+
+TEST(TieredCacheTest, DiskBudget) {
+    TempDirectory directory("lcore_tieredcache_budget");
+    constexpr std::uint64_t Budget = 1 << 20;
+    Cache cache(16, directory.path, Budget);
+    std::string big(1000, 'x');
+    for (std::uint64_t key = 0; key < 5000; ++key) cache.Put(key, big);
+    cache.Flush();
+    // The oldest segments were dropped: the log stays within its budget plus a segment
+    EXPECT_LE(cache.DiskBytes(), Budget + Budget / 16 + 2048);
+    EXPECT_LT(cache.DiskSize(), 5000u);
+    EXPECT_EQ(cache.Get(0), nullptr);
+    EXPECT_NE(cache.Get(4900), nullptr);
+}